@@ -71,6 +71,13 @@ float BRAKE::getPosition()
 
 //------------------------------------------------------------------------------
 
+unsigned short BRAKE::getPosition_u16()
+{
+    return _position.read_u16();
+}
+
+//------------------------------------------------------------------------------
+
 void BRAKE::stop()
 {
     _enable = 0;
@@ -61,6 +61,14 @@ public:
 
     float getPosition();
 
+    //--------------------------------------------------------------------------
+    /** Reads the actuator position without float conversion.
+    *
+    *   @return Position from 0 to 0xFFFF, the same scale as getPosition().
+    */
+
+    unsigned short getPosition_u16();
+
     //--------------------------------------------------------------------------
     /** TODO
     *
@@ -132,44 +132,74 @@ QEI::QEI(PinName channelA,
          PinName channelB,
          PinName index,
          int pulsesPerRev,
-         Encoding encoding) : channelA_(channelA), channelB_(channelB),
-        index_(index) {
+         Encoding encoding) : index_(NULL) {
 
     pulses_       = 0;
     revolutions_  = 0;
+    invalid_      = 0;
     pulsesPerRev_ = pulsesPerRev;
     encoding_     = encoding;
+    mode_         = encoding;
+    maxEdgeRate_  = 0;
+    windowStart_  = 0;
+    windowPulses_ = 0;
+
+    channelA_ = new InterruptIn(channelA);
+    channelB_ = new InterruptIn(channelB);
 
     //Workout what the current state is.
-    int chanA = channelA_.read();
-    int chanB = channelB_.read();
+    int chanA = channelA_->read();
+    int chanB = channelB_->read();
 
     //2-bit state.
     currState_ = (chanA << 1) | (chanB);
     prevState_ = currState_;
 
-    //X2 encoding uses interrupts on only channel A.
-    //X4 encoding uses interrupts on      channel A,
-    //and on channel B.
-    channelA_.rise(this, &QEI::encode);
-    channelA_.fall(this, &QEI::encode);
+    //Attach the edge interrupts the encoding needs.
+    setMode(encoding);
 
-    //If we're using X4 encoding, then attach interrupts to channel B too.
-    if (encoding == X4_ENCODING) {
-        channelB_.rise(this, &QEI::encode);
-        channelB_.fall(this, &QEI::encode);
-    }
     //Index is optional.
     if (index !=  NC) {
-        index_.rise(this, &QEI::index);
+        index_ = new InterruptIn(index);
+        index_->rise(this, &QEI::index);
     }
 
 }
 
+QEI::QEI(int pulsesPerRev, Encoding encoding) : channelA_(NULL),
+        channelB_(NULL), index_(NULL) {
+
+    pulses_       = 0;
+    revolutions_  = 0;
+    invalid_      = 0;
+    pulsesPerRev_ = pulsesPerRev;
+    encoding_     = encoding;
+    mode_         = encoding;
+    table_        = qeiStepX4;
+    invalidMask_  = QEI_INVALID_X4;
+    maxEdgeRate_  = 0;
+    windowStart_  = 0;
+    windowPulses_ = 0;
+    currState_    = 0;
+    prevState_    = 0;
+
+}
+
+QEI::~QEI() {
+
+    delete channelA_;
+    delete channelB_;
+    delete index_;
+
+}
+
 void QEI::reset(void) {
 
+    core_util_critical_section_enter();
+    speed_.offset(-pulses_);
     pulses_      = 0;
     revolutions_ = 0;
+    core_util_critical_section_exit();
 
 }
 
@@ -181,6 +211,13 @@ int QEI::getCurrentState(void) {
 
 int QEI::getPulses(void) {
 
+    //Counted in X4 steps, shifts round down so every pulse is as wide.
+    if (encoding_ == X2_ENCODING) {
+        return pulses_ >> 1;
+    }
+    if (encoding_ == X1_ENCODING) {
+        return pulses_ >> 2;
+    }
     return pulses_;
 
 }
@@ -191,6 +228,122 @@ int QEI::getRevolutions(void) {
 
 }
 
+int QEI::getInvalid(void) {
+
+    return invalid_;
+
+}
+
+void QEI::setEncoding(Encoding encoding) {
+
+    if (channelA_ == NULL) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    setMode(encoding);
+    core_util_critical_section_exit();
+
+}
+
+QEI::Encoding QEI::getEncoding(void) {
+
+    return mode_;
+
+}
+
+void QEI::setAdaptive(int maxEdgeRate) {
+
+    if (channelA_ == NULL) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    maxEdgeRate_  = maxEdgeRate;
+    windowStart_  = us_ticker_read();
+    windowPulses_ = pulses_;
+    core_util_critical_section_exit();
+
+}
+
+enc_speed_t QEI::getVelocity(void) {
+
+    enc_speed_t speed;
+    float scale = 1.0;
+
+    core_util_critical_section_enter();
+    speed = speed_.estimate(us_ticker_read());
+    core_util_critical_section_exit();
+
+    //Counted in X4 steps.
+    if (encoding_ == X2_ENCODING) {
+        scale = 0.5;
+    } else if (encoding_ == X1_ENCODING) {
+        scale = 0.25;
+    }
+    speed.rate   *= scale;
+    speed.sigma  *= scale;
+    speed.counts  = (int)(speed.counts * scale);
+
+    return speed;
+
+}
+
+void QEI::setMode(Encoding mode) {
+
+    Callback<void()> edge(this, &QEI::encode);
+    Callback<void()> none;
+    int curr = (channelA_->read() << 1) | channelB_->read();
+
+    //Catch up with edges the old encoding did not interrupt on.
+    pulses_ += qeiCatchUp(prevState_, curr, mode_);
+    prevState_ = curr;
+    currState_ = curr;
+
+    mode_ = mode;
+    if (mode == X4_ENCODING) {
+        table_       = qeiStepX4;
+        invalidMask_ = QEI_INVALID_X4;
+    } else if (mode == X2_ENCODING) {
+        table_       = qeiStepX2;
+        invalidMask_ = QEI_INVALID_X2;
+    } else {
+        table_       = qeiStepX1;
+        invalidMask_ = QEI_INVALID_X1;
+    }
+
+    //X1 interrupts on the rising edges of channel A, X2 on both edges of
+    //channel A and X4 on both edges of both channels.
+    channelA_->rise(edge);
+    channelA_->fall(mode == X1_ENCODING ? none : edge);
+    channelB_->rise(mode == X4_ENCODING ? edge : none);
+    channelB_->fall(mode == X4_ENCODING ? edge : none);
+
+}
+
+void QEI::adapt(uint32_t now) {
+
+    uint32_t elapsed = now - windowStart_;
+    uint32_t moved;
+    Encoding mode;
+
+    if (elapsed < QEI_RATE_WINDOW_US) {
+        return;
+    }
+
+    moved = pulses_ > windowPulses_ ? pulses_ - windowPulses_ :
+            windowPulses_ - pulses_;
+    windowStart_  = now;
+    windowPulses_ = pulses_;
+
+    mode = (Encoding)qeiNextMode(mode_, moved,
+                                 qeiWindowLimit(maxEdgeRate_, elapsed));
+    if (mode != mode_) {
+        setMode(mode);
+    }
+
+}
+
 // +-------------+
 // | X2 Encoding |
 // +-------------+
@@ -235,51 +388,30 @@ int QEI::getRevolutions(void) {
 // We might enter an invalid state for a number of reasons which are hard to
 // predict - if this is the case, it is generally safe to ignore it, update
 // the state and carry on, with the error correcting itself shortly after.
+//
+// Every encoding is a lookup in a 16 entry table indexed by the previous
+// and current state (see qeitable.h), so decoding does not branch on the
+// encoding or the state. The tables count in X4 steps whatever the encoding.
 void QEI::encode(void) {
 
-    int change = 0;
-    int chanA  = channelA_.read();
-    int chanB  = channelB_.read();
+    uint32_t now = us_ticker_read();
+    int step;
 
     //2-bit state.
-    currState_ = (chanA << 1) | (chanB);
-
-    if (encoding_ == X2_ENCODING) {
+    currState_ = (channelA_->read() << 1) | channelB_->read();
+    step = QEI_STEP(prevState_, currState_);
 
-        //11->00->11->00 is counter clockwise rotation or "forward".
-        if ((prevState_ == 0x3 && currState_ == 0x0) ||
-                (prevState_ == 0x0 && currState_ == 0x3)) {
+    pulses_  += table_[step];
+    invalid_ += (invalidMask_ >> step) & 1;
 
-            pulses_++;
-
-        }
-        //10->01->10->01 is clockwise rotation or "backward".
-        else if ((prevState_ == 0x2 && currState_ == 0x1) ||
-                 (prevState_ == 0x1 && currState_ == 0x2)) {
-
-            pulses_--;
-
-        }
-
-    } else if (encoding_ == X4_ENCODING) {
-
-        //Entered a new valid state.
-        if (((currState_ ^ prevState_) != INVALID) && (currState_ != prevState_)) {
-            //2 bit state. Right hand bit of prev XOR left hand bit of current
-            //gives 0 if clockwise rotation and 1 if counter clockwise rotation.
-            change = (prevState_ & PREV_MASK) ^ ((currState_ & CURR_MASK) >> 1);
-
-            if (change == 0) {
-                change = -1;
-            }
+    prevState_ = currState_;
 
-            pulses_ -= change;
-        }
+    speed_.edge(now, pulses_);
 
+    if (maxEdgeRate_ != 0) {
+        adapt(now);
     }
 
-    prevState_ = currState_;
-
 }
 
 void QEI::index(void) {
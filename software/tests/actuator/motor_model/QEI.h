@@ -130,18 +130,14 @@
  * Includes
  */
 #include "mbed.h"
-
-/**
- * Defines
- */
-#define PREV_MASK 0x1 //Mask for the previous state in determining direction
-//of rotation.
-#define CURR_MASK 0x2 //Mask for the current state in determining direction
-//of rotation.
-#define INVALID   0x3 //XORing two states where both bits have changed.
+#include "qeitable.h"
+#include "encspeed.h"
 
 /**
  * Quadrature Encoder Interface.
+ *
+ * reset(), getPulses() and getRevolutions() are virtual so a backend such as
+ * QEITimer can do the counting some other way.
  */
 class QEI {
 
@@ -149,8 +145,9 @@ public:
 
     typedef enum Encoding {
 
-        X2_ENCODING,
-        X4_ENCODING
+        X2_ENCODING = QEI_MODE_X2,
+        X4_ENCODING = QEI_MODE_X4,
+        X1_ENCODING = QEI_MODE_X1
 
     } Encoding;
 
@@ -174,16 +171,20 @@ public:
      * @param encoding The encoding to use. Uses X2 encoding by default. X2
      *                 encoding uses interrupts on the rising and falling edges
      *                 of only channel A where as X4 uses them on both
-     *                 channels.
+     *                 channels and X1 on the rising edge of channel A only.
+     *                 getPulses() counts in this encoding whatever
+     *                 setEncoding() or setAdaptive() do later.
      */
     QEI(PinName channelA, PinName channelB, PinName index, int pulsesPerRev, Encoding encoding = X2_ENCODING);
 
+    virtual ~QEI();
+
     /**
      * Reset the encoder.
      *
      * Sets the pulses and revolutions count to zero.
      */
-    void reset(void);
+    virtual void reset(void);
 
     /**
      * Read the state of the encoder.
@@ -199,14 +200,81 @@ public:
      *
      * @return Number of pulses which have occured.
      */
-    int getPulses(void);
+    virtual int getPulses(void);
 
     /**
      * Read the number of revolutions recorded by the encoder on the index channel.
      *
      * @return Number of revolutions which have occured on the index channel.
      */
-    int getRevolutions(void);
+    virtual int getRevolutions(void);
+
+    /**
+     * Read the number of invalid state changes seen by the encoder.
+     *
+     * In X4 mode both channels changed between two edges, in X2 mode channel
+     * A did not change between two of its own edges. Either way an edge was
+     * missed. Not cleared by reset().
+     *
+     * @return Number of invalid state changes which have occured.
+     */
+    int getInvalid(void);
+
+    /**
+     * Change the encoding used to decode the edges.
+     *
+     * The pulse count carries on unchanged and in the units of the encoding
+     * given to the constructor. No effect on a backend such as QEITimer.
+     *
+     * @param encoding The encoding to switch to.
+     */
+    void setEncoding(Encoding encoding);
+
+    /**
+     * Read the encoding currently used to decode the edges.
+     */
+    Encoding getEncoding(void);
+
+    /**
+     * Switch encoding by itself to cap the interrupt rate.
+     *
+     * Every QEI_RATE_WINDOW_US the edge rate is measured in the interrupt.
+     * X4 gives way to X2 when it would need more than maxEdgeRate interrupts
+     * a second, X2 to X1 at twice that speed, and each comes back at half
+     * the speed it left at. At a standstill in X1 nothing is measured until
+     * the wheel turns again. X1 cannot tell a chattering channel A from
+     * motion, so keep maxEdgeRate high enough that X1 is only used at speed.
+     * No effect on a backend such as QEITimer.
+     *
+     * @param maxEdgeRate Interrupts a second to stay under, 0 to stop
+     *                    switching.
+     */
+    void setAdaptive(int maxEdgeRate);
+
+    /**
+     * Read the speed worked out from the times of the last edges.
+     *
+     * Period based at low speed, counted over the call interval at high
+     * speed, see ENCSPEED. Call it at a steady rate, the controller
+     * interval is a good one.
+     *
+     * @return Speed and its uncertainty in pulses per second of the
+     *         constructor encoding, with the time of the newest edge used.
+     */
+    virtual enc_speed_t getVelocity(void);
+
+protected:
+
+    /**
+     * Constructor for backends, attaches no interrupts.
+     *
+     * @param pulsesPerRev Number of pulses in one revolution.
+     * @param encoding The encoding to use.
+     */
+    QEI(int pulsesPerRev, Encoding encoding);
+
+    Encoding encoding_;
+    int      pulsesPerRev_;
 
 private:
 
@@ -226,18 +294,42 @@ private:
      */
     void index(void);
 
-    Encoding encoding_;
+    /**
+     * Measure the edge rate and change encoding if needed, from encode().
+     */
+    void adapt(uint32_t now);
 
-    InterruptIn channelA_;
-    InterruptIn channelB_;
-    InterruptIn index_;
+    /**
+     * Bring the count up to the channels, then decode with a new encoding.
+     *
+     * Interrupts must be off or this must run in one.
+     */
+    void setMode(Encoding mode);
+
+    InterruptIn *channelA_;
+    InterruptIn *channelB_;
+    InterruptIn *index_;
 
-    int          pulsesPerRev_;
     int          prevState_;
     int          currState_;
 
+    //Encoding in use, its transition table and invalid transitions.
+    Encoding      mode_;
+    const int8_t *table_;
+    int           invalidMask_;
+
+    //Adaptive encoding, 0 if off.
+    int          maxEdgeRate_;
+    uint32_t     windowStart_;
+    int          windowPulses_;
+
+    //Times of the last edges.
+    ENCSPEED     speed_;
+
+    //Count in X4 steps.
     volatile int pulses_;
     volatile int revolutions_;
+    volatile int invalid_;
 
 };
 
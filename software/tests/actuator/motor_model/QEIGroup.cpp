@@ -0,0 +1,69 @@
+/* @file QEIGroup.cpp
+*
+* This file contains the group latch that samples several encoders at once.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "QEIGroup.h"
+
+//------------------------------------------------------------------------------
+
+QEIGroup::QEIGroup()
+{
+
+    _size = 0;
+    _lastTime = us_ticker_read();
+    for (int i = 0; i < QEIGROUP_MAX; i++) {
+        _encoders[i] = NULL;
+        _last[i] = 0;
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+int QEIGroup::add(QEI &encoder)
+{
+
+    if (_size >= QEIGROUP_MAX) {
+        return -1;
+    }
+
+    core_util_critical_section_enter();
+    _encoders[_size] = &encoder;
+    _last[_size] = encoder.getPulses();
+    core_util_critical_section_exit();
+
+    return _size++;
+
+}
+
+//------------------------------------------------------------------------------
+
+void QEIGroup::latch(qei_latch_t *latch)
+{
+
+    int i;
+
+    // Counts and time from the same instant, the edge interrupts wait
+    core_util_critical_section_enter();
+    latch->time = us_ticker_read();
+    for (i = 0; i < _size; i++) {
+        latch->count[i] = _encoders[i]->getPulses();
+    }
+    core_util_critical_section_exit();
+
+    latch->dt = latch->time - _lastTime;
+    _lastTime = latch->time;
+    for (i = 0; i < QEIGROUP_MAX; i++) {
+        if (i < _size) {
+            latch->delta[i] = latch->count[i] - _last[i];
+            _last[i] = latch->count[i];
+        } else {
+            latch->count[i] = 0;
+            latch->delta[i] = 0;
+        }
+    }
+
+}
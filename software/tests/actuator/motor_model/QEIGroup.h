@@ -0,0 +1,81 @@
+/* @file QEIGroup.h
+*
+* This file contains the group latch that samples several encoders at once.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef QEIGROUP_H
+#define QEIGROUP_H
+
+#include "mbed.h"
+#include "QEI.h"
+
+// Most encoders in a group
+#define QEIGROUP_MAX 4
+
+//------------------------------------------------------------------------------
+/* Counts of every encoder in a group taken at one instant */
+
+typedef struct
+{
+    uint32_t time;              // us_ticker time of the latch
+    uint32_t dt;                // us since the previous latch
+    int count[QEIGROUP_MAX];    // Pulse counts, in add() order
+    int delta[QEIGROUP_MAX];    // Pulses since the previous latch
+} qei_latch_t;
+
+//------------------------------------------------------------------------------
+/** @brief   Samples a set of encoders together and returns their movement.
+*   @details Reading each encoder with getPulses() then reset() loses any
+*            pulse that lands between the two calls, and left and right end
+*            up sampled at different times. latch() reads every count and
+*            the time with interrupts off, so they all belong to the same
+*            instant, and returns the change since the previous latch
+*            without resetting anything, so no pulse is lost.
+*
+*            The encoders keep counting on their own, getPulses() on each
+*            still works. Do not reset() them while grouped or the next
+*            delta jumps.
+*/
+
+class QEIGroup
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor for an empty group, the first delta runs from here.
+    */
+
+    QEIGroup();
+
+    //--------------------------------------------------------------------------
+    /** Adds an encoder, its first delta runs from now.
+    *
+    *   @param encoder Encoder to add, QEI or a backend such as QEITimer.
+    *   @return        Its index in qei_latch_t, -1 if the group is full.
+    */
+
+    int add(QEI &encoder);
+
+    //--------------------------------------------------------------------------
+    /** Reads every encoder at one instant.
+    *
+    *   @param latch Filled with the counts, the deltas and the time.
+    */
+
+    void latch(qei_latch_t *latch);
+
+private:
+
+    QEI *_encoders[QEIGROUP_MAX];
+    int _size;
+
+    // Previous latch
+    int _last[QEIGROUP_MAX];
+    uint32_t _lastTime;
+
+}; // end of class qeigroup
+
+#endif
@@ -0,0 +1,216 @@
+/* @file QEITimer.cpp
+*
+* This file contains the timer encoder mode backend for QEI.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "QEITimer.h"
+#include "pinmap.h"
+
+//------------------------------------------------------------------------------
+/* Encoder pin pairs */
+
+typedef struct
+{
+    PinName a;      // CH1
+    PinName b;      // CH2
+    TIM_TypeDef *tim;
+    int af;
+    IRQn_Type up;
+    IRQn_Type cc;
+} encoder_pins_t;
+
+static const encoder_pins_t encoderPins[] = {
+    {PB_6, PB_7, TIM4, GPIO_AF2_TIM4, TIM4_IRQn,           TIM4_IRQn},
+    {PA_8, PA_9, TIM1, GPIO_AF1_TIM1, TIM1_UP_TIM10_IRQn,  TIM1_CC_IRQn},
+    {PA_0, PA_1, TIM2, GPIO_AF1_TIM2, TIM2_IRQn,           TIM2_IRQn},
+    {PC_6, PC_7, TIM8, GPIO_AF3_TIM8, TIM8_UP_TIM13_IRQn,  TIM8_CC_IRQn},
+};
+
+// Encoders in use, searched by the interrupt handlers
+static TIMENCODER *encoders[ENCODER_MAX_TIMERS];
+static int encoderCount = 0;
+
+//------------------------------------------------------------------------------
+
+QEITimer::QEITimer(PinName channelA, PinName channelB, int pulsesPerRev,
+                   Encoding encoding) : QEI(pulsesPerRev, encoding)
+{
+
+    const encoder_pins_t *ep = NULL;
+    bool swapped = false;
+    uint32_t vector;
+
+    for (unsigned int i = 0; i < sizeof(encoderPins) / sizeof(encoderPins[0]); i++) {
+        if (encoderPins[i].a == channelA && encoderPins[i].b == channelB) {
+            ep = &encoderPins[i];
+        }
+        if (encoderPins[i].a == channelB && encoderPins[i].b == channelA) {
+            ep = &encoderPins[i];
+            swapped = true;
+        }
+    }
+    if (ep == NULL || encoderCount >= ENCODER_MAX_TIMERS) {
+        error("QEITimer: no encoder timer on pins %d, %d\r\n", channelA, channelB);
+    }
+
+    if (ep->tim == TIM1) {
+        __HAL_RCC_TIM1_CLK_ENABLE();
+        vector = (uint32_t)&QEITimer::tim1Irq;
+    } else if (ep->tim == TIM2) {
+        __HAL_RCC_TIM2_CLK_ENABLE();
+        vector = (uint32_t)&QEITimer::tim2Irq;
+    } else if (ep->tim == TIM4) {
+        __HAL_RCC_TIM4_CLK_ENABLE();
+        vector = (uint32_t)&QEITimer::tim4Irq;
+    } else {
+        __HAL_RCC_TIM8_CLK_ENABLE();
+        vector = (uint32_t)&QEITimer::tim8Irq;
+    }
+
+    pin_function(channelA, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_PULLUP, ep->af));
+    pin_function(channelB, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_PULLUP, ep->af));
+
+    // With A on TI1 encoder mode counts down where QEI counts up (RM0390
+    // table "Counting direction versus encoder signals"). X1 counts X2 and
+    // halves it, there is no single edge encoder mode.
+    _enc = new TIMENCODER(ep->tim, encoding == X4_ENCODING, !swapped);
+    _zero = 0;
+    _speedValid = false;
+    _speedTime = 0;
+    _speedCount = 0;
+
+    core_util_critical_section_enter();
+    encoders[encoderCount++] = _enc;
+    _enc->interrupt(true);
+    core_util_critical_section_exit();
+
+    NVIC_SetVector(ep->up, vector);
+    NVIC_SetVector(ep->cc, vector);
+    NVIC_EnableIRQ(ep->up);
+    NVIC_EnableIRQ(ep->cc);
+
+}
+
+//------------------------------------------------------------------------------
+
+int32_t QEITimer::count(void)
+{
+
+    int32_t c;
+
+    core_util_critical_section_enter();
+    c = _enc->count();
+    core_util_critical_section_exit();
+    return c;
+
+}
+
+//------------------------------------------------------------------------------
+
+void QEITimer::reset(void)
+{
+
+    _zero = count();
+
+}
+
+//------------------------------------------------------------------------------
+
+int QEITimer::getPulses(void)
+{
+
+    int32_t c = count() - _zero;
+
+    return encoding_ == X1_ENCODING ? c >> 1 : c;
+
+}
+
+//------------------------------------------------------------------------------
+
+int QEITimer::getRevolutions(void)
+{
+
+    int edges = encoding_ == X4_ENCODING ? 4 : (encoding_ == X2_ENCODING ? 2 : 1);
+
+    return getPulses() / (pulsesPerRev_ * edges);
+
+}
+
+//------------------------------------------------------------------------------
+
+enc_speed_t QEITimer::getVelocity(void)
+{
+
+    uint32_t now = us_ticker_read();
+    int32_t c = count();
+    float scale = encoding_ == X1_ENCODING ? 0.5f : 1.0f;
+    enc_speed_t speed;
+
+    speed.time = now;
+    speed.rate = 0.0f;
+    speed.sigma = 1000000.0f / ENCSPEED_TIMEOUT_US;
+    speed.counts = 0;
+
+    if (_speedValid && now != _speedTime) {
+        speed.rate = (c - _speedCount) * scale * 1000000.0f / (now - _speedTime);
+        speed.sigma = scale * 1000000.0f / (now - _speedTime);
+        speed.counts = (int)((c > _speedCount ? c - _speedCount : _speedCount - c) * scale);
+    }
+    _speedValid = true;
+    _speedTime = now;
+    _speedCount = c;
+
+    return speed;
+
+}
+
+//------------------------------------------------------------------------------
+
+void QEITimer::dispatch(TIM_TypeDef *tim)
+{
+
+    for (int i = 0; i < encoderCount; i++) {
+        if (encoders[i]->timer() == tim) {
+            encoders[i]->irq();
+        }
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void QEITimer::tim1Irq(void)
+{
+
+    dispatch(TIM1);
+
+}
+
+//------------------------------------------------------------------------------
+
+void QEITimer::tim2Irq(void)
+{
+
+    dispatch(TIM2);
+
+}
+
+//------------------------------------------------------------------------------
+
+void QEITimer::tim4Irq(void)
+{
+
+    dispatch(TIM4);
+
+}
+
+//------------------------------------------------------------------------------
+
+void QEITimer::tim8Irq(void)
+{
+
+    dispatch(TIM8);
+
+}
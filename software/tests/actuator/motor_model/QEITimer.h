@@ -0,0 +1,89 @@
+/* @file QEITimer.h
+*
+* This file contains the timer encoder mode backend for QEI.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef QEITIMER_H
+#define QEITIMER_H
+
+#include "mbed.h"
+#include "QEI.h"
+#include "timencoder.h"
+
+// Most timer encoders in use at once
+#define ENCODER_MAX_TIMERS 4
+
+//------------------------------------------------------------------------------
+/** @brief   QEI that lets a timer in encoder mode count the pulses.
+*   @details Same API as QEI, but no interrupt runs per edge: the timer
+*            counts both channels in hardware and three guard interrupts per
+*            65536 counts keep the 32 bit count exact. getRevolutions() is
+*            worked out from the count, as there is no index channel.
+*            setEncoding() and setAdaptive() do nothing, the timer keeps
+*            up with any edge rate in its constructor encoding. Edges are
+*            not timed either, getVelocity() counts over the call interval
+*            and is only good to a count per interval.
+*
+*            The two channels must be CH1 and CH2 of one timer, in either
+*            order (swapped pins count the same way, X2 then uses channel B):
+*            PB_6/PB_7  TIM4
+*            PA_8/PA_9  TIM1 (not with the ESTO capture on TIM1)
+*            PA_0/PA_1  TIM2 (not with the THRO capture on TIM2)
+*            PC_6/PC_7  TIM8 (not with the LRIN capture or SBUS)
+*            The vehicle encoders on PA_8/PB_10 and PB_7/PC_13 are not on
+*            such pairs, see ENC1A to ENC2B in pinout.h for the rewiring.
+*/
+
+class QEITimer : public QEI
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor that claims the timer of a pin pair.
+    *
+    * Stops with error() if the pins are not in the encoder table.
+    *
+    *   @param channelA     Channel A pin.
+    *   @param channelB     Channel B pin.
+    *   @param pulsesPerRev Number of pulses in one revolution.
+    *   @param encoding     QEI::X4_ENCODING counts the edges of both
+    *                       channels, QEI::X2_ENCODING those of channel A,
+    *                       QEI::X1_ENCODING every other one of those.
+    */
+
+    QEITimer(PinName channelA, PinName channelB, int pulsesPerRev,
+             Encoding encoding = X4_ENCODING);
+
+    //--------------------------------------------------------------------------
+    /** Same as QEI.
+    */
+
+    virtual void reset(void);
+    virtual int getPulses(void);
+    virtual int getRevolutions(void);
+    virtual enc_speed_t getVelocity(void);
+
+private:
+
+    int32_t count(void);
+
+    static void dispatch(TIM_TypeDef *tim);
+    static void tim1Irq(void);
+    static void tim2Irq(void);
+    static void tim4Irq(void);
+    static void tim8Irq(void);
+
+    TIMENCODER *_enc;
+    int32_t _zero;
+
+    // Count at the previous getVelocity()
+    bool _speedValid;
+    uint32_t _speedTime;
+    int32_t _speedCount;
+
+}; // end of class qeitimer
+
+#endif
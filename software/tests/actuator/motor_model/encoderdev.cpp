@@ -0,0 +1,109 @@
+/* @file encoderdev.cpp
+*
+* Host test of the timer encoder backend against mock TIM registers.
+*
+* g++ -I../../mbed -o encoderdev encoderdev.cpp timencoder.cpp && ./encoderdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include "timencoder.h"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+// Moves the mock counter the way the timer would and raises the guard
+// flags it passes, then runs the handler if the interrupt is on
+void turn(TIM_TypeDef *tim, TIMENCODER &enc, int counts) {
+    int step = counts > 0 ? 1 : -1;
+
+    for (; counts != 0; counts -= step) {
+        uint16_t cnt = (uint16_t)(tim->CNT + step);
+        tim->CNT = cnt;
+        if ((step > 0 && cnt == 0) || (step < 0 && cnt == 0xFFFF)) {
+            tim->SR |= 0x01;
+        }
+        if (cnt == tim->CCR3) {
+            tim->SR |= 0x08;
+        }
+        if (cnt == tim->CCR4) {
+            tim->SR |= 0x10;
+        }
+        if (tim->SR & tim->DIER) {
+            enc.irq();
+            check("guard flags cleared", tim->SR & 0x19, 0);
+            tim->SR = 0;
+        }
+    }
+}
+
+int main() {
+    TIM_TypeDef tim4, tim1;
+
+    // X4 on TIM4
+    memset(&tim4, 0xA5, sizeof(tim4));
+    tim4.SR = 0;
+    tim4.DIER = 0;
+    TIMENCODER enc(&tim4, true);
+    check("SMCR encoder mode 3", tim4.SMCR, 0x3);
+    check("CCMR1 IC1/IC2 on TI1/TI2", tim4.CCMR1, 0x3131);
+    check("CCMR2 compares", tim4.CCMR2, 0);
+    check("CCER", tim4.CCER, 0x11);
+    check("PSC", tim4.PSC, 0);
+    check("ARR", tim4.ARR, 0xFFFF);
+    check("CNT", tim4.CNT, 0);
+    check("running", tim4.CR1 & 1, 1);
+    check("no interrupt yet", tim4.DIER, 0);
+    check("start", enc.count(), 0);
+
+    // Polled often enough the count runs on past 16 bits both ways
+    turn(&tim4, enc, 30000);
+    check("forward", enc.count(), 30000);
+    turn(&tim4, enc, 30000);
+    check("forward past wrap", enc.count(), 60000);
+    turn(&tim4, enc, 30000);
+    check("forward two wraps", enc.count(), 90000);
+    for (int i = 0; i < 4; i++) {
+        turn(&tim4, enc, -25000);
+        enc.count();
+    }
+    check("backward below zero", enc.count(), -10000);
+
+    // Polled too slowly a wrap would be lost, the guard interrupts stop that
+    enc.interrupt(true);
+    check("guard interrupts", tim4.DIER, 0x19);
+    turn(&tim4, enc, 300000);
+    check("unpolled forward", enc.count(), 290000);
+    turn(&tim4, enc, -400000);
+    check("unpolled backward", enc.count(), -110000);
+
+    // Dithering across a compare point only costs an interrupt per crossing
+    turn(&tim4, enc, 3);
+    turn(&tim4, enc, -3);
+    turn(&tim4, enc, 3);
+    check("dither", enc.count(), -109997);
+
+    enc.interrupt(false);
+    check("guard interrupts off", tim4.DIER, 0);
+
+    // X2 reversed on TIM1
+    memset(&tim1, 0, sizeof(tim1));
+    TIMENCODER rev(&tim1, false, true);
+    check("SMCR encoder mode 1", tim1.SMCR, 0x1);
+    check("CCER TI1 inverted", tim1.CCER, 0x13);
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,130 @@
+/* @file encspeed.cpp
+*
+* This file contains the edge timestamp speed estimator used by QEI.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "encspeed.h"
+
+#define EDGE_MASK (ENCSPEED_EDGES - 1)
+
+//------------------------------------------------------------------------------
+
+ENCSPEED::ENCSPEED(uint32_t window): _window(window)
+{
+
+    clear();
+
+}
+
+//------------------------------------------------------------------------------
+
+void ENCSPEED::edge(uint32_t time, int32_t count)
+{
+
+    _time[_head] = time;
+    _count[_head] = count;
+    _head = (_head + 1) & EDGE_MASK;
+    if (_size < ENCSPEED_EDGES) {
+        _size++;
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void ENCSPEED::offset(int32_t delta)
+{
+
+    for (unsigned int i = 0; i < ENCSPEED_EDGES; i++) {
+        _count[i] += delta;
+    }
+    _refCount += delta;
+
+}
+
+//------------------------------------------------------------------------------
+
+void ENCSPEED::clear(void)
+{
+
+    for (unsigned int i = 0; i < ENCSPEED_EDGES; i++) {
+        _time[i] = 0;
+        _count[i] = 0;
+    }
+    _head = 0;
+    _size = 0;
+    _ref = false;
+    _refTime = 0;
+    _refCount = 0;
+
+}
+
+//------------------------------------------------------------------------------
+
+enc_speed_t ENCSPEED::estimate(uint32_t now)
+{
+
+    enc_speed_t s;
+    unsigned int newest = (_head - 1) & EDGE_MASK;
+    uint32_t t0 = _time[newest], tk = t0, span, since;
+    int32_t c0 = _count[newest], ck = c0;
+    float bound;
+
+    s.time = t0;
+    s.rate = 0.0f;
+    s.sigma = 1000000.0f / ENCSPEED_TIMEOUT_US;
+    s.counts = 0;
+
+    if (_size == 0 || now - t0 > ENCSPEED_TIMEOUT_US) {
+        _ref = false;
+        return s;
+    }
+
+    // Oldest edge inside the window, or at least the one before the newest
+    for (unsigned int i = 1; i < _size; i++) {
+        unsigned int k = (newest - i) & EDGE_MASK;
+        if (i > 1 && t0 - _time[k] > _window) {
+            break;
+        }
+        tk = _time[k];
+        ck = _count[k];
+    }
+
+    // More edges since the last estimate than the ring holds
+    if (_ref && t0 - _refTime <= _window && t0 - _refTime > t0 - tk) {
+        tk = _refTime;
+        ck = _refCount;
+    }
+
+    _ref = true;
+    _refTime = t0;
+    _refCount = c0;
+
+    span = t0 - tk;
+    if (span == 0) {
+        // A single edge, only the time since it says anything
+        s.sigma = 1000000.0f / (now - t0 > 0 ? now - t0 : 1);
+        return s;
+    }
+
+    s.counts = c0 > ck ? c0 - ck : ck - c0;
+    s.rate = (float)(c0 - ck) * 1000000.0f / span;
+    s.sigma = 1.41421f * (ENCSPEED_SPACING +
+                          (s.rate < 0 ? -s.rate : s.rate) * ENCSPEED_JITTER_US * 1e-6f) *
+              1000000.0f / span;
+
+    // Next edge overdue, the wheel is turning slower than one more count
+    // right now would mean
+    since = now - t0;
+    if (s.counts != 0 && (uint64_t)since * s.counts > span) {
+        bound = 1000000.0f / since;
+        s.rate = s.rate < 0 ? -bound : bound;
+        s.sigma = bound / 2;
+        s.counts = 0;
+    }
+
+    return s;
+
+}
@@ -0,0 +1,121 @@
+/* @file encspeed.h
+*
+* This file contains the edge timestamp speed estimator used by QEI. It has
+* no mbed dependencies so it can be checked on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef ENCSPEED_H
+#define ENCSPEED_H
+
+#include <stdint.h>
+
+// Edge timestamps kept, a power of 2
+#define ENCSPEED_EDGES 16
+
+// Longest span the estimate averages over, more than the call interval (us)
+#define ENCSPEED_WINDOW_US 50000
+
+// No edge for this long reads as stopped (us)
+#define ENCSPEED_TIMEOUT_US 250000
+
+// Spread of the edge interrupt latency (us)
+#define ENCSPEED_JITTER_US 2
+
+// Spread of the edge positions on the disc, in counts
+#define ENCSPEED_SPACING 0.25f
+
+//------------------------------------------------------------------------------
+/* Speed estimate */
+
+typedef struct
+{
+    uint32_t time;      // us_ticker time of the newest edge used
+    float rate;         // Speed (counts/s)
+    float sigma;        // Standard uncertainty of rate (counts/s)
+    int counts;         // Counts the estimate spans, 0 if it is only a bound
+} enc_speed_t;
+
+//------------------------------------------------------------------------------
+/** @brief   Works out encoder speed from the times of its last edges.
+*   @details Counting pulses over a fixed interval gives 0 or 1 count per
+*            interval at low speed. Here every edge is stored with its time
+*            and count, and the speed is the counts between two edges over
+*            the time between them, so the only errors are the edge timing
+*            and spacing, not a whole count.
+*
+*            At low speed the span is the oldest stored edge inside the
+*            window, down to a single period between the last two edges. At
+*            high speed the ring covers less than the window, so the span
+*            runs from the newest edge of the previous estimate instead:
+*            counting over the call interval, still edge to edge.
+*
+*            Once the next edge is overdue the rate can only have dropped,
+*            the estimate becomes one count over the time since the last
+*            edge, an upper bound, and reaches zero after
+*            ENCSPEED_TIMEOUT_US.
+*
+*            edge() runs in the edge interrupt, the caller masks interrupts
+*            around the other methods.
+*/
+
+class ENCSPEED
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor.
+    *
+    *   @param window Span to average over at speed (us).
+    */
+
+    ENCSPEED(uint32_t window = ENCSPEED_WINDOW_US);
+
+    //--------------------------------------------------------------------------
+    /** Stores an edge.
+    *
+    *   @param time  us_ticker time of the edge.
+    *   @param count Count after the edge.
+    */
+
+    void edge(uint32_t time, int32_t count);
+
+    //--------------------------------------------------------------------------
+    /** Moves every stored count, for a reset of the count.
+    */
+
+    void offset(int32_t delta);
+
+    //--------------------------------------------------------------------------
+    /** Forgets every edge.
+    */
+
+    void clear(void);
+
+    //--------------------------------------------------------------------------
+    /** Returns the speed at a time after the newest edge.
+    *
+    *   Call it regularly, it remembers the newest edge for the next span.
+    */
+
+    enc_speed_t estimate(uint32_t now);
+
+private:
+
+    uint32_t _window;
+
+    uint32_t _time[ENCSPEED_EDGES];
+    int32_t _count[ENCSPEED_EDGES];
+    unsigned int _head;     // Next slot
+    unsigned int _size;     // Edges stored
+
+    // Newest edge at the previous estimate
+    bool _ref;
+    uint32_t _refTime;
+    int32_t _refCount;
+
+}; // end of class encspeed
+
+#endif
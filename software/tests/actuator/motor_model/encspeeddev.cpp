@@ -0,0 +1,164 @@
+/* @file encspeeddev.cpp
+*
+* Host check of the edge timestamp speed estimator, against counting pulses
+* per control interval as the tests used to.
+*
+* g++ -O2 -o encspeeddev encspeeddev.cpp encspeed.cpp && ./encspeeddev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "encspeed.h"
+
+#define INTERVAL_US 28000   // Control interval of the accel test
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+void near(const char *what, float got, float want, float tol) {
+    if (fabs(got - want) > tol) {
+        printf("FAIL %s: got %f want %f\n", what, got, want);
+        failed++;
+    }
+}
+
+//------------------------------------------------------------------------------
+/* A wheel turning at a set rate, edges with interrupt jitter. */
+
+typedef struct
+{
+    double pos;         // Counts
+    int32_t count;      // Whole counts the decoder has seen
+    uint32_t now;       // us
+} wheel_t;
+
+void run(wheel_t *w, ENCSPEED *speed, double rate, uint32_t us) {
+    for (uint32_t t = 0; t < us; t++) {
+        w->now++;
+        w->pos += rate / 1000000.0;
+        while (floor(w->pos) > w->count) {
+            w->count++;
+            speed->edge(w->now + rand() % (ENCSPEED_JITTER_US + 1), w->count);
+        }
+        while (floor(w->pos) < w->count) {
+            w->count--;
+            speed->edge(w->now + rand() % (ENCSPEED_JITTER_US + 1), w->count);
+        }
+    }
+}
+
+// RMS error of both estimators over a second at a steady rate
+void compare(double rate) {
+    ENCSPEED speed;
+    wheel_t w = {0.3, 0, 1000};
+    enc_speed_t s;
+    int32_t last;
+    double errEdge = 0, errCount = 0, sigma = 0;
+    int n;
+
+    run(&w, &speed, rate, 500000);
+    speed.estimate(w.now);
+    last = w.count;
+    for (n = 0; n < 40; n++) {
+        run(&w, &speed, rate, INTERVAL_US);
+        s = speed.estimate(w.now);
+        errEdge += (s.rate - rate) * (s.rate - rate);
+        sigma += s.sigma * s.sigma;
+        errCount += pow((w.count - last) * 1000000.0 / INTERVAL_US - rate, 2);
+        last = w.count;
+    }
+    printf("%10.1f %12.2f %12.2f %12.2f\n", rate, sqrt(errCount / n),
+           sqrt(errEdge / n), sqrt(sigma / n));
+    if (sqrt(errEdge / n) > 3 * sqrt(sigma / n) + 0.01) {
+        printf("FAIL %.1f counts/s: error beyond the uncertainty\n", rate);
+        failed++;
+    }
+    if (sqrt(errEdge / n) > sqrt(errCount / n)) {
+        printf("FAIL %.1f counts/s: worse than counting\n", rate);
+        failed++;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+int main() {
+    ENCSPEED speed;
+    wheel_t w = {0.5, 0, 1000};
+    enc_speed_t s;
+    uint32_t stopped;
+
+    srand(7);
+
+    // Nothing yet
+    s = speed.estimate(w.now);
+    near("no edges", s.rate, 0, 0);
+    check("no edges counts", s.counts, 0);
+
+    // Slow: 20 counts/s, one or none per interval
+    run(&w, &speed, 20.0, 300000);
+    s = speed.estimate(w.now);
+    near("slow", s.rate, 20.0, 0.2);
+    check("slow is a period", s.counts, 1);
+
+    // Fast: the span runs from the previous estimate
+    run(&w, &speed, 4000.0, INTERVAL_US);
+    speed.estimate(w.now);
+    run(&w, &speed, 4000.0, INTERVAL_US);
+    s = speed.estimate(w.now);
+    near("fast", s.rate, 4000.0, 20.0);
+    if (s.counts < 100) {
+        printf("FAIL fast span only %d counts\n", s.counts);
+        failed++;
+    }
+
+    // Backward
+    run(&w, &speed, -300.0, 200000);
+    s = speed.estimate(w.now);
+    near("backward", s.rate, -300.0, 3.0);
+
+    // A reset of the count does not show as motion
+    speed.offset(-w.count);
+    w.pos -= w.count;
+    w.count = 0;
+    run(&w, &speed, -300.0, INTERVAL_US);
+    s = speed.estimate(w.now);
+    near("after offset", s.rate, -300.0, 3.0);
+
+    // Stopping: at most one count over the time since the last edge, then 0
+    stopped = w.now;
+    run(&w, &speed, 0.0, 100000);
+    s = speed.estimate(w.now);
+    if (s.rate > 0 || s.rate < -1000000.0f / (w.now - stopped) - 1) {
+        printf("FAIL stopping bound %f\n", s.rate);
+        failed++;
+    }
+    check("stopping is a bound", s.counts, 0);
+    run(&w, &speed, 0.0, ENCSPEED_TIMEOUT_US);
+    s = speed.estimate(w.now);
+    near("stopped", s.rate, 0, 0);
+
+    printf("%10s %12s %12s %12s\n", "counts/s", "count err", "edge err", "edge sigma");
+    compare(3.0);
+    compare(15.0);
+    compare(80.0);
+    compare(700.0);
+    compare(6100.0);
+    compare(-2530.0);
+    printf("RMS over a 28 ms interval, jitter %d us\n", ENCSPEED_JITTER_US);
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,358 @@
+/* @file qeidev.cpp
+*
+* Host check and microbenchmark of the table driven QEI decoder against the
+* branching decoder it replaced, and check of switching between X4, X2 and
+* X1 through the same helpers QEI::setMode() and QEI::adapt() use.
+*
+* On an x86 host the table is up to about a cycle per edge slower than the
+* legacy decoder, as it also counts invalid transitions. The cycle counts
+* are host only, nothing here measures the Cortex-M4.
+*
+* g++ -O2 -o qeidev qeidev.cpp && ./qeidev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "qeitable.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() ((unsigned long long)clock())
+#endif
+
+#define EDGES   200000
+#define REPEATS 50
+
+// Counters are volatile in QEI, keep them so here
+static volatile int pulses_, invalid_;
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+//------------------------------------------------------------------------------
+/* Recorded style edge sequences: the 2-bit state read in each edge
+*  interrupt. A wheel is stepped through the gray code with a speed profile,
+*  reversals, chatter on one channel at standstill and now and then a missed
+*  edge, the way the bench logs looked. */
+
+typedef struct
+{
+    const char *name;
+    int x4;
+    int truth;      // Where the wheel ended up, in X4 steps
+    unsigned char states[EDGES + 1];
+} sequence_t;
+
+static const int gray[4] = {0, 1, 3, 2};
+
+void record(sequence_t *seq, const char *name, int x4, int reverseEvery,
+            int chatterEvery, int missEvery) {
+    int phase = 0, dir = 1, i;
+
+    seq->name = name;
+    seq->x4 = x4;
+    seq->truth = 0;
+    srand(1234);
+    seq->states[0] = gray[0];
+    for (i = 1; i <= EDGES; i++) {
+        if (reverseEvery && i % reverseEvery == 0) {
+            dir = -dir;
+        }
+        if (chatterEvery && i % chatterEvery == 0) {
+            // B bounces, back and forth on the same step
+            seq->states[i] = gray[phase] ^ 1;
+            continue;
+        }
+        // X2 only samples on A edges, two gray steps apart
+        phase = (phase + dir * (x4 ? 1 : 2) + 4) & 3;
+        seq->truth += dir * (x4 ? 1 : 2);
+        if (missEvery && rand() % missEvery == 0) {
+            phase = (phase + dir * (x4 ? 1 : 2) + 4) & 3;
+            seq->truth += dir * (x4 ? 1 : 2);
+        }
+        seq->states[i] = gray[phase];
+    }
+}
+
+//------------------------------------------------------------------------------
+/* QEI::encode() before the tables, with the pin reads taken out. */
+
+#define PREV_MASK 0x1
+#define CURR_MASK 0x2
+#define INVALID   0x3
+
+__attribute__((noinline)) int legacy(const sequence_t *seq) {
+    int change, i;
+    int prevState = seq->states[0], currState;
+
+    pulses_ = 0;
+
+    for (i = 1; i <= EDGES; i++) {
+        currState = seq->states[i];
+        change = 0;
+        if (!seq->x4) {
+            if ((prevState == 0x3 && currState == 0x0) ||
+                    (prevState == 0x0 && currState == 0x3)) {
+                pulses_++;
+            } else if ((prevState == 0x2 && currState == 0x1) ||
+                       (prevState == 0x1 && currState == 0x2)) {
+                pulses_--;
+            }
+        } else {
+            if (((currState ^ prevState) != INVALID) && (currState != prevState)) {
+                change = (prevState & PREV_MASK) ^ ((currState & CURR_MASK) >> 1);
+                if (change == 0) {
+                    change = -1;
+                }
+                pulses_ -= change;
+            }
+        }
+        prevState = currState;
+    }
+    return pulses_;
+}
+
+//------------------------------------------------------------------------------
+/* QEI::encode() as it is now. */
+
+__attribute__((noinline)) int table(const sequence_t *seq, int *invalid) {
+    const int8_t *t = seq->x4 ? qeiStepX4 : qeiStepX2;
+    int mask = seq->x4 ? QEI_INVALID_X4 : QEI_INVALID_X2;
+    int step, i;
+    int prevState = seq->states[0], currState;
+
+    pulses_ = 0;
+    invalid_ = 0;
+    for (i = 1; i <= EDGES; i++) {
+        currState = seq->states[i];
+        step = QEI_STEP(prevState, currState);
+        pulses_ += t[step];
+        invalid_ += (mask >> step) & 1;
+        prevState = currState;
+    }
+    *invalid = invalid_;
+    return pulses_;
+}
+
+//------------------------------------------------------------------------------
+/* A wheel walked one gray step at a time, decoded from the edges each
+*  encoding interrupts on, switching encoding along the way with the catch
+*  up QEI::setMode() does. */
+
+static const int8_t *tables[3] = {qeiStepX2, qeiStepX4, qeiStepX1};
+
+typedef struct
+{
+    int phase, pos;     // Real wheel, pos in X4 steps
+    int mode, prev;     // Decoder
+    int pulses;
+} wheel_t;
+
+void setMode(wheel_t *w, int mode) {
+    int curr = gray[w->phase];
+
+    w->pulses += qeiCatchUp(w->prev, curr, w->mode);
+    w->prev = curr;
+    w->mode = mode;
+}
+
+void walk(wheel_t *w, int steps, int reverseEvery) {
+    int dir = steps > 0 ? 1 : -1, prevA, currA, curr, edge, i;
+
+    for (i = 0; i < abs(steps); i++) {
+        if (reverseEvery && rand() % reverseEvery == 0) {
+            dir = -dir;
+        }
+        prevA = gray[w->phase] >> 1;
+        w->phase = (w->phase + dir + 4) & 3;
+        w->pos += dir;
+        curr = gray[w->phase];
+        currA = curr >> 1;
+        // X4 interrupts on every edge, X2 on A edges, X1 on A rising
+        edge = w->mode == QEI_MODE_X4 ||
+               (currA != prevA && (w->mode == QEI_MODE_X2 || currA));
+        if (edge) {
+            w->pulses += tables[w->mode][QEI_STEP(w->prev, curr)];
+            w->prev = curr;
+        }
+    }
+}
+
+void switching(void) {
+    wheel_t w = {0, 0, QEI_MODE_X4, 0, 0};
+    int from, to, n;
+
+    // From X1 the last A edge was rising, so a state behind it is forward
+    // and one with A low is backward
+    check("catch up X4", qeiCatchUp(0, 1, QEI_MODE_X4), 1);
+    check("catch up X4 invalid", qeiCatchUp(0, 3, QEI_MODE_X4), 0);
+    check("catch up X2", qeiCatchUp(3, 2, QEI_MODE_X2), 1);
+    check("catch up X1 still", qeiCatchUp(3, 3, QEI_MODE_X1), 0);
+    check("catch up X1 forward 1", qeiCatchUp(3, 2, QEI_MODE_X1), 1);
+    check("catch up X1 forward 2", qeiCatchUp(3, 0, QEI_MODE_X1), 2);
+    check("catch up X1 forward 3", qeiCatchUp(3, 1, QEI_MODE_X1), 3);
+    check("catch up X1 backward 1", qeiCatchUp(2, 3, QEI_MODE_X1), -1);
+    check("catch up X1 backward 2", qeiCatchUp(2, 1, QEI_MODE_X1), -2);
+    check("catch up X1 backward 3", qeiCatchUp(2, 0, QEI_MODE_X1), -3);
+
+    srand(99);
+    walk(&w, 5000, 3);
+    check("X4 random walk", w.pulses, w.pos);
+    setMode(&w, QEI_MODE_X2);
+    walk(&w, -5000, 3);
+    setMode(&w, QEI_MODE_X2);
+    check("X2 random walk", w.pulses, w.pos);
+
+    // Every switch at every phase, X1 only while turning one way as it is
+    // only used at speed
+    for (from = 0; from < 3; from++) {
+        for (to = 0; to < 3; to++) {
+            for (n = 1; n <= 8; n++) {
+                setMode(&w, from);
+                walk(&w, 100 + n, from == QEI_MODE_X1 ? 0 : 5);
+                setMode(&w, to);
+                check("switch", w.pulses, w.pos);
+                walk(&w, -(50 + n), to == QEI_MODE_X1 ? 0 : 5);
+                // X2 and X1 lag the wheel between edges, catch up to compare
+                setMode(&w, to);
+                check("after switch", w.pulses, w.pos);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/* QEI::adapt() at the end of each window: the limit for the window, then
+*  the encoding for the next one. */
+
+void adapting(void) {
+    uint32_t limit = qeiWindowLimit(20000, QEI_RATE_WINDOW_US);
+    int mode = QEI_MODE_X4, i;
+
+    // 20000 interrupts a second over the window, a late window allows more
+    check("window limit", limit, 200);
+    check("late window limit", qeiWindowLimit(20000, 3 * QEI_RATE_WINDOW_US), 600);
+    check("long window limit", qeiWindowLimit(100000, 100000), 10000);
+
+    // Each transition, on its threshold and one past it
+    check("X4 at limit", qeiNextMode(QEI_MODE_X4, limit, limit), QEI_MODE_X4);
+    check("X4 to X2", qeiNextMode(QEI_MODE_X4, limit + 1, limit), QEI_MODE_X2);
+    check("X2 at 2 limit", qeiNextMode(QEI_MODE_X2, 2 * limit, limit), QEI_MODE_X2);
+    check("X2 to X1", qeiNextMode(QEI_MODE_X2, 2 * limit + 1, limit), QEI_MODE_X1);
+    check("X2 at limit/2", qeiNextMode(QEI_MODE_X2, limit / 2, limit), QEI_MODE_X2);
+    check("X2 to X4", qeiNextMode(QEI_MODE_X2, limit / 2 - 1, limit), QEI_MODE_X4);
+    check("X1 at limit", qeiNextMode(QEI_MODE_X1, limit, limit), QEI_MODE_X1);
+    check("X1 to X2", qeiNextMode(QEI_MODE_X1, limit - 1, limit), QEI_MODE_X2);
+    check("X1 fast", qeiNextMode(QEI_MODE_X1, 10 * limit, limit), QEI_MODE_X1);
+    check("X4 still", qeiNextMode(QEI_MODE_X4, 0, limit), QEI_MODE_X4);
+
+    // Inside the hysteresis bands nothing switches, whichever way the speed
+    // wanders: X2 holds from limit/2 to 2 limit, X1 from limit up
+    for (i = limit / 2; i <= (int)(2 * limit); i++) {
+        check("X2 band", qeiNextMode(QEI_MODE_X2, i, limit), QEI_MODE_X2);
+    }
+    for (i = limit; i <= (int)(4 * limit); i++) {
+        check("X1 band", qeiNextMode(QEI_MODE_X1, i, limit), QEI_MODE_X1);
+    }
+
+    // Speeding up to 3 limit and back down steps through every encoding
+    // once each way, and the same speed of limit is X1 on the way down and
+    // X4 once back at the bottom
+    static const int speeds[] = {100, 150, 201, 300, 401, 600, 300, 200, 150,
+                                 99, 200};
+    static const int modes[] = {QEI_MODE_X4, QEI_MODE_X4, QEI_MODE_X2,
+                                QEI_MODE_X2, QEI_MODE_X1, QEI_MODE_X1,
+                                QEI_MODE_X1, QEI_MODE_X1, QEI_MODE_X2,
+                                QEI_MODE_X4, QEI_MODE_X4};
+    for (i = 0; i < (int)(sizeof(speeds) / sizeof(speeds[0])); i++) {
+        mode = qeiNextMode(mode, speeds[i], limit);
+        check("ramp", mode, modes[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+int main() {
+    static sequence_t seqs[5];
+    unsigned long long t0, legacyCycles, tableCycles;
+    int sink = 0, invalid, n, i, r;
+
+    record(&seqs[0], "X4 steady", 1, 0, 0, 0);
+    record(&seqs[1], "X4 reversing", 1, 37, 0, 0);
+    record(&seqs[2], "X4 chatter, missed edges", 1, 500, 7, 1000);
+    record(&seqs[3], "X2 steady", 0, 0, 0, 0);
+    record(&seqs[4], "X2 reversing, missed edges", 0, 53, 0, 1000);
+    n = sizeof(seqs) / sizeof(seqs[0]);
+
+    // Unit steps of the tables
+    check("X4 forward", qeiStepX4[QEI_STEP(0, 1)] + qeiStepX4[QEI_STEP(1, 3)] +
+          qeiStepX4[QEI_STEP(3, 2)] + qeiStepX4[QEI_STEP(2, 0)], 4);
+    check("X4 backward", qeiStepX4[QEI_STEP(0, 2)] + qeiStepX4[QEI_STEP(2, 3)] +
+          qeiStepX4[QEI_STEP(3, 1)] + qeiStepX4[QEI_STEP(1, 0)], -4);
+    check("X2 forward", qeiStepX2[QEI_STEP(0, 3)] + qeiStepX2[QEI_STEP(3, 0)], 4);
+    check("X2 backward", qeiStepX2[QEI_STEP(1, 2)] + qeiStepX2[QEI_STEP(2, 1)], -4);
+    check("X1 forward", qeiStepX1[QEI_STEP(3, 3)], 4);
+    check("X1 backward", qeiStepX1[QEI_STEP(2, 2)], -4);
+
+    // Same counts as the old decoder, which counted X2 in X2 steps and lost
+    // one on each reversal
+    for (i = 0; i < n; i++) {
+        if (seqs[i].x4) {
+            check(seqs[i].name, table(&seqs[i], &invalid), legacy(&seqs[i]));
+        }
+    }
+    check("X2 steady legacy", table(&seqs[3], &invalid), 2 * legacy(&seqs[3]));
+
+    // Exact wherever no edge was missed
+    check("X4 steady truth", table(&seqs[0], &invalid), seqs[0].truth);
+    check("X4 reversing truth", table(&seqs[1], &invalid), seqs[1].truth);
+    check("X2 steady truth", table(&seqs[3], &invalid), seqs[3].truth);
+    switching();
+    adapting();
+
+    table(&seqs[0], &invalid);
+    check("steady has no invalid steps", invalid, 0);
+    table(&seqs[2], &invalid);
+    if (invalid == 0) {
+        printf("FAIL missed edges not flagged\n");
+        failed++;
+    }
+
+    printf("%-28s %10s %10s %8s\n", "sequence", "legacy", "table", "invalid");
+    for (i = 0; i < n; i++) {
+        t0 = CYCLES();
+        for (r = 0; r < REPEATS; r++) {
+            sink += legacy(&seqs[i]);
+        }
+        legacyCycles = CYCLES() - t0;
+
+        t0 = CYCLES();
+        for (r = 0; r < REPEATS; r++) {
+            sink += table(&seqs[i], &invalid);
+        }
+        tableCycles = CYCLES() - t0;
+
+        printf("%-28s %10.2f %10.2f %8d\n", seqs[i].name,
+               (double)legacyCycles / ((double)EDGES * REPEATS),
+               (double)tableCycles / ((double)EDGES * REPEATS), invalid);
+    }
+    printf("cycles per edge, host (checksum %d)\n", sink);
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
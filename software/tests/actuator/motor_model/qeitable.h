@@ -0,0 +1,142 @@
+/* @file qeitable.h
+*
+* This file contains the quadrature state transition tables used by
+* QEI::encode(), and the encoding switch arithmetic of QEI::setMode() and
+* QEI::adapt(). It has no mbed dependencies so the decoder can be
+* benchmarked and checked on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef QEITABLE_H
+#define QEITABLE_H
+
+#include <stdint.h>
+
+// Table index from the previous and current 2-bit states, state = (A << 1) | B
+#define QEI_STEP(prev, curr) (((prev) << 2) | (curr))
+
+// Encodings, in the order of QEI::Encoding
+#define QEI_MODE_X2 0
+#define QEI_MODE_X4 1
+#define QEI_MODE_X1 2
+
+#define QEI_RATE_WINDOW_US 10000 //Time over which the edge rate is measured.
+
+// Place of each state in the forward sequence 00 -> 01 -> 11 -> 10
+static const int8_t qeiGrayPos[4] = {0, 1, 3, 2};
+
+//------------------------------------------------------------------------------
+/* All tables count in X4 steps so the count carries on unchanged when the
+*  encoding changes. */
+
+//------------------------------------------------------------------------------
+/* X4: one step for every valid gray code step, 00 -> 01 -> 11 -> 10 -> 00
+*  is forward. Both bits changing at once means an edge was missed, the step
+*  counts nothing and is flagged in QEI_INVALID_X4. */
+
+static const int8_t qeiStepX4[16] = {
+//  curr 00  01  10  11
+         0, +1, -1,  0,     // prev 00
+        -1,  0,  0, +1,     // prev 01
+        +1,  0,  0, -1,     // prev 10
+         0, -1, +1,  0,     // prev 11
+};
+
+#define QEI_INVALID_X4 ((1 << QEI_STEP(0, 3)) | (1 << QEI_STEP(1, 2)) | \
+                        (1 << QEI_STEP(2, 1)) | (1 << QEI_STEP(3, 0)))
+
+//------------------------------------------------------------------------------
+/* X2: states are sampled on channel A edges only. Going forward A rises with
+*  B high and falls with B low, so A == B after a forward edge and A != B
+*  after a backward one. The step is then the distance to the new state in
+*  that direction: 2 in steady motion, 1 when the wheel turned back between
+*  two edges. A not changing means an A edge was missed; the table guesses a
+*  full cycle and flags it in QEI_INVALID_X2. */
+
+static const int8_t qeiStepX2[16] = {
+//  curr 00  01  10  11
+        +4, -3, -1, +2,     // prev 00
+        +3, -4, -2, +1,     // prev 01
+        +1, -2, -4, +3,     // prev 10
+        +2, -1, -3, +4,     // prev 11
+};
+
+#define QEI_INVALID_X2 ((1 << QEI_STEP(0, 0)) | (1 << QEI_STEP(0, 1)) | \
+                        (1 << QEI_STEP(1, 0)) | (1 << QEI_STEP(1, 1)) | \
+                        (1 << QEI_STEP(2, 2)) | (1 << QEI_STEP(2, 3)) | \
+                        (1 << QEI_STEP(3, 2)) | (1 << QEI_STEP(3, 3)))
+
+//------------------------------------------------------------------------------
+/* X1: states are sampled on rising edges of channel A only, a full cycle
+*  apart, with the direction worked out as for X2. A reading low on its own
+*  rising edge is a glitch, counts nothing and is flagged in QEI_INVALID_X1. */
+
+static const int8_t qeiStepX1[16] = {
+//  curr 00  01  10  11
+         0,  0, -1, +2,     // prev 00
+         0,  0, -2, +1,     // prev 01
+         0,  0, -4, +3,     // prev 10
+         0,  0, -3, +4,     // prev 11
+};
+
+#define QEI_INVALID_X1 ((1 << QEI_STEP(0, 0)) | (1 << QEI_STEP(0, 1)) | \
+                        (1 << QEI_STEP(1, 0)) | (1 << QEI_STEP(1, 1)) | \
+                        (1 << QEI_STEP(2, 0)) | (1 << QEI_STEP(2, 1)) | \
+                        (1 << QEI_STEP(3, 0)) | (1 << QEI_STEP(3, 1)))
+
+//------------------------------------------------------------------------------
+/* Catch up when the encoding changes: the X4 steps from the last state
+*  decoded in mode to the state the channels are in now. X4 and X2 can only
+*  be one step behind. X1 can be up to three steps behind, in the direction
+*  of the last A edge, so count on from there. */
+
+static inline int qeiCatchUp(int prev, int curr, int mode) {
+
+    int step = (qeiGrayPos[curr] - qeiGrayPos[prev]) & 3;
+
+    if (mode != QEI_MODE_X1) {
+        return qeiStepX4[QEI_STEP(prev, curr)];
+    }
+    if (step == 0) {
+        return 0;
+    }
+    return ((prev >> 1) == (prev & 1)) ? step : step - 4;
+
+}
+
+//------------------------------------------------------------------------------
+/* X4 steps a window of elapsed us holds at maxEdgeRate X4 interrupts a
+*  second. */
+
+static inline uint32_t qeiWindowLimit(int maxEdgeRate, uint32_t elapsed) {
+
+    return (uint32_t)((uint64_t)maxEdgeRate * elapsed / 1000000);
+
+}
+
+//------------------------------------------------------------------------------
+/* Encoding for the next window after moving moved X4 steps in one that
+*  allows limit. Each step down in resolution halves the interrupts, and
+*  going back up waits until the finer encoding would be at half its limit,
+*  so a speed near a threshold does not switch every window. */
+
+static inline int qeiNextMode(int mode, uint32_t moved, uint32_t limit) {
+
+    if (mode == QEI_MODE_X4 && moved > limit) {
+        return QEI_MODE_X2;
+    }
+    if (mode == QEI_MODE_X2 && moved > 2 * limit) {
+        return QEI_MODE_X1;
+    }
+    if (mode == QEI_MODE_X2 && moved < limit / 2) {
+        return QEI_MODE_X4;
+    }
+    if (mode == QEI_MODE_X1 && moved < limit) {
+        return QEI_MODE_X2;
+    }
+    return mode;
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/* @file timencoder.cpp
+*
+* This file contains the register level timer encoder interface used by
+* QEITimer. It only touches the TIM registers so it can run against
+* stm32_mock.h on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "timencoder.h"
+
+// TIMx register fields (RM0390 section 17.4 and 18.4)
+#define CR1_CEN       0x0001
+#define EGR_UG        0x0001
+#define SMCR_SMS_ENC1 0x0001    // Encoder mode 1: count TI1 edges
+#define SMCR_SMS_ENC3 0x0003    // Encoder mode 3: count TI1 and TI2 edges
+#define CCMR1_ENC     0x3131    // IC1 on TI1, IC2 on TI2, 8 sample filter
+#define CCER_ENC      0x0011    // CC1E, CC2E, both non-inverted
+#define CCER_CC1P     0x0002    // TI1 inverted, counts the other way
+#define DIER_GUARD    0x0019    // UIE, CC3IE, CC4IE
+#define SR_GUARD      0x0019
+
+// Compare points splitting the 16 bit range into thirds
+#define GUARD_LOW  0x5555
+#define GUARD_HIGH 0xAAAA
+
+//------------------------------------------------------------------------------
+
+TIMENCODER::TIMENCODER(TIM_TypeDef *tim, bool x4, bool reverse): _tim(tim)
+{
+
+    _last = 0;
+    _count = 0;
+
+    _tim->CR1 &= ~CR1_CEN;
+    _tim->SMCR = x4 ? SMCR_SMS_ENC3 : SMCR_SMS_ENC1;
+    _tim->CCMR1 = CCMR1_ENC;
+    _tim->CCMR2 = 0;
+    _tim->CCER = CCER_ENC | (reverse ? CCER_CC1P : 0);
+    _tim->PSC = 0;
+    _tim->ARR = 0xFFFF;
+    _tim->CCR3 = GUARD_LOW;
+    _tim->CCR4 = GUARD_HIGH;
+    _tim->EGR = EGR_UG;
+    _tim->CNT = 0;
+    _tim->CR1 |= CR1_CEN;
+
+}
+
+//------------------------------------------------------------------------------
+
+int32_t TIMENCODER::count(void)
+{
+
+    uint16_t now = (uint16_t)_tim->CNT;
+
+    _count += (int16_t)(now - _last);
+    _last = now;
+    return _count;
+
+}
+
+//------------------------------------------------------------------------------
+
+void TIMENCODER::interrupt(bool on)
+{
+
+    if (on) {
+        _tim->SR = ~SR_GUARD;
+        _tim->DIER |= DIER_GUARD;
+    } else {
+        _tim->DIER &= ~DIER_GUARD;
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void TIMENCODER::irq(void)
+{
+
+    if (_tim->SR & SR_GUARD) {
+        _tim->SR = ~SR_GUARD;
+        count();
+    }
+
+}
@@ -0,0 +1,82 @@
+/* @file timencoder.h
+*
+* This file contains the register level timer encoder interface used by
+* QEITimer. It only touches the TIM registers so it can run against
+* stm32_mock.h on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef TIMENCODER_H
+#define TIMENCODER_H
+
+#ifdef __MBED__
+#include "mbed.h"
+#else
+#include "stm32_mock.h"
+#endif
+
+//------------------------------------------------------------------------------
+/** @brief   Counts a quadrature encoder with an STM32 timer in encoder mode.
+*   @details The encoder channels go to TI1 and TI2. The slave controller
+*            turns their edges into up and down counts, X4 on both inputs or
+*            X2 on TI1 only, so counting takes no CPU at all.
+*
+*            The counter is 16 bits. count() extends it to 32 bits by adding
+*            the signed change in CNT since the last call, which is exact as
+*            long as calls are less than 32768 counts apart. With interrupt()
+*            on, compares at a third and two thirds of the range and the
+*            update event call it for you every 21845 counts at most, so the
+*            loop can poll as slowly as it likes. Not reentrant, the caller
+*            masks interrupts around count() when the interrupt is on.
+*/
+
+class TIMENCODER
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor that configures the timer and starts it from zero.
+    *
+    *   @param tim     Timer register block, needs CH1 and CH2.
+    *   @param x4      true to count every edge of both inputs, false for the
+    *                  edges of TI1 only.
+    *   @param reverse true to count the other way, by inverting TI1.
+    */
+
+    TIMENCODER(TIM_TypeDef *tim, bool x4, bool reverse = false);
+
+    //--------------------------------------------------------------------------
+    /** Returns the count extended to 32 bits.
+    */
+
+    int32_t count(void);
+
+    //--------------------------------------------------------------------------
+    /** Turns the overflow guard interrupts on or off.
+    */
+
+    void interrupt(bool on);
+
+    //--------------------------------------------------------------------------
+    /** Handles the timer interrupt.
+    */
+
+    void irq(void);
+
+    //--------------------------------------------------------------------------
+    /** Returns the timer register block.
+    */
+
+    TIM_TypeDef *timer(void) { return _tim; }
+
+private:
+
+    TIM_TypeDef *_tim;
+    uint16_t _last;
+    int32_t _count;
+
+}; // end of class timencoder
+
+#endif
@@ -141,6 +141,9 @@ void MCP4922::write(MCPDAC dac, float value)
 
 void MCP4922::write_u16(MCPDAC dac, unsigned short value)
 {
+    //Keep the update and SPI frame whole if an interrupt also writes the DAC
+    core_util_critical_section_enter();
+
     //Update the value for the specified DAC
     if (dac == DAC_A) {
         //Mask off the old value, and set the new one
@@ -157,6 +160,8 @@ void MCP4922::write_u16(MCPDAC dac, unsigned short value)
         //Update the DAC B
         writeDac(m_DacValueB | (dac << 15));
     }
+
+    core_util_critical_section_exit();
 }
 
 void MCP4922::writeDac(unsigned short value)
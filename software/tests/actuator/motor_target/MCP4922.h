@@ -149,6 +149,8 @@ public:
      *
      * @param dac The DAC to write to.
      * @param value The new output voltage for the specified DAC as a 16-bit unsigned short (0x0000 to 0xFFFF).
+     *
+     * @note Runs in a critical section, so it is safe to call from interrupt context.
      */
     void write_u16(MCPDAC dac, unsigned short value);
 
@@ -16,6 +16,7 @@
 #include "imu.h"
 #include "GPS.h"
 #include "QEI.h"
+#include "QEIGroup.h"
 #include "motor.h"
 #include "PwmIn.h"
 #include "MCP4922.h"
@@ -65,6 +66,7 @@ Timer timer;
 /* Encoder Objects */
 QEI EncoderL(CHA1, CHB1, NC, 192, QEI::X4_ENCODING);
 QEI EncoderR(CHA2, CHB2, NC, 192, QEI::X4_ENCODING);
+QEIGroup Encoders;
 
 /* IMU Objects */
 IMU Imu(IMDA, IMCL, BNO055_G_CHIP_ADDR, true);
@@ -179,14 +181,17 @@ int main()
 
     //encoder variables
     int lenc, renc;
+    qei_latch_t enc;
 
     //gps variables
     int lock = 0;
+    int gpsResult;
 
     // Creates variables of reading data types
     IMU::imu_euler_t euler;
     IMU::imu_lin_accel_t linAccel;
     IMU::imu_gravity_t grav;
+    IMU::imu_data_t imuData;
 
     // while (1) {
     //     printf("E_Stop\tThr\tMo\tLR\tBRAK\r\n");
@@ -231,6 +236,11 @@ int main()
 	//MotorR.start(0);
     Pc.printf("Motors initialised\r\n");
 
+    //GPS sentences arrive by DMA from here, the loop parses them and
+    //finishes setting up the receiver
+    Gps.startDMA();
+    Gps.configure();
+
     Pc.printf("Waiting on user GO\r\n");
 
 
@@ -246,11 +256,13 @@ int main()
     Pc.printf("User GO accepted starting run\r\n");
     fprintf(ofp, "Point#, nearest waypoint, next waypoint, ");
     fprintf(ofp, "rcThrot, rcDir, rcE-stop, rcMode, ");
-    fprintf(ofp, "time, lat, long, #sat, ");
+    fprintf(ofp, "time, lat e7, long e7, #sat, ");
     fprintf(ofp, "xAcc, yAcc, zAcc, heading, pitch, role, xGra, yGra, zGra, ");
     fprintf(ofp, "lEncoder, rEncoder, lMotor, rMotor\r\n");
     
     Power = 1;
+    Encoders.add(EncoderL);
+    Encoders.add(EncoderR);
     timer.start();
     //main loop, breaks out if estop tripped
 	while((estop = E_Stop.pulsewidth() * 1000000) > 1800) {
@@ -263,21 +275,21 @@ int main()
             throtle = Throt.pulsewidth();
             mode = Mode.pulsewidth();
             leftright = Lr.pulsewidth();
-            //Read data from IMU
-            imu.getEulerAng(&euler);
-            imu.getLinAccel(&linAccel);
-            imu.getGravity(&grav);
-            //get encoder data and reset encoders
-            lenc = EncoderL.getPulses();
-            renc = EncoderR.getPulses();
-            EncoderL.reset();
-            EncoderR.reset();
-
-            // if (gpsCount > 2) {
-            //     //get gps data
-            //     lock = Gps.parseData();
-            //     gpsCount = 0;
-            // }
+            //Read data from IMU, every register in one transaction
+            imu.readAll(&imuData);
+            euler = imuData.euler;
+            linAccel = imuData.linAccel;
+            grav = imuData.gravity;
+            //get encoder counts since the last loop, both at once
+            Encoders.latch(&enc);
+            lenc = enc.delta[0];
+            renc = enc.delta[1];
+
+            //get gps data, whatever arrived since the last loop
+            gpsResult = Gps.poll();
+            if (gpsResult >= 0) {
+                lock = gpsResult;
+            }
 
             if((mode *= 1000000) > 1450 && mode < 1550) {
                 //Radio control mode
@@ -296,8 +308,8 @@ int main()
                 fprintf(ofp, "%f, %f, %f, %f, ", throtle, leftright, estop, mode);
                 //record gps data if available
                 if (lock) {
-                    fprintf(ofp, "%f, %f, %f, %d, ", Gps.time, Gps.latitude,
-                        Gps.longitude, Gps.satellites);
+                    fprintf(ofp, "%f, %ld, %ld, %d, ", Gps.time, (long)Gps.data.lat,
+                        (long)Gps.data.lon, Gps.satellites);
                 } else {
                     fprintf(ofp, "NL, NL, NL, NL, ");
                 }
@@ -4,7 +4,7 @@
 int readBound(char *line, Map *mp) {
     char *parts;
     int pt = -1;
-    float lat, lon;
+    coord_t lat, lon;
 
     parts = strtok(line, " ,");
     switch (parts[0]) {
@@ -19,11 +19,11 @@ int readBound(char *line, Map *mp) {
     }
 
     parts = strtok(NULL, " ,");
-    if (!sscanf(parts, "%f", &lat))
+    if (!parts || !coordParse(parts, &lat))
         return -3;
 
     parts = strtok(NULL, " ,");
-    if (!sscanf(parts, "%f", &lon))
+    if (!parts || !coordParse(parts, &lon))
         return -4;
     switch (pt) {
         case 0: if (!mp->nw.init) {
@@ -44,6 +44,14 @@ int readBound(char *line, Map *mp) {
                 break;
         case 2: if (!mp->sw.init) {
                     mp->sw.lat = lat;
+                    mp->sw.lon = lon;
+                    mp->sw.init = 1;
+                } else {
+                    return -5;
+                }
+                break;
+        case 3: if (!mp->se.init) {
+                    mp->se.lat = lat;
                     mp->se.lon = lon;
                     mp->se.init = 1;
                 } else {
@@ -79,7 +87,8 @@ int readMax(char *line, Map *mp) {
 int readPoint(char *line, Map *mp) {
     char *parts;
     int order;
-    float time, lat, lon, vel, vang, accel, accelang;
+    float time, vel, vang, accel, accelang;
+    coord_t lat, lon;
 
     if (!mp->path)
         return -4;
@@ -91,10 +100,10 @@ int readPoint(char *line, Map *mp) {
     if (!sscanf(parts, "%f", &time))
         return -1;
     parts = strtok(NULL, " ,");
-    if (!sscanf(parts, "%f", &lon))
+    if (!parts || !coordParse(parts, &lon))
         return -1;
     parts = strtok(NULL, " ,");
-    if (!sscanf(parts, "%f", &lat))
+    if (!parts || !coordParse(parts, &lat))
         return -1;
     parts = strtok(NULL, " ,");
     if (!sscanf(parts, "%f", &vel))
@@ -152,6 +161,11 @@ int readMap(FILE *fp, Map *mp) {
             case 'E': end = 1;
                       printf("End of Map\n");
                       break;
+
+            case 'B': if (readBound(line + 1, mp))
+                        end = -2;
+                      break;
+
             case 'M': if (readMax(line + 1, mp))
                         end = -3;
                       if (NULL == (mp->path = (Point *)calloc(mp->npoints, sizeof(Point))))
@@ -172,6 +186,10 @@ int readMap(FILE *fp, Map *mp) {
 
 
 int checkMap(Map *mp) {
+    coord_t south, north;
+    int i;
+
+    //integer compares, exact to the last place the map gives
     if (mp->nw.lat < mp->sw.lat)
         return -1;
     if (mp->nw.lat < mp->se.lat)
@@ -180,13 +198,28 @@ int checkMap(Map *mp) {
         return -1;
     if (mp->ne.lat < mp->se.lat)
         return -1;
-    //if (mp->nw.lon < 
+    if (coordDiff(mp->ne.lon, mp->nw.lon) < 0)
+        return -2;
+    if (coordDiff(mp->se.lon, mp->sw.lon) < 0)
+        return -2;
 
-    //check to make sure all waypoints are in a rough line
-    //check to make sure that waypoints are in incremental order
+    //check to make sure all waypoints are inside the bounds
+    south = mp->sw.lat > mp->se.lat ? mp->sw.lat : mp->se.lat;
+    north = mp->nw.lat < mp->ne.lat ? mp->nw.lat : mp->ne.lat;
+    for (i = 0; i < mp->npoints; i++) {
+        if (!mp->path || !mp->path[i].init)
+            return -3;
+        if (mp->path[i].lat < south || mp->path[i].lat > north)
+            return -4;
+        if (coordDiff(mp->path[i].lon, mp->nw.lon) < 0 ||
+            coordDiff(mp->path[i].lon, mp->sw.lon) < 0 ||
+            coordDiff(mp->ne.lon, mp->path[i].lon) < 0 ||
+            coordDiff(mp->se.lon, mp->path[i].lon) < 0)
+            return -4;
+    }
+
+    //check to make sure waypoints are in a rough line
     //check to make sure distances between waypoints make sense given the 
     //  max acceleration and velecoity bounds
     return 0;
 }
-
-
@@ -23,6 +23,14 @@ const PinName CHB1 = PB_10; // Digital input
 const PinName CHA2 = PB_7; // Digital input
 const PinName CHB2 = PC_13; // Digital input
 
+/* Encoders on timers (QEITimer), CH1/CH2 pairs. Encoder 1 needs CHB1 moved
+   from PB_10 to PA_9 and TIM1 free of the ESTO capture (RADIO_SBUS), encoder
+   2 needs CHB2 moved from PC_13 to PB_6. */
+const PinName ENC1A = PA_8; // TIM1_CH1
+const PinName ENC1B = PA_9; // TIM1_CH2
+const PinName ENC2A = PB_7; // TIM4_CH2
+const PinName ENC2B = PB_6; // TIM4_CH1
+
 /* IMU */
 const PinName IMDA = I2C_SDA; // I2C1 data
 const PinName IMCL = I2C_SCL; // I2C1 clock
@@ -37,6 +45,7 @@ const PinName MODE = PB_0; // Digital input (PWM input)
 const PinName THRO = PB_3; // Digital input (PWM input)
 const PinName ESTO = PA_11; // Digital input (PWM input)
 const PinName BRAK = PA_12; // Digital input (PWM input)
+const PinName SBRX = PC_7; // Serial6 RX (SBUS, through an inverter)
 
 /* SD */
 const PinName CLK = PA_5; // SPI1 Clock
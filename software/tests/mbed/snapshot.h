@@ -0,0 +1,129 @@
+/* @file snapshot.h
+*
+* This file contains a versioned, double buffered snapshot for passing sensor
+* frames from interrupts to the control loop without locks.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+
+#ifdef __MBED__
+#include "mbed.h"
+#define SNAPSHOT_BARRIER() __DMB()
+#else
+#define SNAPSHOT_BARRIER() __sync_synchronize()
+#endif
+
+//------------------------------------------------------------------------------
+/** @brief   Double buffered frame with a sequence number.
+*   @details Writers fill the back buffer, which begin() preloads with the
+*            latest frame so an interrupt can update only its own fields, and
+*            commit() makes it the front buffer by bumping the sequence. A
+*            reader copies the front buffer and keeps the copy if at most one
+*            commit happened meanwhile (that commit only wrote the other
+*            buffer), otherwise it copies again. When the sequence has not
+*            moved since the last read, read() returns at once.
+*
+*            Writers must not preempt each other: call begin()/commit() from
+*            interrupts of one priority (mbed leaves every IRQ at the same
+*            priority) or from a single context. Readers run in thread
+*            context, where a writer always finishes before they resume.
+*/
+
+template <typename T>
+class SNAPSHOT
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor that publishes a first frame.
+    *
+    *   @param init Initial contents of both buffers.
+    */
+
+    SNAPSHOT(const T &init) : _seq(0)
+    {
+        _buf[0] = init;
+        _buf[1] = init;
+    }
+
+    //--------------------------------------------------------------------------
+    /** Starts a write.
+    *
+    *   @return Back buffer holding a copy of the latest frame.
+    */
+
+    T *begin(void)
+    {
+        uint32_t front = _seq & 1;
+
+        _buf[front ^ 1] = _buf[front];
+        return &_buf[front ^ 1];
+    }
+
+    //--------------------------------------------------------------------------
+    /** Publishes the frame filled since begin().
+    */
+
+    void commit(void)
+    {
+        SNAPSHOT_BARRIER();
+        _seq = _seq + 1;
+    }
+
+    //--------------------------------------------------------------------------
+    /** Publishes a whole frame.
+    */
+
+    void publish(const T &frame)
+    {
+        *begin() = frame;
+        commit();
+    }
+
+    //--------------------------------------------------------------------------
+    /** Copies the latest frame if it is newer than the last one read.
+    *
+    *   @param frame Filled with a coherent copy of the latest frame.
+    *   @param seen  Sequence of the last frame read, updated on a copy.
+    *   @return true if a newer frame was copied.
+    */
+
+    bool read(T *frame, uint32_t *seen)
+    {
+        uint32_t seq = _seq;
+
+        if (seq == *seen) {
+            return false;
+        }
+
+        do {
+            seq = _seq;
+            SNAPSHOT_BARRIER();
+            *frame = _buf[seq & 1];
+            SNAPSHOT_BARRIER();
+        } while (_seq - seq > 1);
+
+        *seen = seq;
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    /** Returns the number of frames committed.
+    */
+
+    uint32_t sequence(void) { return _seq; }
+
+private:
+
+    volatile uint32_t _seq;
+    T _buf[2];
+
+}; // end of class snapshot
+
+#endif
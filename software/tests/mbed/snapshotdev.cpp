@@ -0,0 +1,150 @@
+/* @file snapshotdev.cpp
+*
+* Host test of the snapshot retry: a frame whose copy stops halfway to let
+* the "interrupt" commit, so a copy that straddles a rewrite shows up torn.
+*
+* g++ -O2 -o snapshotdev snapshotdev.cpp && ./snapshotdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include "snapshot.h"
+
+#define WORDS 8
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+struct FRAME;
+static void interrupt(void);
+int value(const FRAME &f);
+
+// Commits the interrupt makes in the middle of the next copy
+static int pending = 0;
+static bool inInterrupt = false;
+
+// Copies made outside the interrupt, read() attempts, and what each held
+static int copies = 0;
+static int attempt[4];
+
+struct FRAME
+{
+    int word[WORDS];
+
+    FRAME() {}
+
+    FRAME(const FRAME &o) {
+        memcpy(word, o.word, sizeof(word));
+    }
+
+    // Copies half, lets the interrupt in, copies the rest
+    FRAME &operator=(const FRAME &o) {
+        for (int i = 0; i < WORDS / 2; i++) {
+            word[i] = o.word[i];
+        }
+        if (!inInterrupt) {
+            copies++;
+            interrupt();
+        }
+        for (int i = WORDS / 2; i < WORDS; i++) {
+            word[i] = o.word[i];
+        }
+        if (!inInterrupt && copies <= 4) {
+            attempt[copies - 1] = value(*this);
+        }
+        return *this;
+    }
+};
+
+FRAME frameOf(int v) {
+    FRAME f;
+    for (int i = 0; i < WORDS; i++) {
+        f.word[i] = v;
+    }
+    return f;
+}
+
+// Every word the same, or -1 if the copy is torn
+int value(const FRAME &f) {
+    for (int i = 1; i < WORDS; i++) {
+        if (f.word[i] != f.word[0]) {
+            return -1;
+        }
+    }
+    return f.word[0];
+}
+
+static SNAPSHOT<FRAME> *snap;
+static int next = 1;
+
+static void interrupt(void) {
+    inInterrupt = true;
+    for (; pending > 0; pending--) {
+        snap->publish(frameOf(next++));
+    }
+    inInterrupt = false;
+}
+
+int main() {
+    FRAME out = frameOf(0);
+    uint32_t seen = 0;
+    inInterrupt = true;
+    SNAPSHOT<FRAME> s(frameOf(0));
+    inInterrupt = false;
+    snap = &s;
+
+    // Nothing committed yet
+    copies = 0;
+    check("nothing new", s.read(&out, &seen), 0);
+    check("nothing new copies", copies, 0);
+
+    // Quiet, one copy
+    pending = 1;
+    interrupt();
+    copies = 0;
+    check("quiet new", s.read(&out, &seen), 1);
+    check("quiet copies", copies, 1);
+    check("quiet value", value(out), 1);
+    check("quiet seen", seen, 1);
+
+    // One commit during the copy only writes the other buffer, the copy
+    // is whole and kept, the newer frame is for the next read
+    pending = 1;
+    interrupt();
+    copies = 0;
+    pending = 1;
+    check("one commit new", s.read(&out, &seen), 1);
+    check("one commit copies", copies, 1);
+    check("one commit value", value(out), 2);
+    check("one commit seen", seen, 2);
+    copies = 0;
+    check("one commit next", s.read(&out, &seen), 1);
+    check("one commit next value", value(out), 3);
+
+    // Two commits rewrite the buffer being copied, the first copy is torn
+    // and read() copies again
+    pending = 1;
+    interrupt();
+    copies = 0;
+    pending = 2;
+    check("two commits new", s.read(&out, &seen), 1);
+    check("two commits copies", copies, 2);
+    check("two commits first torn", attempt[0], -1);
+    check("two commits value", value(out), 6);
+    check("two commits seen", seen, s.sequence());
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
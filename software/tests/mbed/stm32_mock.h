@@ -0,0 +1,48 @@
+/* @file stm32_mock.h
+*
+* This file contains host stand-ins for the STM32F446 peripheral register
+* blocks so register level drivers can be tested on Linux.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef STM32_MOCK_H
+#define STM32_MOCK_H
+
+#include <stdint.h>
+
+#define __IO volatile
+
+//------------------------------------------------------------------------------
+/* Timer registers, same layout as stm32f446xx.h. The test owns the instance
+*  and plays the hardware: it sets CNT, CCRx and the SR flags, then calls the
+*  driver's interrupt handler. SR is rc_w0 on the part, so a driver clears a
+*  flag by writing ~flag; here that write lands as is, the test checks the
+*  flag bit went to zero and then zeroes SR itself. */
+
+typedef struct
+{
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t SMCR;
+  __IO uint32_t DIER;
+  __IO uint32_t SR;
+  __IO uint32_t EGR;
+  __IO uint32_t CCMR1;
+  __IO uint32_t CCMR2;
+  __IO uint32_t CCER;
+  __IO uint32_t CNT;
+  __IO uint32_t PSC;
+  __IO uint32_t ARR;
+  __IO uint32_t RCR;
+  __IO uint32_t CCR1;
+  __IO uint32_t CCR2;
+  __IO uint32_t CCR3;
+  __IO uint32_t CCR4;
+  __IO uint32_t BDTR;
+  __IO uint32_t DCR;
+  __IO uint32_t DMAR;
+  __IO uint32_t OR;
+} TIM_TypeDef;
+
+#endif
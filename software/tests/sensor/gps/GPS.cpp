@@ -1,110 +1,69 @@
 #include "GPS.h"
-GPS::GPS(PinName tx, PinName rx) : _UltimateGps(tx, rx)
+
+// DMA1 stream 1 flags in LISR/LIFCR (RM0390 section 9.5)
+#define DMA_S1_FLAGS (DMA_LIFCR_CFEIF1 | DMA_LIFCR_CDMEIF1 | DMA_LIFCR_CTEIF1 | \
+                      DMA_LIFCR_CHTIF1 | DMA_LIFCR_CTCIF1)
+
+// DMA1 stream 3 flags, transmit
+#define DMA_S3_FLAGS (DMA_LIFCR_CFEIF3 | DMA_LIFCR_CDMEIF3 | DMA_LIFCR_CTEIF3 | \
+                      DMA_LIFCR_CHTIF3 | DMA_LIFCR_CTCIF3)
+
+GPS *GPS::_self = NULL;
+
+GPS::GPS(PinName tx, PinName rx) : _UltimateGps(tx, rx), _rx(rx)
 {
     _UltimateGps.baud(57600);
+    _tail = 0;
+    fixtype = 0;
+    _type = NMEA_OTHER;
+    _tx[0] = 0;
+    _configuring = false;
+    memset(&data, 0, sizeof(data));
 }
 
 int GPS::parseData()
 {
-    //while(1) {
-        getData();
-        sscanf(NEMA, "GPGGA, %*f, %*f, %*c, %*f, %*c, %d, %d, %*f, %f", &fixtype, &satellites, &altitude);
-        if(sscanf(NEMA, "GPRMC, %2d%2d%f, %c, %f, %c, %f, %c, %f, %f, %2d%2d%2d"
-		, &hours, &minutes, &seconds, &validity, &latitude, &ns, 
-		&longitude, &ew, &speed, &heading, &day, &month, &year) >=1) {
-            if(fixtype == 0) {
-                return 0;
-            }
-            year += 2000;
-            if(ns =='S') {
-                latitude   *= -1.0;
-            }
-
-            if(ew =='W') {
-                longitude  *= -1.0;
-            }
-            float degrees = trunc(latitude / 100.0f);
-            float minutes = latitude - (degrees * 100.0f);
-            latitude = degrees + minutes / 60.0f;
-            degrees = trunc(longitude / 100.0f);
-            minutes = longitude - (degrees * 100.0f);
-            longitude = degrees + minutes / 60.0f;
-            if(fixtype == 1) {
-                fix = "Positive";
-            }
-            if(fixtype == 2) {
-                fix = "Differential";
-            }
-            if(heading > 0.00 && heading < 45.00) {
-                cardinal = "NNE";
-            }
-            if(heading == 45.00) {
-                cardinal = "NE";
-            }
-            if(heading > 45.00 && heading < 90.00) {
-                cardinal = "ENE";
-            }
-            if(heading == 90.00) {
-                cardinal = "E";
-            }
-            if(heading > 90.00 && heading < 135.00) {
-                cardinal = "ESE";
-            }
-            if(heading == 135.00) {
-                cardinal = "SE";
-            }
-            if(heading > 135.00 && heading < 180.00) {
-                cardinal = "SSE";
-            }
-            if(heading == 180.00) {
-                cardinal = "S";
-            }
-            if(heading > 180.00 && heading < 225.00) {
-                cardinal = "SSW";
-            }
-            if(heading == 225.00) {
-                cardinal = "SW";
-            }
-            if(heading > 225.00 && heading < 270.00) {
-                cardinal = "WSW";
-            }
-            if(heading == 270.00) {
-                cardinal = "W";
-            }
-            if(heading > 270.00 && heading < 315.00) {
-                cardinal = "WNW";
-            }
-            if(heading == 315.00) {
-                cardinal = "NW";
-            }
-            if(heading > 315.00 && heading < 360.00) {
-                cardinal = "NNW";
-            }
-            if(heading == 360.00 || heading == 0.00) {
-                cardinal = "N";
-            }
-            kph = speed*1.852;
-            return 1;
-        }
-        else {
-        return 0;
-        }
-   // }
+    getData();
+    return parseNEMA();
 }
 
-
-float GPS::trunc(float v)
+int GPS::parseNEMA()
 {
-    if(v < 0.0) {
-        v*= -1.0;
-        v = floor(v);
-        v*=-1.0;
-    } else {
-        v = floor(v);
+    // One pass over the sentence, checksum included, into integer fields
+    _type = nmeaParse(NEMA, &data);
+    switch (_type) {
+    case NMEA_GGA:
+        fixtype = data.fixtype;
+        satellites = data.satellites;
+        altitude = data.altitude / 1000.0f;
+        return 0;
+    case NMEA_RMC:
+        break;
+    default:
+        return 0;
+    }
+    if(fixtype == 0) {
+        return 0;
     }
-    return v;
+    hours = data.time / 3600000;
+    minutes = data.time / 60000 % 60;
+    seconds = data.time % 60000 / 1000.0f;
+    time = data.time / 1000.0f;
+    validity = data.valid ? 'A' : 'V';
+    ns = data.lat < 0 ? 'S' : 'N';
+    ew = data.lon < 0 ? 'W' : 'E';
+    latitude = data.lat / 1e7f;
+    longitude = data.lon / 1e7f;
+    speed = data.speed / 100.0f;
+    heading = data.course / 100.0f;
+    day = data.date / 10000;
+    month = data.date / 100 % 100;
+    year = data.date % 100 + 2000;
+    kph = speed*1.852;
+    return 1;
 }
 
+
 void GPS::getData()
 {
     while(_UltimateGps.getc() != '$');
@@ -118,12 +77,168 @@ void GPS::getData()
     error("overflowed message limit");
 }
 
+void GPS::startDMA()
+{
+    if (_rx != PC_11 || _self != NULL) {
+        error("GPS: DMA receive needs PC_11 (USART3_RX)\r\n");
+    }
+    _self = this;
+
+    // Bytes go straight from the data register into the circular buffer,
+    // with an interrupt at each half so a long burst cannot lap the reader
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    DMA1_Stream1->CR = 0;
+    while (DMA1_Stream1->CR & DMA_SxCR_EN) {
+    }
+    DMA1->LIFCR = DMA_S1_FLAGS;
+    DMA1_Stream1->PAR = (uint32_t)&USART3->DR;
+    DMA1_Stream1->M0AR = (uint32_t)_dma;
+    DMA1_Stream1->NDTR = GPS_DMA_LEN;
+    DMA1_Stream1->CR = DMA_SxCR_CHSEL_0 * 4 | DMA_SxCR_MINC | DMA_SxCR_CIRC |
+                       DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+    DMA1_Stream1->CR |= DMA_SxCR_EN;
+
+    // The idle line interrupt hands over each burst as soon as it ends
+    USART3->CR3 |= USART_CR3_DMAR;
+    USART3->CR1 |= USART_CR1_IDLEIE;
+    NVIC_SetVector(USART3_IRQn, (uint32_t)&GPS::irq);
+    NVIC_SetVector(DMA1_Stream1_IRQn, (uint32_t)&GPS::irq);
+    NVIC_EnableIRQ(USART3_IRQn);
+    NVIC_EnableIRQ(DMA1_Stream1_IRQn);
+}
+
+void GPS::irq(void)
+{
+    _self->service();
+}
+
+// Frames everything the DMA has written since the last interrupt
+void GPS::service(void)
+{
+    int head;
+
+    // Reading SR then DR clears IDLE, only when it is set: the line is
+    // quiet then, mid burst DR holds a byte for the DMA
+    if (USART3->SR & USART_SR_IDLE) {
+        (void)USART3->DR;
+    }
+    DMA1->LIFCR = DMA_LIFCR_CHTIF1 | DMA_LIFCR_CTCIF1;
+
+    head = GPS_DMA_LEN - DMA1_Stream1->NDTR;
+    while (_tail != head) {
+        _nmea.put(_dma[_tail]);
+        _tail = (_tail + 1) % GPS_DMA_LEN;
+    }
+}
+
+int GPS::poll()
+{
+    int lock = -1;
+    int r;
+
+    while (_nmea.get(NEMA, sizeof(NEMA))) {
+        if (_configuring) {
+            _cfg.sentence(NEMA);
+        }
+        r = parseNEMA();
+        if (_type == NMEA_RMC) {
+            lock = r;
+        }
+    }
+
+    // One configuration step, only once the last command has gone out so a
+    // baud change cannot cut it short
+    if (_configuring && !sending()) {
+        switch (_cfg.step(_clock.read_ms(), _tx, sizeof(_tx))) {
+        case GPSCFG_SEND:
+            send(_tx);
+            break;
+        case GPSCFG_BAUD:
+            setBaud(_cfg.baud());
+            break;
+        default:
+            break;
+        }
+        if (_cfg.done() || _cfg.failed()) {
+            _clock.stop();
+            _configuring = false;
+        }
+    }
+    return lock;
+}
+
+void GPS::configure()
+{
+    if (_self != this) {
+        error("GPS: configure() needs startDMA()\r\n");
+    }
+
+    // Transmit stream, memory to the data register, armed per command
+    DMA1_Stream3->CR = 0;
+    while (DMA1_Stream3->CR & DMA_SxCR_EN) {
+    }
+    DMA1->LIFCR = DMA_S3_FLAGS;
+    DMA1_Stream3->PAR = (uint32_t)&USART3->DR;
+    DMA1_Stream3->CR = DMA_SxCR_CHSEL_0 * 4 | DMA_SxCR_MINC | DMA_SxCR_DIR_0;
+    USART3->CR3 |= USART_CR3_DMAT;
+
+    _clock.reset();
+    _clock.start();
+    _cfg.start(_clock.read_ms());
+    _configuring = true;
+}
+
+// Hands a command to the transmit DMA, poll() waits for the last one
+void GPS::send(const char *s)
+{
+    DMA1_Stream3->CR &= ~DMA_SxCR_EN;
+    DMA1->LIFCR = DMA_S3_FLAGS;
+    DMA1_Stream3->M0AR = (uint32_t)s;
+    DMA1_Stream3->NDTR = strlen(s);
+    USART3->SR = ~USART_SR_TC;
+    DMA1_Stream3->CR |= DMA_SxCR_EN;
+}
+
+// True until the last byte has left the shift register
+bool GPS::sending(void)
+{
+    return (DMA1_Stream3->CR & DMA_SxCR_EN) || !(USART3->SR & USART_SR_TC);
+}
+
+// Moves the UART, whatever was framed at the old rate is dropped
+void GPS::setBaud(int baud)
+{
+    char skip[NMEA_LEN];
+
+    NVIC_DisableIRQ(USART3_IRQn);
+    NVIC_DisableIRQ(DMA1_Stream1_IRQn);
+    service();
+    while (_nmea.get(skip, sizeof(skip))) {
+    }
+    _UltimateGps.baud(baud);
+
+    // The HAL init behind baud() rewrites the control registers
+    USART3->CR3 |= USART_CR3_DMAR | USART_CR3_DMAT;
+    USART3->CR1 |= USART_CR1_IDLEIE;
+    NVIC_EnableIRQ(USART3_IRQn);
+    NVIC_EnableIRQ(DMA1_Stream1_IRQn);
+}
+
+void GPS::getStats(nmea_stats_t *stats)
+{
+    core_util_critical_section_enter();
+    _nmea.getStats(stats);
+    core_util_critical_section_exit();
+}
+
 void GPS::Init()
 {
-    wait(1);
-    _UltimateGps.printf("$PMTK220,200*2C\r\n");
-    wait(0.2);
-   _UltimateGps.printf("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
-    wait(1);
+    if (_self != this) {
+        startDMA();
+    }
+    configure();
+    while (_configuring) {
+        poll();
+    }
 }
 
@@ -7,11 +7,15 @@
 ******************************************************/
 
 #include "mbed.h"
-#include <string>
+#include "nmea.h"
+#include "gpscfg.h"
 
 #ifndef GPS_H
 #define GPS_H
 
+// Circular DMA buffer for startDMA(), a few sentences at 57600 baud
+#define GPS_DMA_LEN 512
+
 // EXAMPLE OUTPUTS
 //
 // $GPRMC,064951.000,A,2307.1256,N,12016.4438,E,0.03,165.48,260406,3.05,W,A*2C
@@ -28,11 +32,41 @@ class GPS
 public:
 
     GPS(PinName tx, PinName rx);
+
+    // Starts the receive DMA if needed and configures the receiver, polling
+    // until it answers or every baud rate has been tried, a few seconds at
+    // worst. configure() and poll() do the same from the caller's loop.
     void Init();
     int parseData();
     void getData();
+
+    // Non-blocking receive: DMA fills a circular buffer from the UART and
+    // the idle line and half/full buffer interrupts frame the sentences into
+    // a queue. Only on PC_11 (USART3_RX, DMA1 stream 1 channel 4), and
+    // getData()/parseData() must not be used after it.
+    void startDMA();
+
+    // Parses every queued sentence. Returns -1 if none was a good RMC, or what
+    // parseData() returns for the last RMC. Takes microseconds.
+    int poll();
+
+    // Framer counters for startDMA()
+    void getStats(nmea_stats_t *stats);
+
+    // Sets up the receiver from poll() after startDMA(): the highest baud
+    // rate it takes, RMC and GGA only, and the fastest fix rate that fits,
+    // each step acknowledged (see gpscfg.h). Commands go out by DMA on PC_10
+    // (USART3_TX, DMA1 stream 3 channel 4).
+    void configure();
+
+    // True once the receiver acknowledged it all, false while it is going
+    // or if it failed
+    bool configured() { return _cfg.done(); }
+
+    // Fix period set by configure() (ms), 0 until configured()
+    int period() { return _cfg.period(); }
     
-    float time;         // UTC time
+    float time;         // UTC seconds since midnight
     int hours;
     int minutes;
     float seconds;
@@ -42,25 +76,41 @@ public:
     float speed;        // speed in knots
     float heading;      // heading in degrees derived from previous & 
 			//current location
-    string date;           //
     int day;
     int month;
     int year;
     int fixtype;        // 0 = no fix;  1 = fix;  2=differential fix
     int satellites;     // number of satellites used
     float altitude;     //
-    string fix; 
-    string cardinal;
     float kph;
     
     char NEMA[256];
+    nmea_fix_t data;    // Integer fix the fields above are taken from
 
     
 private:
 
-    float trunc ( float v);
+    int parseNEMA();
+    int _type;          // nmeaParse() result for NEMA
+
+    static void irq(void);
+    void service(void);
+    void send(const char *s);
+    bool sending(void);
+    void setBaud(int baud);
     
     Serial _UltimateGps;
+    PinName _rx;
+
+    NMEA _nmea;
+    uint8_t _dma[GPS_DMA_LEN];
+    int _tail;
+    static GPS *_self;
+
+    GPSCONFIG _cfg;
+    Timer _clock;               // For _cfg, from configure()
+    bool _configuring;          // Until _cfg is done or failed
+    char _tx[GPSCFG_CMD_LEN];   // Read by the transmit DMA
     
 };
 #endif
@@ -0,0 +1,216 @@
+/* @file geo.cpp
+*
+* This file contains the fixed point coordinate used by the GPS decode and
+* the map, and the local plane that turns it into metres.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <math.h>
+#include "geo.h"
+
+#define HALF_TURN (180 * COORD_SCALE)
+
+// 3.6e9 does not fit a 32 bit long
+#define FULL_TURN ((int64_t)360 * COORD_SCALE)
+
+//------------------------------------------------------------------------------
+
+bool coordParse(const char *s, coord_t *c)
+{
+
+    int32_t deg = 0, frac = 0;
+    int places = 7;
+    bool neg, digits = false;
+
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    neg = (*s == '-');
+    if (*s == '-' || *s == '+') {
+        s++;
+    }
+    for (; *s >= '0' && *s <= '9'; s++) {
+        deg = deg * 10 + (*s - '0');
+        digits = true;
+        if (deg > 180) {
+            return false;
+        }
+    }
+    if (*s == '.') {
+        for (s++; places > 0 && *s >= '0' && *s <= '9'; s++, places--) {
+            frac = frac * 10 + (*s - '0');
+            digits = true;
+        }
+        for (; places > 0; places--) {
+            frac *= 10;
+        }
+        if (*s >= '5' && *s <= '9') {
+            frac++;
+        }
+    }
+    if (!digits || deg * COORD_SCALE + frac > HALF_TURN) {
+        return false;
+    }
+    *c = neg ? -(deg * COORD_SCALE + frac) : deg * COORD_SCALE + frac;
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+coord_t coordFromNmea(const char *ddmm, char hemi)
+{
+
+    int32_t v = 0;
+    int places = 5;
+    coord_t c;
+
+    // Minutes to 1e-5, the MTK sends 4 places
+    for (; *ddmm >= '0' && *ddmm <= '9'; ddmm++) {
+        v = v * 10 + (*ddmm - '0');
+    }
+    if (*ddmm == '.') {
+        for (ddmm++; places > 0 && *ddmm >= '0' && *ddmm <= '9'; ddmm++, places--) {
+            v = v * 10 + (*ddmm - '0');
+        }
+    }
+    for (; places > 0; places--) {
+        v *= 10;
+    }
+
+    // Whole degrees stay exact, 1e-5 minute is 10/6 of a coord_t
+    c = v / 10000000 * COORD_SCALE + (v % 10000000 * 10 + 3) / 6;
+    return (hemi == 'S' || hemi == 'W') ? -c : c;
+
+}
+
+//------------------------------------------------------------------------------
+
+coord_t coordDiff(coord_t a, coord_t b)
+{
+
+    int64_t d = (int64_t)a - b;
+
+    if (d > HALF_TURN) {
+        d -= FULL_TURN;
+    } else if (d < -HALF_TURN) {
+        d += FULL_TURN;
+    }
+    return (coord_t)d;
+
+}
+
+//------------------------------------------------------------------------------
+
+void coordToMetres(coord_t lat0, coord_t lon0, coord_t lat, coord_t lon,
+                   float *east, float *north)
+{
+
+    ENU enu(lat0, lon0);
+
+    enu.toLocal(lat, lon, east, north);
+
+}
+
+//------------------------------------------------------------------------------
+
+ENU::ENU()
+{
+
+    _lat0 = 0;
+    _lon0 = 0;
+    _kx = 0;
+    _ky = 0;
+    _set = false;
+
+}
+
+//------------------------------------------------------------------------------
+
+ENU::ENU(coord_t lat0, coord_t lon0)
+{
+
+    setOrigin(lat0, lon0);
+
+}
+
+//------------------------------------------------------------------------------
+
+void ENU::setOrigin(coord_t lat0, coord_t lon0)
+{
+
+    // Radians per coord_t
+    const float unit = (float)(M_PI / 180 / COORD_SCALE);
+    float phi = lat0 * unit;
+    float s = sinf(phi);
+    float w = 1 - (float)GEO_E2 * s * s;
+    float n = (float)GEO_A / sqrtf(w);          // Prime vertical radius
+    float m = n * (1 - (float)GEO_E2) / w;      // Meridian radius
+
+    _lat0 = lat0;
+    _lon0 = lon0;
+    _kx = n * cosf(phi) * unit;
+    _ky = m * unit;
+    _set = true;
+
+}
+
+//------------------------------------------------------------------------------
+
+void ENU::toLocal(coord_t lat, coord_t lon, float *x, float *y)
+{
+
+    *x = coordDiff(lon, _lon0) * _kx;
+    *y = coordDiff(lat, _lat0) * _ky;
+
+}
+
+//------------------------------------------------------------------------------
+
+float ENU::distance(coord_t lat1, coord_t lon1, coord_t lat2, coord_t lon2)
+{
+
+    float dx = coordDiff(lon2, lon1) * _kx;
+    float dy = coordDiff(lat2, lat1) * _ky;
+
+    return sqrtf(dx * dx + dy * dy);
+
+}
+
+//------------------------------------------------------------------------------
+
+float ENU::bearing(coord_t lat1, coord_t lon1, coord_t lat2, coord_t lon2)
+{
+
+    float b = atan2f(coordDiff(lon2, lon1) * _kx, coordDiff(lat2, lat1) * _ky) *
+              (float)(180 / M_PI);
+
+    return b < 0 ? b + 360 : b;
+
+}
+
+//------------------------------------------------------------------------------
+
+float ENU::crossTrack(coord_t latA, coord_t lonA, coord_t latB, coord_t lonB,
+                      coord_t lat, coord_t lon, float *along)
+{
+
+    float tx = coordDiff(lonB, lonA) * _kx, ty = coordDiff(latB, latA) * _ky;
+    float px = coordDiff(lon, lonA) * _kx, py = coordDiff(lat, latA) * _ky;
+    float len = sqrtf(tx * tx + ty * ty);
+
+    if (len == 0) {
+        if (along != NULL) {
+            *along = 0;
+        }
+        return sqrtf(px * px + py * py);
+    }
+    tx /= len;
+    ty /= len;
+    if (along != NULL) {
+        *along = px * tx + py * ty;
+    }
+    return px * ty - py * tx;
+
+}
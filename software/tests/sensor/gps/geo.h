@@ -0,0 +1,135 @@
+/* @file geo.h
+*
+* This file contains the fixed point coordinate used by the GPS decode and
+* the map, and the local plane that turns it into metres. It has no
+* mbed dependencies so it can be run on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef GEO_H
+#define GEO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Latitude or longitude in 1e-7 deg, about 1 cm anywhere on the earth.
+// Float degrees only keep 24 bits, about 1 m at 120 deg of longitude.
+typedef int32_t coord_t;
+
+// coord_t per degree
+#define COORD_SCALE 10000000L
+
+// WGS84 ellipsoid
+#define GEO_A  6378137.0            // Semi-major axis (m)
+#define GEO_E2 6.69437999014e-3     // First eccentricity squared
+
+//------------------------------------------------------------------------------
+/* Conversions, only coordToMetres() and ENU use floats */
+
+// Reads decimal degrees, as in "-120.6621183", without going through a
+// float. Places past the 7th are rounded. Returns false if there are no
+// digits or it is past 180 deg.
+bool coordParse(const char *s, coord_t *c);
+
+// Reads an NMEA ddmm.mmmm or dddmm.mmmm field, ended by , or *, and its
+// N, S, E or W. An empty field reads 0.
+coord_t coordFromNmea(const char *ddmm, char hemi);
+
+// a - b exactly. Longitudes are taken the short way round, across 180 deg.
+coord_t coordDiff(coord_t a, coord_t b);
+
+// Metres east and north from (lat0, lon0) to (lat, lon), as ENU does it.
+// For one off conversions, anything repeated should keep an ENU.
+void coordToMetres(coord_t lat0, coord_t lon0, coord_t lat, coord_t lon,
+                   float *east, float *north);
+
+//------------------------------------------------------------------------------
+/** @brief   Local east, north plane tangent to the WGS84 ellipsoid at an
+*            origin, such as the map's NW corner.
+*   @details The metres per coord_t east and north are worked out once at
+*            the origin, so a fix converts with an exact integer difference
+*            and one multiply per axis. The differences keep their cm
+*            within 1.6 deg of the origin however far it is from the
+*            equator or meridian, it is the flat plane that costs accuracy
+*            further out, growing with the distance. Against the geodesic
+*            at 35 deg and 1 km, distances are within 0.004%, bearings
+*            0.005 deg and cross track 0.017%, five times that at 5 km and
+*            two and a half times at 60 deg, see geodev.cpp. A course a few
+*            hundred metres across stays within a few cm.
+*/
+
+class ENU
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor without an origin, toLocal() gives 0 until setOrigin().
+    */
+
+    ENU();
+
+    //--------------------------------------------------------------------------
+    /** Constructor that sets the origin.
+    */
+
+    ENU(coord_t lat0, coord_t lon0);
+
+    //--------------------------------------------------------------------------
+    /** Moves the origin and works out the scales there.
+    */
+
+    void setOrigin(coord_t lat0, coord_t lon0);
+
+    //--------------------------------------------------------------------------
+    /** Returns true once there is an origin.
+    */
+
+    bool hasOrigin(void) { return _set; }
+
+    //--------------------------------------------------------------------------
+    /** Converts a coordinate to metres from the origin.
+    *
+    *   @param x Filled with metres east.
+    *   @param y Filled with metres north.
+    */
+
+    void toLocal(coord_t lat, coord_t lon, float *x, float *y);
+
+    //--------------------------------------------------------------------------
+    /** Returns the metres between two coordinates near the origin.
+    */
+
+    float distance(coord_t lat1, coord_t lon1, coord_t lat2, coord_t lon2);
+
+    //--------------------------------------------------------------------------
+    /** Returns the bearing from the first coordinate to the second, clockwise
+    *   from true north in [0, 360) like a compass heading.
+    */
+
+    float bearing(coord_t lat1, coord_t lon1, coord_t lat2, coord_t lon2);
+
+    //--------------------------------------------------------------------------
+    /** Returns the metres a coordinate is off the track from a to b.
+    *
+    *   @param along If not NULL, filled with the metres along the track from
+    *                a, negative behind it.
+    *   @return      Positive right of the track, looking from a to b. With a
+    *                and b the same it is the distance from a.
+    */
+
+    float crossTrack(coord_t latA, coord_t lonA, coord_t latB, coord_t lonB,
+                     coord_t lat, coord_t lon, float *along = NULL);
+
+private:
+
+    coord_t _lat0;
+    coord_t _lon0;
+    float _kx;              // m per coord_t east
+    float _ky;              // m per coord_t north
+    bool _set;
+
+}; // end of class enu
+
+#endif
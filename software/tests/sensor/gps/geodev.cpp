@@ -0,0 +1,222 @@
+/* @file geodev.cpp
+*
+* Host test of the fixed point coordinates against float degrees, and of
+* the local plane against Vincenty's geodesic in double precision.
+*
+* g++ -O2 -o geodev geodev.cpp geo.cpp && ./geodev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include "geo.h"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+void near(const char *what, double got, double want, double tol) {
+    if (fabs(got - want) > tol) {
+        printf("FAIL %s: got %.4f want %.4f\n", what, got, want);
+        failed++;
+    }
+}
+
+coord_t parsed(const char *s) {
+    coord_t c = 12345;
+    if (!coordParse(s, &c)) {
+        printf("FAIL parse %s\n", s);
+        failed++;
+    }
+    return c;
+}
+
+// Vincenty's inverse on the WGS84 ellipsoid in double, to well under a mm:
+// geodesic metres from 1 to 2 and the azimuth at 1, clockwise from north
+void vincenty(double lat1, double lon1, double lat2, double lon2, double *s, double *az) {
+    const double f = 1 / 298.257223563, b = GEO_A * (1 - f);
+    double u1 = atan((1 - f) * tan(lat1 * M_PI / 180));
+    double u2 = atan((1 - f) * tan(lat2 * M_PI / 180));
+    double l = (lon2 - lon1) * M_PI / 180, lambda = l, prev;
+    double sinS, cosS, sigma, sinA, cos2A, cos2Sm, c, uu, a, bb, ds;
+    int i = 0;
+
+    if (l > M_PI) {
+        l -= 2 * M_PI;
+    } else if (l < -M_PI) {
+        l += 2 * M_PI;
+    }
+    lambda = l;
+    do {
+        sinS = sqrt(pow(cos(u2) * sin(lambda), 2) +
+                    pow(cos(u1) * sin(u2) - sin(u1) * cos(u2) * cos(lambda), 2));
+        if (sinS == 0) {
+            *s = 0;
+            *az = 0;
+            return;
+        }
+        cosS = sin(u1) * sin(u2) + cos(u1) * cos(u2) * cos(lambda);
+        sigma = atan2(sinS, cosS);
+        sinA = cos(u1) * cos(u2) * sin(lambda) / sinS;
+        cos2A = 1 - sinA * sinA;
+        cos2Sm = cos2A != 0 ? cosS - 2 * sin(u1) * sin(u2) / cos2A : 0;
+        c = f / 16 * cos2A * (4 + f * (4 - 3 * cos2A));
+        prev = lambda;
+        lambda = l + (1 - c) * f * sinA *
+                 (sigma + c * sinS * (cos2Sm + c * cosS * (-1 + 2 * cos2Sm * cos2Sm)));
+    } while (fabs(lambda - prev) > 1e-13 && ++i < 200);
+
+    uu = cos2A * (GEO_A * GEO_A - b * b) / (b * b);
+    a = 1 + uu / 16384 * (4096 + uu * (-768 + uu * (320 - 175 * uu)));
+    bb = uu / 1024 * (256 + uu * (-128 + uu * (74 - 47 * uu)));
+    ds = bb * sinS * (cos2Sm + bb / 4 * (cosS * (-1 + 2 * cos2Sm * cos2Sm) -
+         bb / 6 * cos2Sm * (-3 + 4 * sinS * sinS) * (-3 + 4 * cos2Sm * cos2Sm)));
+    *s = b * a * (sigma - ds);
+    *az = atan2(cos(u2) * sin(lambda), cos(u1) * sin(u2) - sin(u1) * cos(u2) * cos(lambda)) * 180 / M_PI;
+    if (*az < 0) {
+        *az += 360;
+    }
+}
+
+// Worst errors of an ENU at (lat0, lon0) against vincenty() over a grid out
+// to range metres, for distance and cross track as a fraction of the range
+void bounds(double lat0, double lon0, double range, double *dist, double *bear, double *cross) {
+    coord_t la0 = (coord_t)lround(lat0 * COORD_SCALE), lo0 = (coord_t)lround(lon0 * COORD_SCALE);
+    ENU enu(la0, lo0);
+    coord_t dLat = (coord_t)(range / 111000 * COORD_SCALE);
+    coord_t dLon = (coord_t)(range / (111000 * cos(lat0 * M_PI / 180)) * COORD_SCALE);
+    coord_t latB = la0 + dLat / 3, lonB = lo0 + dLon;
+
+    *dist = *bear = *cross = 0;
+    for (int i = -10; i <= 10; i++) {
+        for (int j = -10; j <= 10; j++) {
+            coord_t lat = la0 + dLat * i / 10, lon = lo0 + dLon * j / 10;
+            double s, az, sB, azB, err;
+            if (i == 0 && j == 0) {
+                continue;
+            }
+            vincenty(lat0, lon0, lat / 1e7, lon / 1e7, &s, &az);
+            err = fabs(enu.distance(la0, lo0, lat, lon) - s) / range;
+            *dist = err > *dist ? err : *dist;
+
+            // Bearings only where the point is far enough to have one
+            if (s > range / 4) {
+                err = fabs(enu.bearing(la0, lo0, lat, lon) - az);
+                err = err > 180 ? 360 - err : err;
+                *bear = err > *bear ? err : *bear;
+            }
+
+            // Off the track from the origin towards B
+            vincenty(lat0, lon0, latB / 1e7, lonB / 1e7, &sB, &azB);
+            err = fabs(enu.crossTrack(la0, lo0, latB, lonB, lat, lon) -
+                       s * sin((az - azB) * M_PI / 180)) / range;
+            *cross = err > *cross ? err : *cross;
+        }
+    }
+}
+
+int main() {
+    coord_t c;
+    float e, n, re, rn;
+
+    // Text, exact to the last place
+    check("parse", parsed("35.3006117"), 353006117);
+    check("parse west", parsed("-120.6621183"), -1206621183);
+    check("parse short", parsed("10.00"), 100000000);
+    check("parse whole", parsed(" 6"), 60000000);
+    check("parse round", parsed("0.00000005"), 1);
+    check("parse round carry", parsed("0.99999999"), 10000000);
+    check("parse limit", parsed("-180.0000000"), -1800000000);
+    check("parse past limit", coordParse("180.0000001", &c), 0);
+    check("parse empty", coordParse("-", &c), 0);
+    check("parse text", coordParse("N", &c), 0);
+
+    // NMEA minutes
+    check("nmea", coordFromNmea("3518.0367,N", 'N'), 353006117);
+    check("nmea west", coordFromNmea("12039.7271,W", 'W'), -1206621183);
+    check("nmea south", coordFromNmea("3352.1280", 'S'), -338688000);
+    check("nmea empty", coordFromNmea(",", 'N'), 0);
+
+    // Differences exact, and the short way across 180
+    check("diff", coordDiff(-1206621183, -1206621283), 100);
+    check("diff across 180", coordDiff(-1799999000, 1799999000), 2000);
+    check("diff across 180 back", coordDiff(1799999000, -1799999000), -2000);
+    check("diff half turn", coordDiff(1800000000, 0), 1800000000);
+
+    // Float degrees cannot hold a 1e-7 step at 120 deg, the coordinate can
+    {
+        float f0 = -120.6621183f, f1 = -120.6621193f;
+        coordToMetres(353006117, -1206621183, 353006117, -1206621193, &e, &n);
+        printf("1e-7 deg east at Cal Poly: %.4f m, float degrees see %.4f m\n",
+               e, (f1 - f0) * M_PI / 180 * GEO_A * cos(35.3 * M_PI / 180));
+        near("1e-7 east", e, -0.0909, 0.0005);
+    }
+
+    // Scales set once at the origin
+    {
+        ENU enu(353006117, -1206621183);
+        float along;
+        enu.toLocal(353006117 + 9000, -1206621183 + 11000, &e, &n);
+        coordToMetres(353006117, -1206621183, 353006117 + 9000, -1206621183 + 11000, &re, &rn);
+        near("toLocal east", e, 100.05, 0.01);
+        near("toLocal north", n, 99.86, 0.01);
+        near("coordToMetres", e - re + n - rn, 0, 0);
+        near("distance", enu.distance(353006117, -1206621183, 353006117 + 9000, -1206621183 + 11000),
+             sqrt(e * e + n * n), 1e-3);
+        near("bearing north", enu.bearing(0, 0, 100, 0), 0, 1e-4);
+        near("bearing west", enu.bearing(0, 0, 0, -100), 270, 1e-4);
+        near("bearing across 180", enu.bearing(0, 1799999000, 0, -1799999000), 90, 1e-4);
+        near("right of track", enu.crossTrack(0, 0, 0, 1000, -100, 500, &along), 100 * enu.distance(0, 0, 1, 0), 1e-3);
+        near("along track", along, 500 * enu.distance(0, 0, 0, 1), 1e-3);
+        near("left of track", enu.crossTrack(0, 0, 1000, 0, 0, -100), -100 * enu.distance(0, 0, 0, 1), 1e-3);
+        near("no track", enu.crossTrack(0, 0, 0, 0, 300, 400, &along), enu.distance(0, 0, 300, 400), 1e-3);
+        near("no track along", along, 0, 0);
+    }
+
+    // Against the geodesic, the bounds in geo.h
+    {
+        const double lats[] = {0, 35.3006117, 60, -45};
+        double dist, bear, cross;
+        for (int i = 0; i < 4; i++) {
+            bounds(lats[i], -120.6621183, 1000, &dist, &bear, &cross);
+            printf("lat %5.1f  1 km: distance %.4f%%  bearing %.4f deg  cross track %.4f%%\n",
+                   lats[i], dist * 100, bear, cross * 100);
+            near("1 km distance", dist, 0, 1.5e-4);
+            near("1 km bearing", bear, 0, 0.015);
+            near("1 km cross track", cross, 0, 5e-4);
+            bounds(lats[i], 179.99, 5000, &dist, &bear, &cross);
+            printf("lat %5.1f  5 km: distance %.4f%%  bearing %.4f deg  cross track %.4f%%\n",
+                   lats[i], dist * 100, bear, cross * 100);
+            near("5 km distance", dist, 0, 7.5e-4);
+            near("5 km bearing", bear, 0, 0.075);
+            near("5 km cross track", cross, 0, 2.5e-3);
+        }
+    }
+
+    // Cost per fix on the host
+    {
+        ENU enu(353006117, -1206621183);
+        volatile float sink = 0;
+        clock_t t0 = clock();
+        for (int i = 0; i < 10000000; i++) {
+            enu.toLocal(353006117 + (i & 0xFFFF), -1206621183 - (i & 0xFFFF), &e, &n);
+            sink = sink + e + n;
+        }
+        printf("toLocal: %.2f ns per fix (host)\n",
+               (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / 1e7);
+    }
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
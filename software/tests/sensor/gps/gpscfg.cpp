@@ -0,0 +1,285 @@
+/* @file gpscfg.cpp
+*
+* This file contains the configuration of the MTK3339 GPS receiver: baud
+* rate detection and change, sentence mask and fix rate, each checked
+* against the receiver's reply.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include "gpscfg.h"
+#include "nmea.h"
+
+// Rates tried in turn, where it was left last time first, then factory
+static const int detectBauds[] = {GPSCFG_TARGET_BAUD, 9600, 57600, 38400, 19200, 4800};
+#define DETECT_BAUDS ((int)(sizeof(detectBauds) / sizeof(detectBauds[0])))
+
+// Rates to move to, in order of preference
+static const int targetBauds[] = {GPSCFG_TARGET_BAUD, 57600};
+#define TARGET_BAUDS ((int)(sizeof(targetBauds) / sizeof(targetBauds[0])))
+
+// Fix periods (ms), fastest first
+static const int fixPeriods[] = {100, 200, 1000};
+#define FIX_PERIODS ((int)(sizeof(fixPeriods) / sizeof(fixPeriods[0])))
+
+// PMTK001 flags
+#define ACK_DONE 3
+
+//------------------------------------------------------------------------------
+
+GPSCONFIG::GPSCONFIG()
+{
+
+    _state = IDLE;
+    _baud = 0;
+    _period = 0;
+    _baudPending = false;
+    _cmd[0] = 0;
+
+}
+
+//------------------------------------------------------------------------------
+
+void GPSCONFIG::start(uint32_t now)
+{
+
+    _state = DETECT;
+    _index = -1;
+    _pass = 0;
+    _target = 0;
+    _period = 0;
+    _ackCmd = -1;
+    _ack = -1;
+    _baudPending = false;
+    _cmd[0] = 0;
+    nextBaud(now);
+
+}
+
+//------------------------------------------------------------------------------
+
+void GPSCONFIG::sentence(const char *s)
+{
+
+    int cmd = 0;
+
+    if (!nmeaChecksum(s)) {
+        return;
+    }
+    _good = true;
+
+    // PMTK001,cmd,flag
+    if (*s == '$') {
+        s++;
+    }
+    if (strncmp(s, "PMTK001,", 8) != 0) {
+        return;
+    }
+    for (s += 8; *s >= '0' && *s <= '9'; s++) {
+        cmd = cmd * 10 + (*s - '0');
+    }
+    if (cmd == _ackCmd && s[0] == ',' && s[1] >= '0' && s[1] <= '9') {
+        _ack = s[1] - '0';
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+int GPSCONFIG::step(uint32_t now, char *cmd, int len)
+{
+
+    bool lost;
+
+    // What the last step queued goes out first, the rate before the probe
+    // meant for it
+    if (_baudPending) {
+        _baudPending = false;
+        return GPSCFG_BAUD;
+    }
+    if (_cmd[0] != 0) {
+        strncpy(cmd, _cmd, len - 1);
+        cmd[len - 1] = 0;
+        _cmd[0] = 0;
+        return GPSCFG_SEND;
+    }
+
+    switch (_state) {
+    case DETECT:
+        if (_good) {
+            found(now);
+        } else if (now - _since >= GPSCFG_LISTEN_MS) {
+            nextBaud(now);
+        }
+        break;
+
+    case SWITCH:
+        if (now - _since >= _settle) {
+            _baud = targetBauds[_target];
+            _baudPending = true;
+            _state = VERIFY;
+            _tries = 1;
+            listen(now);
+        }
+        break;
+
+    case VERIFY:
+        if (_good) {
+            output(now);
+        } else if (now - _since >= GPSCFG_LISTEN_MS) {
+            if (_tries++ < GPSCFG_TRIES) {
+                listen(now);
+            } else {
+                // Lost it, look where it was first and try the next rate
+                // from wherever it is
+                _target++;
+                _state = DETECT;
+                _index = _found - 1;
+                _pass = 0;
+                nextBaud(now);
+            }
+        }
+        break;
+
+    case OUTPUT:
+        if (_ack == ACK_DONE) {
+            _rate = 0;
+            while (_rate < FIX_PERIODS - 1 &&
+                   GPSCFG_FIX_BYTES * 10 * 1000 / fixPeriods[_rate] > _baud / 2) {
+                _rate++;
+            }
+            _tries = 0;
+            rate(now);
+        } else if (_ack >= 0 || now - _since >= GPSCFG_ACK_MS) {
+            if (_tries < GPSCFG_TRIES) {
+                output(now);
+            } else {
+                _state = FAILED;
+            }
+        }
+        break;
+
+    case RATE:
+        lost = _ack == 0 || (_ack < 0 && now - _since >= GPSCFG_ACK_MS);
+        if (_ack == ACK_DONE) {
+            _period = fixPeriods[_rate];
+            _state = DONE;
+        } else if (_ack > 0 || (lost && _tries >= GPSCFG_TRIES)) {
+            // Refused or never answered, a slower rate may do
+            if (++_rate < FIX_PERIODS) {
+                _tries = 0;
+                rate(now);
+            } else {
+                _state = FAILED;
+            }
+        } else if (lost) {
+            // Garbled or dropped, send it again
+            rate(now);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (_baudPending || _cmd[0] != 0) {
+        return step(now, cmd, len);
+    }
+    return GPSCFG_NONE;
+
+}
+
+//------------------------------------------------------------------------------
+
+void GPSCONFIG::nextBaud(uint32_t now)
+{
+
+    if (++_index >= DETECT_BAUDS) {
+        _index = 0;
+        if (++_pass >= GPSCFG_PASSES) {
+            _state = FAILED;
+            return;
+        }
+    }
+    _baud = detectBauds[_index];
+    _baudPending = true;
+    listen(now);
+
+}
+
+//------------------------------------------------------------------------------
+
+void GPSCONFIG::listen(uint32_t now)
+{
+
+    // The firmware release query, any reply will do
+    nmeaCommand(_cmd, sizeof(_cmd), "PMTK605");
+    _good = false;
+    _since = now;
+
+}
+
+//------------------------------------------------------------------------------
+
+void GPSCONFIG::found(uint32_t now)
+{
+
+    char body[24];
+
+    _found = _index;
+    if (_target >= TARGET_BAUDS || _baud == targetBauds[_target]) {
+        output(now);
+        return;
+    }
+
+    // No reply to this one, it is out once the bytes have gone at the old
+    // rate, 10 bits each, and the receiver has moved
+    sprintf(body, "PMTK251,%d", targetBauds[_target]);
+    _settle = (uint32_t)nmeaCommand(_cmd, sizeof(_cmd), body) * 10000 / _baud + 20;
+    _since = now;
+    _state = SWITCH;
+
+}
+
+//------------------------------------------------------------------------------
+
+void GPSCONFIG::command(uint32_t now, const char *body, int ack)
+{
+
+    nmeaCommand(_cmd, sizeof(_cmd), body);
+    _tries++;
+    _ackCmd = ack;
+    _ack = -1;
+    _since = now;
+
+}
+
+//------------------------------------------------------------------------------
+
+void GPSCONFIG::output(uint32_t now)
+{
+
+    if (_state != OUTPUT) {
+        _state = OUTPUT;
+        _tries = 0;
+    }
+
+    // RMC and GGA every fix, nothing else
+    command(now, "PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", 314);
+
+}
+
+//------------------------------------------------------------------------------
+
+void GPSCONFIG::rate(uint32_t now)
+{
+
+    char body[24];
+
+    _state = RATE;
+    sprintf(body, "PMTK220,%d", fixPeriods[_rate]);
+    command(now, body, 220);
+
+}
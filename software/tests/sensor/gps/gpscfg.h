@@ -0,0 +1,161 @@
+/* @file gpscfg.h
+*
+* This file contains the configuration of the MTK3339 GPS receiver: baud
+* rate detection and change, sentence mask and fix rate, each checked
+* against the receiver's reply. It has no mbed dependencies so it can be
+* run on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef GPSCFG_H
+#define GPSCFG_H
+
+#include <stdint.h>
+
+// Rate the receiver is moved to, 57600 if it will not take it
+#define GPSCFG_TARGET_BAUD 115200
+
+// Wait for any good sentence after a probe (ms)
+#define GPSCFG_LISTEN_MS 300
+
+// Wait for the PMTK001 to a command (ms)
+#define GPSCFG_ACK_MS 300
+
+// Sends of a command, or probes at a new rate, before giving up on it
+#define GPSCFG_TRIES 3
+
+// Passes through every baud rate before the receiver is taken as missing
+#define GPSCFG_PASSES 2
+
+// RMC and GGA bytes per fix, the fix rate is the fastest that keeps these
+// under half the baud rate
+#define GPSCFG_FIX_BYTES 150
+
+// Longest command built
+#define GPSCFG_CMD_LEN 64
+
+// step() results, what the caller does next
+#define GPSCFG_NONE 0       // Nothing
+#define GPSCFG_SEND 1       // Send cmd as it is
+#define GPSCFG_BAUD 2       // Move the UART to baud(), dropping what it holds
+
+//------------------------------------------------------------------------------
+/** @brief   Configures the receiver without blocking, one step at a time.
+*   @details The caller owns the UART. It passes every sentence it receives
+*            to sentence() and calls step() from its loop, doing what
+*            step() asks. Nothing is sent blind:
+*
+*            - Detect: the UART steps through the likely rates, the one
+*              it was left at first then factory 9600, probing with PMTK605
+*              at each. Any sentence with a good checksum means the rate
+*              is right.
+*            - Switch: PMTK251 moves the receiver to GPSCFG_TARGET_BAUD.
+*              It does not acknowledge that, so the UART follows once the
+*              command is out and probes again. If nothing answers,
+*              detection starts over with 57600 as the target, then with
+*              no change.
+*            - Output: PMTK314 leaves only RMC and GGA, which the decoder
+*              reads, and must be acknowledged with PMTK001,314,3.
+*            - Rate: PMTK220 sets the fastest of 10, 5 or 1 Hz the baud
+*              rate carries, falling back a step if the receiver refuses.
+*
+*            A receiver that was set up before answers the first probe at
+*            its rate and is done in three replies, under 50 ms where
+*            GPS::Init() waited 2.2 s. One out of the box at 9600 takes
+*            under half a second.
+*/
+
+class GPSCONFIG
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor, idle until start().
+    */
+
+    GPSCONFIG();
+
+    //--------------------------------------------------------------------------
+    /** Starts over from detection.
+    *
+    *   @param now Time in ms, any origin, as step() will be given it.
+    */
+
+    void start(uint32_t now);
+
+    //--------------------------------------------------------------------------
+    /** Takes a received sentence, with or without the $ and line end. Bad
+    *   checksums are ignored.
+    */
+
+    void sentence(const char *s);
+
+    //--------------------------------------------------------------------------
+    /** Moves the configuration on.
+    *
+    *   @param now Time in ms.
+    *   @param cmd Filled with the sentence to send for GPSCFG_SEND.
+    *   @param len Size of cmd, GPSCFG_CMD_LEN is enough.
+    *   @return    GPSCFG_NONE, GPSCFG_SEND or GPSCFG_BAUD.
+    */
+
+    int step(uint32_t now, char *cmd, int len);
+
+    //--------------------------------------------------------------------------
+    /** Returns true once the receiver has acknowledged the fix rate.
+    */
+
+    bool done(void) { return _state == DONE; }
+
+    //--------------------------------------------------------------------------
+    /** Returns true if the receiver never answered or refused the sentence
+    *   mask. It is left at baud(), as far as it was configured.
+    */
+
+    bool failed(void) { return _state == FAILED; }
+
+    //--------------------------------------------------------------------------
+    /** Returns the baud rate the UART should be at.
+    */
+
+    int baud(void) { return _baud; }
+
+    //--------------------------------------------------------------------------
+    /** Returns the fix period set (ms), 0 until done().
+    */
+
+    int period(void) { return _period; }
+
+private:
+
+    enum state_t { IDLE, DETECT, SWITCH, VERIFY, OUTPUT, RATE, DONE, FAILED };
+
+    void nextBaud(uint32_t now);
+    void listen(uint32_t now);
+    void found(uint32_t now);
+    void command(uint32_t now, const char *body, int ack);
+    void output(uint32_t now);
+    void rate(uint32_t now);
+
+    state_t _state;
+    int _baud;
+    int _index;             // Into the detection rates
+    int _found;             // Where it last answered
+    int _pass;
+    int _target;            // Into the rates to switch to
+    int _rate;              // Into the fix periods
+    int _period;
+    int _tries;
+    uint32_t _since;        // When the current wait started
+    uint32_t _settle;       // Time for PMTK251 to go out (ms)
+    bool _good;             // A good sentence since _since
+    int _ackCmd;            // PMTK001 waited for
+    int _ack;               // Its flag, -1 until it comes
+    bool _baudPending;
+    char _cmd[GPSCFG_CMD_LEN];
+
+}; // end of class gpsconfig
+
+#endif
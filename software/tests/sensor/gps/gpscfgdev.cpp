@@ -0,0 +1,235 @@
+/* @file gpscfgdev.cpp
+*
+* Host test of the receiver configuration against a simulated MTK3339 on
+* a 1 ms clock: the line only carries bytes when both ends are at the same
+* rate, and the receiver replies as the PMTK manual has it.
+*
+* g++ -O2 -I../../mbed -o gpscfgdev gpscfgdev.cpp gpscfg.cpp nmea.cpp geo.cpp && ./gpscfgdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gpscfg.h"
+#include "nmea.h"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+// Receiver under test
+struct MTK
+{
+    int baud;           // Current rate
+    int maxBaud;        // Highest it takes
+    int minPeriod;      // Fastest fix it takes (ms)
+    int period;
+    bool silent;        // Unplugged
+    bool rmcOnly;
+    int sent;           // Commands it took
+    int moveAt, moveTo; // PMTK251 takes effect at this ms
+
+    // Sentences in flight to the host, delivered at their ms
+    char out[16][NMEA_LEN];
+    uint32_t due[16];
+    int count;
+
+    void queue(uint32_t now, const char *body) {
+        if (count < 16) {
+            int len = nmeaCommand(out[count], NMEA_LEN, body);
+            due[count++] = now + 10 + 1000 * len * 10 / baud;
+        }
+    }
+
+    void ack(uint32_t now, int cmd, int flag) {
+        char body[32];
+        sprintf(body, "PMTK001,%d,%d", cmd, flag);
+        queue(now, body);
+    }
+
+    // A command arriving at the host's rate
+    void receive(uint32_t now, const char *s, int hostBaud) {
+        int v;
+        if (silent || hostBaud != baud || !nmeaChecksum(s)) {
+            return;
+        }
+        sent++;
+        if (strncmp(s, "$PMTK605", 8) == 0) {
+            queue(now, "PMTK705,AXN_2.10_3339_2012072601,5223,PA6H,1.0");
+        } else if (sscanf(s, "$PMTK251,%d", &v) == 1) {
+            if (v <= maxBaud) {
+                moveAt = now + 5;
+                moveTo = v;
+            }
+        } else if (strncmp(s, "$PMTK314,0,1,0,1,0,0", 20) == 0) {
+            rmcOnly = false;
+            ack(now, 314, 3);
+        } else if (sscanf(s, "$PMTK220,%d", &v) == 1) {
+            if (v >= minPeriod) {
+                period = v;
+                ack(now, 220, 3);
+            } else {
+                ack(now, 220, 2);
+            }
+        } else {
+            ack(now, 0, 1);
+        }
+    }
+
+    // Fixes at its rate and anything due, to the host if the rates match
+    void tick(uint32_t now, GPSCONFIG &cfg, int hostBaud) {
+        if (moveTo && now >= (uint32_t)moveAt) {
+            baud = moveTo;
+            moveTo = 0;
+        }
+        if (!silent && now % period == 0) {
+            queue(now, "GPRMC,182104.000,A,3518.0367,N,12039.7271,W,0.62,27.30,050617,,,A");
+        }
+        for (int i = 0; i < count; i++) {
+            if (due[i] <= now) {
+                if (hostBaud == baud) {
+                    cfg.sentence(out[i]);
+                }
+                memmove(&out[i], &out[i + 1], (count - i - 1) * sizeof(out[0]));
+                memmove(&due[i], &due[i + 1], (count - i - 1) * sizeof(due[0]));
+                count--;
+                i--;
+            }
+        }
+    }
+};
+
+// Runs the configuration from time 0, returns the ms it took or -1
+int run(MTK &mtk, GPSCONFIG &cfg, int *uart) {
+    char cmd[GPSCFG_CMD_LEN];
+
+    mtk.count = 0;
+    mtk.sent = 0;
+    mtk.moveTo = 0;
+    *uart = 57600;
+    cfg.start(0);
+    for (uint32_t now = 0; now < 10000; now++) {
+        mtk.tick(now, cfg, *uart);
+        switch (cfg.step(now, cmd, sizeof(cmd))) {
+        case GPSCFG_SEND:
+            mtk.receive(now, cmd, *uart);
+            break;
+        case GPSCFG_BAUD:
+            *uart = cfg.baud();
+            break;
+        default:
+            break;
+        }
+        if (cfg.done() || cfg.failed()) {
+            return (int)now;
+        }
+    }
+    return -1;
+}
+
+MTK receiver(int baud, int maxBaud, int minPeriod) {
+    MTK mtk;
+    memset(&mtk, 0, sizeof(mtk));
+    mtk.baud = baud;
+    mtk.maxBaud = maxBaud;
+    mtk.minPeriod = minPeriod;
+    mtk.period = 1000;
+    mtk.rmcOnly = true;
+    return mtk;
+}
+
+int main() {
+    GPSCONFIG cfg;
+    int uart, ms;
+
+    // Out of the box, 9600 and 1 Hz
+    {
+        MTK mtk = receiver(9600, 115200, 100);
+        ms = run(mtk, cfg, &uart);
+        printf("factory 9600: %d ms, %d commands\n", ms, mtk.sent);
+        check("factory done", cfg.done(), 1);
+        check("factory baud", mtk.baud, 115200);
+        check("factory uart", uart, 115200);
+        check("factory period", mtk.period, 100);
+        check("factory reported", cfg.period(), 100);
+        check("factory mask", mtk.rmcOnly, 0);
+        check("factory under 0.5 s", ms < 500, 1);
+    }
+
+    // Set up before, one probe and the two acknowledged commands
+    {
+        MTK mtk = receiver(115200, 115200, 100);
+        ms = run(mtk, cfg, &uart);
+        printf("configured 115200: %d ms, %d commands\n", ms, mtk.sent);
+        check("configured done", cfg.done(), 1);
+        check("configured commands", mtk.sent, 3);
+        check("configured under 50 ms", ms < 50, 1);
+    }
+
+    // Tops out at 57600, the switch to 115200 is never seen
+    {
+        MTK mtk = receiver(9600, 57600, 100);
+        ms = run(mtk, cfg, &uart);
+        printf("57600 at most: %d ms, %d commands\n", ms, mtk.sent);
+        check("57600 done", cfg.done(), 1);
+        check("57600 baud", mtk.baud, 57600);
+        check("57600 uart", uart, 57600);
+        check("57600 period", mtk.period, 100);
+    }
+
+    // Refuses 10 Hz, 5 Hz is the next step
+    {
+        MTK mtk = receiver(38400, 115200, 200);
+        ms = run(mtk, cfg, &uart);
+        printf("5 Hz at most: %d ms, %d commands\n", ms, mtk.sent);
+        check("5 Hz done", cfg.done(), 1);
+        check("5 Hz period", mtk.period, 200);
+        check("5 Hz reported", cfg.period(), 200);
+    }
+
+    // Stays at 4800, which only carries 1 Hz of RMC and GGA
+    {
+        MTK mtk = receiver(4800, 4800, 100);
+        ms = run(mtk, cfg, &uart);
+        printf("4800 only: %d ms, %d commands\n", ms, mtk.sent);
+        check("4800 done", cfg.done(), 1);
+        check("4800 uart", uart, 4800);
+        check("4800 period", cfg.period(), 1000);
+    }
+
+    // Nothing there, every rate twice
+    {
+        MTK mtk = receiver(9600, 115200, 100);
+        mtk.silent = true;
+        ms = run(mtk, cfg, &uart);
+        printf("silent: gave up after %d ms\n", ms);
+        check("silent failed", cfg.failed(), 1);
+        check("silent time", ms, 2 * 6 * GPSCFG_LISTEN_MS);
+    }
+
+    // Commands built as the receiver wants them
+    {
+        char s[GPSCFG_CMD_LEN];
+        nmeaCommand(s, sizeof(s), "PMTK220,200");
+        check("5 Hz command", strcmp(s, "$PMTK220,200*2C\r\n"), 0);
+        nmeaCommand(s, sizeof(s), "PMTK251,57600");
+        check("57600 command", strcmp(s, "$PMTK251,57600*2C\r\n"), 0);
+        check("too long", nmeaCommand(s, 10, "PMTK251,57600"), 0);
+        check("checksum", nmeaChecksum("$PMTK001,314,3*36\r\n"), 1);
+        check("bad checksum", nmeaChecksum("PMTK001,314,3*37"), 0);
+    }
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -4,17 +4,25 @@
 #include "GPS.h"
 
 /*GPS gpsSpark(D8, D7, 4800);*/
-GPS gpsAda(PA_0 ,PA_1);
+/*GPS gpsAda(PA_0 ,PA_1);*/
+GPS gpsAda(PC_10, PC_11);   // USART3, the only port startDMA() takes
 
 Serial pc(USBTX, USBRX);
 
 int main() {
     pc.printf("Top o the morning to yah govnah USBTX: %d USBRX: %d\n\r", USBTX, USBRX);
     gpsAda.Init();
+    pc.printf("GPS %s, fix every %d ms\n\r",
+              gpsAda.configured() ? "configured" : "not answering", gpsAda.period());
     
     while (1) {  
+       wait_ms(100);
+       int r = gpsAda.poll();
+       if (r < 0) {
+            continue;
+       }
        pc.printf("Next Read\n\r");
-       if(gpsAda.parseData()) {
+       if(r) {
             pc.printf("Time: %f\n\r", gpsAda.time) ;
             pc.printf("longitude: %f\n\r", gpsAda.longitude) ;
             pc.printf("latitude: %f\n\r", gpsAda.latitude) ;
@@ -0,0 +1,260 @@
+/* @file nmea.cpp
+*
+* This file contains the NMEA sentence framer and queue used by the GPS
+* receiver, and the GGA and RMC decoder.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <string.h>
+#include "nmea.h"
+#include "snapshot.h"
+
+#define QUEUE_MASK (NMEA_QUEUE - 1)
+
+// Field numbers, the sentence name is 0
+#define GGA_TIME  1
+#define GGA_LAT   2
+#define GGA_LON   4
+#define GGA_FIX   6
+#define GGA_SATS  7
+#define GGA_HDOP  8
+#define GGA_ALT   9
+#define RMC_TIME   1
+#define RMC_STATUS 2
+#define RMC_LAT    3
+#define RMC_LON    5
+#define RMC_SPEED  7
+#define RMC_COURSE 8
+#define RMC_DATE   9
+
+//------------------------------------------------------------------------------
+/* Field readers, each stops at the , or * ending its field */
+
+static int hexValue(char c)
+{
+
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+
+}
+
+// A decimal as an integer in 10^-places, further places are cut. Returns 0
+// for an empty field.
+static int32_t fixed(const char *p, int places)
+{
+
+    int32_t n = 0;
+    bool neg = (*p == '-');
+
+    if (neg) {
+        p++;
+    }
+    for (; *p >= '0' && *p <= '9'; p++) {
+        n = n * 10 + (*p - '0');
+    }
+    if (*p == '.') {
+        for (p++; places > 0 && *p >= '0' && *p <= '9'; p++, places--) {
+            n = n * 10 + (*p - '0');
+        }
+    }
+    for (; places > 0; places--) {
+        n *= 10;
+    }
+    return neg ? -n : n;
+
+}
+
+// hhmmss.sss to ms since midnight
+static uint32_t timeOfDay(const char *p)
+{
+
+    int32_t t = fixed(p, 3);
+
+    return (t / 10000000) * 3600000 + (t / 100000 % 100) * 60000 + t % 100000;
+
+}
+
+//------------------------------------------------------------------------------
+
+NMEA::NMEA()
+{
+
+    memset(&_stats, 0, sizeof(_stats));
+    _len = 0;
+    _inSentence = false;
+    _head = 0;
+    _tail = 0;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool NMEA::put(char c)
+{
+
+    if (c == '$') {
+        if (_inSentence) {
+            _stats.broken++;
+        }
+        _inSentence = true;
+        _len = 0;
+        return false;
+    }
+
+    if (!_inSentence) {
+        if (c != '\r' && c != '\n') {
+            _stats.skipped++;
+        }
+        return false;
+    }
+
+    if (c != '\r' && c != '\n') {
+        if (_len >= NMEA_LEN - 1) {
+            _stats.overlong++;
+            _inSentence = false;
+        } else {
+            _line[_len++] = c;
+        }
+        return false;
+    }
+
+    _inSentence = false;
+    if (_head - _tail >= NMEA_QUEUE) {
+        _stats.dropped++;
+        return false;
+    }
+    memcpy(_queue[_head & QUEUE_MASK], _line, _len);
+    _queue[_head & QUEUE_MASK][_len] = 0;
+    SNAPSHOT_BARRIER();
+    _head = _head + 1;
+    _stats.sentences++;
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool NMEA::get(char *s, int len)
+{
+
+    if (_head == _tail || len < 1) {
+        return false;
+    }
+    SNAPSHOT_BARRIER();
+    strncpy(s, _queue[_tail & QUEUE_MASK], len - 1);
+    s[len - 1] = 0;
+    SNAPSHOT_BARRIER();
+    _tail = _tail + 1;
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+int nmeaParse(const char *s, nmea_fix_t *fix)
+{
+
+    const char *field[NMEA_FIELDS];
+    const char *p;
+    int n = 1;
+    int hi, lo;
+    uint8_t sum = 0;
+
+    field[0] = s;
+    for (p = s; *p != '*' && *p != 0; p++) {
+        sum ^= (uint8_t)*p;
+        if (*p == ',' && n < NMEA_FIELDS) {
+            field[n++] = p + 1;
+        }
+    }
+    if (*p != '*' || (hi = hexValue(p[1])) < 0 || (lo = hexValue(p[2])) < 0 ||
+        (hi << 4 | lo) != sum) {
+        return NMEA_BAD;
+    }
+
+    // Two letter talker then the sentence, and at least one field
+    if (n < 2 || field[1] - s != 6) {
+        return NMEA_OTHER;
+    }
+    if (strncmp(s + 2, "GGA", 3) == 0) {
+        if (n <= GGA_ALT) {
+            return NMEA_BAD;
+        }
+        fix->time = timeOfDay(field[GGA_TIME]);
+        fix->lat = coordFromNmea(field[GGA_LAT], *field[GGA_LAT + 1]);
+        fix->lon = coordFromNmea(field[GGA_LON], *field[GGA_LON + 1]);
+        fix->fixtype = (uint8_t)fixed(field[GGA_FIX], 0);
+        fix->satellites = (uint8_t)fixed(field[GGA_SATS], 0);
+        fix->hdop = fixed(field[GGA_HDOP], 2);
+        fix->altitude = fixed(field[GGA_ALT], 3);
+        return NMEA_GGA;
+    }
+    if (strncmp(s + 2, "RMC", 3) == 0) {
+        if (n <= RMC_DATE) {
+            return NMEA_BAD;
+        }
+        fix->time = timeOfDay(field[RMC_TIME]);
+        fix->valid = (*field[RMC_STATUS] == 'A');
+        fix->lat = coordFromNmea(field[RMC_LAT], *field[RMC_LAT + 1]);
+        fix->lon = coordFromNmea(field[RMC_LON], *field[RMC_LON + 1]);
+        fix->speed = fixed(field[RMC_SPEED], 2);
+        fix->course = fixed(field[RMC_COURSE], 2);
+        fix->date = (uint32_t)fixed(field[RMC_DATE], 0);
+        return NMEA_RMC;
+    }
+    return NMEA_OTHER;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool nmeaChecksum(const char *s)
+{
+
+    uint8_t sum = 0;
+    int hi, lo;
+
+    if (*s == '$') {
+        s++;
+    }
+    for (; *s != '*' && *s != 0; s++) {
+        sum ^= (uint8_t)*s;
+    }
+    return *s == '*' && (hi = hexValue(s[1])) >= 0 && (lo = hexValue(s[2])) >= 0 &&
+           (hi << 4 | lo) == sum;
+
+}
+
+//------------------------------------------------------------------------------
+
+int nmeaCommand(char *out, int len, const char *body)
+{
+
+    static const char hex[] = "0123456789ABCDEF";
+    int n = (int)strlen(body);
+    uint8_t sum = 0;
+
+    // $ body * hh \r \n and the terminator
+    if (n + 7 > len) {
+        return 0;
+    }
+    out[0] = '$';
+    for (int i = 0; i < n; i++) {
+        sum ^= (uint8_t)body[i];
+        out[i + 1] = body[i];
+    }
+    out[n + 1] = '*';
+    out[n + 2] = hex[sum >> 4];
+    out[n + 3] = hex[sum & 0x0F];
+    out[n + 4] = '\r';
+    out[n + 5] = '\n';
+    out[n + 6] = 0;
+    return n + 6;
+
+}
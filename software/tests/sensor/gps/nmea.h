@@ -0,0 +1,155 @@
+/* @file nmea.h
+*
+* This file contains the NMEA sentence framer and queue used by the GPS
+* receiver, and the GGA and RMC decoder. It has no mbed dependencies so it
+* can be run on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <stdint.h>
+#include "geo.h"
+
+// Longest sentence kept, with its terminator. NMEA allows 82 characters
+// with the $ and line end, the MTK PMTK replies stay under that too.
+#define NMEA_LEN 96
+
+// Sentences the queue holds, a power of 2. A 10 Hz fix with RMC, GGA and
+// GSA is three.
+#define NMEA_QUEUE 8
+
+// Framer counters since construction
+typedef struct
+{
+    uint32_t sentences;     // Sentences queued
+    uint32_t dropped;       // Sentences dropped, the queue was full
+    uint32_t overlong;      // Sentences dropped for running past NMEA_LEN
+    uint32_t broken;        // Sentences cut short by the next $
+    uint32_t skipped;       // Bytes outside any sentence, but line ends
+} nmea_stats_t;
+
+// nmeaParse() results
+#define NMEA_BAD   -1   // No checksum, it did not match or fields are missing
+#define NMEA_OTHER  0   // Good, but not a sentence decoded here
+#define NMEA_GGA    1
+#define NMEA_RMC    2
+
+// Most fields split per sentence, GGA has 15 and RMC 13
+#define NMEA_FIELDS 20
+
+// Fix decoded from GGA and RMC, all integers. Each sentence updates its own
+// fields and the time and position they share, an empty field reads 0.
+typedef struct
+{
+    uint32_t time;      // UTC ms since midnight
+    uint32_t date;      // ddmmyy as sent, RMC
+    coord_t lat;        // North positive
+    coord_t lon;        // East positive
+    int32_t altitude;   // mm above mean sea level, GGA
+    int32_t speed;      // 1/100 knot over ground, RMC
+    int32_t course;     // 1/100 deg true, RMC
+    int32_t hdop;       // 1/100, GGA
+    uint8_t fixtype;    // 0 no fix, 1 fix, 2 differential, GGA
+    uint8_t satellites; // Used in the fix, GGA
+    bool valid;         // Status A, RMC
+} nmea_fix_t;
+
+//------------------------------------------------------------------------------
+/** @brief   Frames NMEA sentences out of a serial byte stream and queues them.
+*   @details Bytes go in with put() as the receiver gets them, in any chunk
+*            sizes. A sentence starts at $ and ends at the carriage return or
+*            line feed, it is queued without either, as GPS::NEMA holds it.
+*            A $ inside a sentence starts over, so joining mid stream or a
+*            lost line end costs one sentence. put() and get() may run in an
+*            interrupt and the loop respectively, one of each.
+*/
+
+class NMEA
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor, waits for a $.
+    */
+
+    NMEA();
+
+    //--------------------------------------------------------------------------
+    /** Takes one byte.
+    *
+    *   @return true if it completed a sentence and it was queued.
+    */
+
+    bool put(char c);
+
+    //--------------------------------------------------------------------------
+    /** Takes the oldest queued sentence.
+    *
+    *   @param s   Filled with the sentence, null terminated, without the $
+    *              or line end.
+    *   @param len Size of s, a longer sentence is cut to fit.
+    *   @return    false if the queue is empty.
+    */
+
+    bool get(char *s, int len);
+
+    //--------------------------------------------------------------------------
+    /** Returns the number of sentences waiting.
+    */
+
+    int pending(void) { return (int)(_head - _tail); }
+
+    //--------------------------------------------------------------------------
+    /** Copies the counters.
+    */
+
+    void getStats(nmea_stats_t *stats) { *stats = _stats; }
+
+private:
+
+    char _line[NMEA_LEN];
+    int _len;
+    bool _inSentence;
+
+    char _queue[NMEA_QUEUE][NMEA_LEN];
+    volatile uint32_t _head;    // Written by put()
+    volatile uint32_t _tail;    // Written by get()
+
+    nmea_stats_t _stats;
+
+}; // end of class nmea
+
+//------------------------------------------------------------------------------
+/** Checks and decodes one sentence in a single pass, in place and without
+*   copying or allocating. The checksum is taken while the fields are split,
+*   nothing is decoded unless it matches.
+*
+*   @param s   Sentence as NMEA::get() gives it, without the $ or line end,
+*              any talker, GP or GN.
+*   @param fix Updated from a GGA or RMC, left alone otherwise.
+*   @return    NMEA_GGA, NMEA_RMC, NMEA_OTHER or NMEA_BAD.
+*/
+
+int nmeaParse(const char *s, nmea_fix_t *fix);
+
+//------------------------------------------------------------------------------
+/** Returns true if a sentence has a checksum and it matches, with or without
+*   the $ and line end.
+*/
+
+bool nmeaChecksum(const char *s);
+
+//------------------------------------------------------------------------------
+/** Wraps a sentence body, as in "PMTK220,100", with the $, checksum and
+*   line end to send.
+*
+*   @return Length of out, 0 if it did not fit in len.
+*/
+
+int nmeaCommand(char *out, int len, const char *body);
+
+#endif
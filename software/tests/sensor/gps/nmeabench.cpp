@@ -0,0 +1,373 @@
+/* @file nmeabench.cpp
+*
+* Host benchmark of nmeaParse() against the two parsers it replaces, the
+* sscanf one from GPS.cpp and Adafruit_GPS::parse(), on the recorded style
+* sentences in test_data. Both are copied here as they were, less the
+* serial port, and the positions they give are checked against each other.
+*
+* g++ -O2 -I../../mbed -o nmeabench nmeabench.cpp nmea.cpp geo.cpp && ./nmeabench test_data/ultimate_10hz.nmea
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include "nmea.h"
+
+using std::string;
+
+#define PASSES 20000
+
+static int failed = 0;
+
+void near(const char *what, double got, double want, double tol) {
+    if (fabs(got - want) > tol) {
+        printf("FAIL %s: got %.7f want %.7f\n", what, got, want);
+        failed++;
+    }
+}
+
+//------------------------------------------------------------------------------
+/* GPS::parseData() after getData(), before nmeaParse() */
+
+struct OLDGPS
+{
+    float time;
+    int hours;
+    int minutes;
+    float seconds;
+    char validity, ns, ew;
+    float latitude;
+    float longitude;
+    float speed;
+    float heading;
+    string date;
+    int day;
+    int month;
+    int year;
+    int fixtype;
+    int satellites;
+    float altitude;
+    string fix;
+    string cardinal;
+    float kph;
+    char NEMA[256];
+
+    float trunc(float v)
+    {
+        if(v < 0.0) {
+            v*= -1.0;
+            v = floor(v);
+            v*=-1.0;
+        } else {
+            v = floor(v);
+        }
+        return v;
+    }
+
+    int parse()
+    {
+        sscanf(NEMA, "GPGGA, %*f, %*f, %*c, %*f, %*c, %d, %d, %*f, %f", &fixtype, &satellites, &altitude);
+        if(sscanf(NEMA, "GPRMC, %2d%2d%f, %c, %f, %c, %f, %c, %f, %f, %2d%2d%2d"
+        , &hours, &minutes, &seconds, &validity, &latitude, &ns,
+        &longitude, &ew, &speed, &heading, &day, &month, &year) >=1) {
+            if(fixtype == 0) {
+                return 0;
+            }
+            year += 2000;
+            if(ns =='S') {
+                latitude   *= -1.0;
+            }
+            if(ew =='W') {
+                longitude  *= -1.0;
+            }
+            float degrees = trunc(latitude / 100.0f);
+            float minutes = latitude - (degrees * 100.0f);
+            latitude = degrees + minutes / 60.0f;
+            degrees = trunc(longitude / 100.0f);
+            minutes = longitude - (degrees * 100.0f);
+            longitude = degrees + minutes / 60.0f;
+            if(fixtype == 1) {
+                fix = "Positive";
+            }
+            if(fixtype == 2) {
+                fix = "Differential";
+            }
+            if(heading > 0.00 && heading < 45.00) {
+                cardinal = "NNE";
+            }
+            if(heading == 45.00) {
+                cardinal = "NE";
+            }
+            if(heading > 45.00 && heading < 90.00) {
+                cardinal = "ENE";
+            }
+            if(heading == 90.00) {
+                cardinal = "E";
+            }
+            if(heading > 90.00 && heading < 135.00) {
+                cardinal = "ESE";
+            }
+            if(heading == 135.00) {
+                cardinal = "SE";
+            }
+            if(heading > 135.00 && heading < 180.00) {
+                cardinal = "SSE";
+            }
+            if(heading == 180.00) {
+                cardinal = "S";
+            }
+            if(heading > 180.00 && heading < 225.00) {
+                cardinal = "SSW";
+            }
+            if(heading == 225.00) {
+                cardinal = "SW";
+            }
+            if(heading > 225.00 && heading < 270.00) {
+                cardinal = "WSW";
+            }
+            if(heading == 270.00) {
+                cardinal = "W";
+            }
+            if(heading > 270.00 && heading < 315.00) {
+                cardinal = "WNW";
+            }
+            if(heading == 315.00) {
+                cardinal = "NW";
+            }
+            if(heading > 315.00 && heading < 360.00) {
+                cardinal = "NNW";
+            }
+            if(heading == 360.00 || heading == 0.00) {
+                cardinal = "N";
+            }
+            kph = speed*1.852;
+            return 1;
+        }
+        else {
+        return 0;
+        }
+    }
+};
+
+//------------------------------------------------------------------------------
+/* Adafruit_GPS::parse() as in system/accel_control before the strlen fix */
+
+struct ADAFRUIT
+{
+    uint8_t hour, minute, seconds, year, month, day;
+    uint16_t milliseconds;
+    float latitude, longitude, geoidheight, altitude;
+    float speed, angle, HDOP;
+    char lat, lon;
+    bool fix;
+    uint8_t fixquality, satellites;
+
+    uint8_t parseHex(char c) {
+        if (c < '0')
+          return 0;
+        if (c <= '9')
+          return c - '0';
+        if (c < 'A')
+           return 0;
+        if (c <= 'F')
+           return (c - 'A')+10;
+        return 0;
+    }
+
+    bool parse(char *nmea) {
+      if (nmea[strlen(nmea)-4] == '*') {
+        uint16_t sum = parseHex(nmea[strlen(nmea)-3]) * 16;
+        sum += parseHex(nmea[strlen(nmea)-2]);
+        for (uint8_t i=1; i < (strlen(nmea)-4); i++) {
+          sum ^= nmea[i];
+        }
+        if (sum != 0) {
+          //return false;
+        }
+      }
+      if (strstr(nmea, "$GPGGA")) {
+        char *p = nmea;
+        p = strchr(p, ',')+1;
+        float timef = atof(p);
+        uint32_t time = timef;
+        hour = time / 10000;
+        minute = (time % 10000) / 100;
+        seconds = (time % 100);
+        milliseconds = fmod((double) timef, 1.0) * 1000;
+        p = strchr(p, ',')+1;
+        latitude = atof(p);
+        p = strchr(p, ',')+1;
+        if (p[0] == 'N') lat = 'N';
+        else if (p[0] == 'S') lat = 'S';
+        else if (p[0] == ',') lat = 0;
+        else return false;
+        p = strchr(p, ',')+1;
+        longitude = atof(p);
+        p = strchr(p, ',')+1;
+        if (p[0] == 'W') lon = 'W';
+        else if (p[0] == 'E') lon = 'E';
+        else if (p[0] == ',') lon = 0;
+        else return false;
+        p = strchr(p, ',')+1;
+        fixquality = atoi(p);
+        p = strchr(p, ',')+1;
+        satellites = atoi(p);
+        p = strchr(p, ',')+1;
+        HDOP = atof(p);
+        p = strchr(p, ',')+1;
+        altitude = atof(p);
+        p = strchr(p, ',')+1;
+        p = strchr(p, ',')+1;
+        geoidheight = atof(p);
+        return true;
+      }
+      if (strstr(nmea, "$GPRMC")) {
+        char *p = nmea;
+        p = strchr(p, ',')+1;
+        float timef = atof(p);
+        uint32_t time = timef;
+        hour = time / 10000;
+        minute = (time % 10000) / 100;
+        seconds = (time % 100);
+        milliseconds = fmod((double) timef, 1.0) * 1000;
+        p = strchr(p, ',')+1;
+        if (p[0] == 'A')
+          fix = true;
+        else if (p[0] == 'V')
+          fix = false;
+        else
+          return false;
+        p = strchr(p, ',')+1;
+        latitude = atof(p);
+        p = strchr(p, ',')+1;
+        if (p[0] == 'N') lat = 'N';
+        else if (p[0] == 'S') lat = 'S';
+        else if (p[0] == ',') lat = 0;
+        else return false;
+        p = strchr(p, ',')+1;
+        longitude = atof(p);
+        p = strchr(p, ',')+1;
+        if (p[0] == 'W') lon = 'W';
+        else if (p[0] == 'E') lon = 'E';
+        else if (p[0] == ',') lon = 0;
+        else return false;
+        p = strchr(p, ',')+1;
+        speed = atof(p);
+        p = strchr(p, ',')+1;
+        angle = atof(p);
+        p = strchr(p, ',')+1;
+        uint32_t fulldate = atof(p);
+        day = fulldate / 10000;
+        month = (fulldate % 10000) / 100;
+        year = (fulldate % 100);
+        return true;
+      }
+      return false;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// Sentences per second over passes of the corpus
+double rate(clock_t t0, int count) {
+    return (double)PASSES * count / ((double)(clock() - t0) / CLOCKS_PER_SEC);
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "test_data/ultimate_10hz.nmea";
+    static char data[65536];
+    static char lines[256][NMEA_LEN], dollar[256][NMEA_LEN + 8];
+    static OLDGPS old;
+    static ADAFRUIT ada;
+    nmea_fix_t fix;
+    double oldRate, adaRate, newRate;
+    long len, i;
+    int n = 0, k, rmc = 0;
+    volatile int sink = 0;
+    clock_t t0;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("FAIL cannot open %s\n", path);
+        return 1;
+    }
+    len = fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+
+    // Framed as the receiver would, Adafruit keeps the $ and line end
+    {
+        NMEA nmea;
+        for (i = 0; i < len; i++) {
+            if (nmea.put(data[i])) {
+                nmea.get(lines[n], NMEA_LEN);
+                sprintf(dollar[n], "$%s\r", lines[n]);
+                n++;
+            }
+        }
+    }
+
+    // The same positions, but where the old ones took the bit error
+    memset(&fix, 0, sizeof(fix));
+    old.fixtype = 0;
+    for (k = 0; k < n; k++) {
+        strcpy(old.NEMA, lines[k]);
+        old.parse();
+        ada.parse(dollar[k]);
+        if (nmeaParse(lines[k], &fix) == NMEA_RMC) {
+            near("sscanf latitude", fix.lat / 1e7, old.latitude, 1e-5);
+            near("sscanf longitude", fix.lon / 1e7, old.longitude, 1e-5);
+            near("Adafruit latitude", fix.lat / 1e7,
+                 floor(ada.latitude / 100) + fmod(ada.latitude, 100) / 60, 1e-5);
+            near("Adafruit speed", fix.speed / 100.0, ada.speed, 1e-5);
+            rmc++;
+        }
+    }
+    if (rmc != 29) {
+        printf("FAIL RMC: got %d want 29\n", rmc);
+        failed++;
+    }
+
+    t0 = clock();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (k = 0; k < n; k++) {
+            strcpy(old.NEMA, lines[k]);
+            sink += old.parse();
+        }
+    }
+    oldRate = rate(t0, n);
+
+    t0 = clock();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (k = 0; k < n; k++) {
+            sink += ada.parse(dollar[k]);
+        }
+    }
+    adaRate = rate(t0, n);
+
+    t0 = clock();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (k = 0; k < n; k++) {
+            sink += nmeaParse(lines[k], &fix);
+        }
+    }
+    newRate = rate(t0, n);
+
+    printf("%d sentences, %d passes (host)\n", n, PASSES);
+    printf("GPS sscanf:     %10.0f sentences/s\n", oldRate);
+    printf("Adafruit parse: %10.0f sentences/s\n", adaRate);
+    printf("nmeaParse:      %10.0f sentences/s, %.1fx and %.1fx\n",
+           newRate, newRate / oldRate, newRate / adaRate);
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,205 @@
+/* @file nmeadev.cpp
+*
+* Host test of the NMEA framer and queue against a recorded style byte
+* stream, fed byte by byte and in DMA sized chunks, and of the GGA and RMC
+* decoder.
+*
+* g++ -I../../mbed -o nmeadev nmeadev.cpp nmea.cpp geo.cpp && ./nmeadev test_data/ultimate_10hz.nmea
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nmea.h"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+void same(const char *what, const char *got, const char *want) {
+    if (strcmp(got, want) != 0) {
+        printf("FAIL %s: got \"%s\" want \"%s\"\n", what, got, want);
+        failed++;
+    }
+}
+
+// Appends *hh to a sentence body
+const char *sum(char *out, const char *body) {
+    unsigned char x = 0;
+    for (const char *p = body; *p; p++) {
+        x ^= (unsigned char)*p;
+    }
+    sprintf(out, "%s*%02X", body, x);
+    return out;
+}
+
+// Feeds the stream in chunks of up to chunk bytes, or random sizes for 0,
+// draining the queue after each like the loop would after each interrupt
+int run(NMEA &n, const char *data, long len, int chunk, char out[][NMEA_LEN], int max) {
+    int count = 0;
+    long i = 0;
+
+    while (i < len) {
+        long end = i + (chunk > 0 ? chunk : 1 + rand() % 200);
+        for (; i < len && i < end; i++) {
+            n.put(data[i]);
+        }
+        while (count < max && n.get(out[count], NMEA_LEN)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "test_data/ultimate_10hz.nmea";
+    static char data[65536];
+    static char whole[256][NMEA_LEN], bytes[256][NMEA_LEN], chunks[256][NMEA_LEN];
+    nmea_stats_t st;
+    long len;
+    int n, i;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("FAIL cannot open %s\n", path);
+        return 1;
+    }
+    len = fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+
+    // The recording: joined mid sentence, a PMTK ack, 3 s of 10 Hz GGA and
+    // RMC with a GSA each second, one RMC with a bit error, a burst of line
+    // noise and one sentence cut off by the next
+    {
+        NMEA nmea;
+        n = run(nmea, data, len, 1, whole, 256);
+        nmea.getStats(&st);
+        check("sentences", n, 64);
+        check("stats sentences", st.sentences, 64);
+        check("overlong", st.overlong, 1);
+        check("broken", st.broken, 1);
+        check("skipped", st.skipped, 34 + 133 - NMEA_LEN);
+        same("first", whole[0], "PMTK001,220,3*30");
+        same("second", whole[1], "GPGGA,182104.000,3518.0367,N,12039.7271,W,1,09,0.92,104.3,M,-32.9,M,,*56");
+        same("last", whole[n - 1], "GPRMC,182106.900,A,3518.0421,N,12039.7238,W,0.66,27.70,050617,,,A*41");
+    }
+
+    // Same sentences whatever the interrupts split the bytes into
+    {
+        NMEA nmea;
+        check("DMA half buffers", run(nmea, data, len, 128, bytes, 256), n);
+        for (i = 0; i < n; i++) {
+            same("DMA half buffers", bytes[i], whole[i]);
+        }
+    }
+    srand(5);
+    for (int pass = 0; pass < 20; pass++) {
+        NMEA nmea;
+        check("random chunks", run(nmea, data, len, 0, chunks, 256), n);
+        for (i = 0; i < n; i++) {
+            same("random chunks", chunks[i], whole[i]);
+        }
+    }
+
+    // A consumer that falls behind loses the newest, not the queued ones
+    {
+        NMEA nmea;
+        char s[NMEA_LEN];
+        for (i = 0; i < len; i++) {
+            nmea.put(data[i]);
+        }
+        nmea.getStats(&st);
+        check("queue full", nmea.pending(), NMEA_QUEUE);
+        check("dropped", st.dropped, n - NMEA_QUEUE);
+        nmea.get(s, sizeof(s));
+        same("oldest kept", s, whole[0]);
+        nmea.get(s, 10);
+        check("cut to fit", strlen(s), 9);
+    }
+
+    // Decoding, the recording has 30 GGA and 30 RMC, one of them with a bit
+    // error, a PMTK ack and 3 GSA
+    {
+        nmea_fix_t fix;
+        int count[4] = {0, 0, 0, 0};
+        memset(&fix, 0, sizeof(fix));
+        for (i = 0; i < n; i++) {
+            count[nmeaParse(whole[i], &fix) + 1]++;
+        }
+        check("bad", count[0], 1);
+        check("other", count[1], 4);
+        check("GGA", count[2], 30);
+        check("RMC", count[3], 29);
+        check("last time", fix.time, (18 * 3600 + 21 * 60 + 6) * 1000 + 900);
+        check("last lat", fix.lat, 353007017);
+        check("last lon", fix.lon, -1206620633);
+        check("last speed", fix.speed, 66);
+        check("last course", fix.course, 2770);
+        check("last date", fix.date, 50617);
+        check("last valid", fix.valid, 1);
+
+        check("GGA", nmeaParse(whole[1], &fix), NMEA_GGA);
+        check("GGA time", fix.time, (18 * 3600 + 21 * 60 + 4) * 1000);
+        check("GGA lat", fix.lat, 353006117);
+        check("GGA lon", fix.lon, -1206621183);
+        check("GGA fix", fix.fixtype, 1);
+        check("GGA satellites", fix.satellites, 9);
+        check("GGA hdop", fix.hdop, 92);
+        check("GGA altitude", fix.altitude, 104300);
+    }
+    {
+        nmea_fix_t fix;
+        char s[NMEA_LEN];
+        memset(&fix, 0, sizeof(fix));
+        check("GN talker", nmeaParse(sum(s, "GNRMC,235959.999,A,3352.1280,S,15112.5520,E,12.5,359.9,311299,,,A"), &fix), NMEA_RMC);
+        check("south", fix.lat, -338688000);
+        check("east", fix.lon, 1512092000);
+        check("end of day", fix.time, 86399999);
+        check("speed", fix.speed, 1250);
+        check("course", fix.course, 35990);
+        check("no fix", nmeaParse(sum(s, "GPRMC,,V,,,,,,,,,,N"), &fix), NMEA_RMC);
+        check("no fix valid", fix.valid, 0);
+        check("no fix lat", fix.lat, 0);
+        check("negative altitude", nmeaParse(sum(s, "GPGGA,000000.000,0000.0000,N,00000.0000,E,1,04,1.5,-12.25,M,,M,,"), &fix), NMEA_GGA);
+        check("negative altitude", fix.altitude, -12250);
+        check("short", nmeaParse(sum(s, "GPRMC,182106.900,A"), &fix), NMEA_BAD);
+        check("no checksum", nmeaParse("GPRMC,182106.900,A,3518.0421,N,12039.7238,W,0.66,27.70,050617,,,A", &fix), NMEA_BAD);
+        check("cut checksum", nmeaParse("PMTK001,220,3*3", &fix), NMEA_BAD);
+        check("PMTK", nmeaParse("PMTK001,220,3*30", &fix), NMEA_OTHER);
+        check("no fields", nmeaParse(sum(s, "GPRMC"), &fix), NMEA_OTHER);
+        check("no fields short", nmeaParse(sum(s, "PMTK605"), &fix), NMEA_OTHER);
+        check("untouched", fix.altitude, -12250);
+    }
+
+    // Cost per byte on the host
+    {
+        NMEA nmea;
+        char s[NMEA_LEN];
+        clock_t t0 = clock();
+        for (int pass = 0; pass < 2000; pass++) {
+            for (i = 0; i < len; i++) {
+                if (nmea.put(data[i])) {
+                    nmea.get(s, sizeof(s));
+                }
+            }
+        }
+        printf("put: %.2f ns per byte (host)\n",
+               (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / (2000.0 * len));
+    }
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* @file heading.cpp
+*
+* This file contains fast angle helpers and the continuous heading used by
+* the IMU.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "heading.h"
+
+#define PI_F 3.14159265f
+#define RAD_TO_DEG (180.0f / PI_F)
+
+// Past this float has no fraction left to fold, and inf or NaN never fold
+#define WRAP_LIMIT 16777216.0f
+
+//------------------------------------------------------------------------------
+
+float fastAtan2(float y, float x)
+{
+
+    float ax = x < 0 ? -x : x;
+    float ay = y < 0 ? -y : y;
+    float z, z2, a;
+
+    if (ax == 0 && ay == 0) {
+        return 0;
+    }
+
+    // atan on [0, 1] by an odd minimax polynomial, then fold the octants
+    z = ax > ay ? ay / ax : ax / ay;
+    z2 = z * z;
+    a = z * (0.99997726f + z2 * (-0.33262347f + z2 * (0.19354346f +
+        z2 * (-0.11643287f + z2 * (0.05265332f + z2 * -0.01172120f)))));
+
+    if (ay > ax) {
+        a = PI_F / 2 - a;
+    }
+    if (x < 0) {
+        a = PI_F - a;
+    }
+    return y < 0 ? -a : a;
+
+}
+
+//------------------------------------------------------------------------------
+
+float angleWrap180(float a)
+{
+
+    a = angleWrap360(a);
+
+    // Above 180 by less than half a step, -180 is the same angle
+    if (a >= 180.0f) {
+        a -= 360.0f;
+    }
+    return a;
+
+}
+
+//------------------------------------------------------------------------------
+
+float angleWrap360(float a)
+{
+
+    if (!(a > -WRAP_LIMIT && a < WRAP_LIMIT)) {
+        return 0.0f;
+    }
+
+    a -= 360.0f * (float)(int)(a / 360.0f);
+    if (a < 0.0f) {
+        a += 360.0f;
+    }
+
+    // A tiny negative angle rounds up to 360 when moved
+    if (a >= 360.0f) {
+        a = 0.0f;
+    }
+    return a;
+
+}
+
+//------------------------------------------------------------------------------
+
+float angleDiff(float a, float b)
+{
+
+    return angleWrap180(a - b);
+
+}
+
+//------------------------------------------------------------------------------
+
+float quatHeading(float w, float x, float y, float z)
+{
+
+    // Yaw about z is counter clockwise, the compass heading clockwise
+    float yaw = fastAtan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z));
+
+    return angleWrap360(-yaw * RAD_TO_DEG);
+
+}
+
+//------------------------------------------------------------------------------
+
+HEADING::HEADING()
+{
+
+    reset();
+
+}
+
+//------------------------------------------------------------------------------
+
+float HEADING::update(float heading)
+{
+
+    if (!_started) {
+        _started = true;
+        _value = heading;
+    } else {
+        _value += angleDiff(heading, _last);
+    }
+    _last = heading;
+    return _value;
+
+}
+
+//------------------------------------------------------------------------------
+
+void HEADING::reset(void)
+{
+
+    _started = false;
+    _last = 0;
+    _value = 0;
+
+}
@@ -0,0 +1,81 @@
+/* @file heading.h
+*
+* This file contains fast angle helpers and the continuous heading used by
+* the IMU. It has no mbed dependencies so it can be checked on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef HEADING_H
+#define HEADING_H
+
+//------------------------------------------------------------------------------
+/* Angle helpers, all in degrees unless named otherwise */
+
+// atan2() in radians to within 3e-6 rad, without the libm call
+float fastAtan2(float y, float x);
+
+// Angle folded into [-180, 180), 0 for inf or NaN
+float angleWrap180(float a);
+
+// Angle folded into [0, 360), 0 for inf or NaN
+float angleWrap360(float a);
+
+// Shortest turn from b to a, in [-180, 180)
+float angleDiff(float a, float b);
+
+// Compass heading of a unit quaternion, clockwise from north in [0, 360)
+// like the BNO055 Euler heading
+float quatHeading(float w, float x, float y, float z);
+
+//------------------------------------------------------------------------------
+/** @brief   Heading that keeps counting past 360 instead of wrapping.
+*   @details Each update adds the shortest turn from the previous heading,
+*            so one full turn clockwise reads 360 more, never a jump from
+*            359 to 0. A controller holding a setpoint from the same
+*            HEADING sees a smooth error all the way round. Updates must
+*            come often enough that the heading turns less than 180 degrees
+*            between them.
+*/
+
+class HEADING
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor, the first update sets the start.
+    */
+
+    HEADING();
+
+    //--------------------------------------------------------------------------
+    /** Adds a new heading reading.
+    *
+    *   @param heading Heading in degrees, any wrap.
+    *   @return        Continuous heading in degrees.
+    */
+
+    float update(float heading);
+
+    //--------------------------------------------------------------------------
+    /** Returns the continuous heading in degrees.
+    */
+
+    float value(void) { return _value; }
+
+    //--------------------------------------------------------------------------
+    /** Starts over, the next update is taken as it is.
+    */
+
+    void reset(void);
+
+private:
+
+    bool _started;
+    float _last;        // Last reading
+    float _value;       // Continuous heading
+
+}; // end of class heading
+
+#endif
@@ -0,0 +1,121 @@
+/* @file headingdev.cpp
+*
+* Host check of the fast atan2, the angle helpers and the continuous heading.
+*
+* g++ -O2 -o headingdev headingdev.cpp heading.cpp && ./headingdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "heading.h"
+
+static int failed = 0;
+
+void near(const char *what, double got, double want, double tol) {
+    if (fabs(got - want) > tol) {
+        printf("FAIL %s: got %f want %f\n", what, got, want);
+        failed++;
+    }
+}
+
+// Unit quaternion turning yaw degrees counter clockwise about z, after a tilt
+// of pitch degrees about y
+void yawQuat(double yaw, double pitch, float q[4]) {
+    double cy = cos(yaw * M_PI / 360), sy = sin(yaw * M_PI / 360);
+    double cp = cos(pitch * M_PI / 360), sp = sin(pitch * M_PI / 360);
+    q[0] = cy * cp;
+    q[1] = -sy * sp;
+    q[2] = cy * sp;
+    q[3] = sy * cp;
+}
+
+int main() {
+    double worst = 0;
+    float q[4];
+    int i;
+
+    // fastAtan2 against atan2 all the way round and across magnitudes
+    for (i = 0; i < 100000; i++) {
+        double a = i * 2 * M_PI / 100000 - M_PI;
+        for (double r = 1e-3; r < 1e4; r *= 10) {
+            float y = r * sin(a), x = r * cos(a);
+            double e = fabs(fastAtan2(y, x) - atan2((double)y, (double)x));
+            if (e > M_PI) {
+                e = 2 * M_PI - e;
+            }
+            if (e > worst) {
+                worst = e;
+            }
+        }
+    }
+    printf("fastAtan2 worst error %.2e rad\n", worst);
+    near("fastAtan2 accuracy", worst, 0, 3e-6);
+    near("fastAtan2 axes", fastAtan2(0, -1), M_PI, 1e-6);
+    near("fastAtan2 origin", fastAtan2(0, 0), 0, 0);
+
+    // Wrapping
+    near("wrap 180", angleWrap180(180), -180, 0);
+    near("wrap -540", angleWrap180(-540), -180, 0);
+    near("wrap 360", angleWrap360(-0.5f), 359.5, 1e-4);
+    near("wrap 360 tiny negative", angleWrap360(-1e-6f) < 360.0f, 1, 0);
+    near("wrap 180 tiny negative", angleWrap180(-180.00001f) < 180.0f, 1, 0);
+    near("wrap 360 far", angleWrap360(3600090.0f), 90, 1);
+    near("wrap 360 inf", angleWrap360(INFINITY), 0, 0);
+    near("wrap 180 -inf", angleWrap180(-INFINITY), 0, 0);
+    near("wrap 360 NaN", angleWrap360(NAN), 0, 0);
+    near("diff across north", angleDiff(2, 358), 4, 1e-4);
+    near("diff back across north", angleDiff(358, 2), -4, 1e-4);
+    near("diff", angleDiff(90, 45), 45, 0);
+
+    // Quaternion heading is clockwise, and ignores tilt
+    for (int yaw = -179; yaw < 180; yaw += 7) {
+        yawQuat(yaw, 20, q);
+        near("quat heading", quatHeading(q[0], q[1], q[2], q[3]),
+             angleWrap360(-yaw), 1e-3);
+    }
+
+    // Continuous heading through north and back, three turns each way
+    {
+        HEADING h;
+        double truth = 350;
+        near("first", h.update(350), 350, 0);
+        for (i = 0; i < 3 * 360; i++) {
+            truth += 1;
+            h.update(angleWrap360(truth));
+        }
+        near("three turns clockwise", h.value(), truth, 1e-2);
+        for (i = 0; i < 6 * 360 / 7; i++) {
+            truth -= 7;
+            h.update(angleWrap180(truth));
+        }
+        near("turns back", h.value(), truth, 1e-2);
+        h.reset();
+        near("reset", h.update(10), 10, 0);
+    }
+
+    // Cost per call on the host, against libm
+    {
+        clock_t t0 = clock();
+        float sink = 0;
+        for (i = 0; i < 10000000; i++) {
+            sink += fastAtan2(i & 1023, 512 - (i & 511));
+        }
+        double fast = (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / 10000000;
+        t0 = clock();
+        for (i = 0; i < 10000000; i++) {
+            sink += atan2f(i & 1023, 512 - (i & 511));
+        }
+        printf("fastAtan2 %.1f ns, atan2f %.1f ns per call (host, %g)\n", fast,
+               (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / 10000000, sink);
+    }
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
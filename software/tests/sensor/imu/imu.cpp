@@ -8,10 +8,33 @@
 #include "imu.h"          // Include header for the imu class
 
 //------------------------------------------------------------------------------
+/* Little endian 16 bit register pair, LSB at data[0] */
 
-IMU::IMU(PinName sda, PinName scl, char chip_addr,  bool verbose, PinName tx, PinName rx): _i2c(sda, scl), _ser(tx, rx), _verbose(verbose), addr(chip_addr)
+static inline int16_t word(const char *data)
 {
-    _i2c.frequency(40000);
+
+    return (int16_t)(((uint8_t)data[1] << 8) | (uint8_t)data[0]);
+
+}
+
+// Register pair in the readAll() burst
+#define BURST(reg) (&data[(reg) - BNO055_ACCEL_DATA_X_LSB_ADDR])
+
+// Gyro 1/16 deg/s to rad/s
+#define GYRO_TO_RAD (3.14159265f / 180 / 16)
+
+//------------------------------------------------------------------------------
+
+IMU::IMU(PinName sda, PinName scl, char chip_addr,  bool verbose, PinName tx, PinName rx): _i2c(sda, scl), _ser(tx, rx), _verbose(verbose), addr(chip_addr), _samples(imu_data_t())
+{
+    _i2c.frequency(IMU_I2C_FREQUENCY);
+    _reg = BNO055_ACCEL_DATA_X_LSB_ADDR;
+    _busy = false;
+    _burstTime = 0;
+    _errors = 0;
+    _filter = NULL;
+    _fusion = NULL;
+    _burstLen = IMU_BURST_LEN;
 
     char reg[1] = {BNO055_CHIP_ID_ADDR};
     char id[1];
@@ -38,6 +61,9 @@ void IMU::setOpMode(char mode)
 {
     char data[2] = {BNO055_OPR_MODE_ADDR, mode};
     _i2c.write(addr, data, 2);
+
+    // Switching takes 19 ms into config mode and 7 ms out of it
+    wait_ms(mode == OPERATION_MODE_CONFIG ? 19 : 7);
     if(_verbose == true)
     {
         _ser.printf("IMU operation mode set\r\n");
@@ -179,6 +205,161 @@ void IMU::getSysStatus(void)
 
 //------------------------------------------------------------------------------
 
+void IMU::getCalibStatus(imu_calib_status_t *s)
+{
+
+    char stat;
+    char reg[1] = {BNO055_CALIB_STAT_ADDR};
+
+    _i2c.write(addr, reg, 1, true);
+    _i2c.read(addr, &stat, 1);
+
+    s->sys = (stat >> 6) & 0x03;
+    s->gyro = (stat >> 4) & 0x03;
+    s->accel = (stat >> 2) & 0x03;
+    s->mag = stat & 0x03;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMU::isCalibrated(void)
+{
+
+    imu_calib_status_t s;
+    char mode = getOpMode() & 0x0F;
+
+    getCalibStatus(&s);
+    if (s.gyro < 3 || s.accel < 3) {
+        return false;
+    }
+    return mode == OPERATION_MODE_IMUPLUS || s.mag == 3;
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::getCalibration(imu_calib_t *c)
+{
+
+    char data[IMU_CALIB_LEN];
+    char currentMode = getOpMode();
+
+    // The offset registers only read back in config mode
+    setOpMode(OPERATION_MODE_CONFIG);
+    data[0] = ACCEL_OFFSET_X_LSB_ADDR;
+    _i2c.write(addr, data, 1, true);
+    _i2c.read(addr, data, IMU_CALIB_LEN);
+    setOpMode(currentMode);
+
+    for (int i = 0; i < 3; i++) {
+        c->accelOffset[i] = word(&data[2 * i]);
+        c->magOffset[i] = word(&data[6 + 2 * i]);
+        c->gyroOffset[i] = word(&data[12 + 2 * i]);
+    }
+    c->accelRadius = word(&data[18]);
+    c->magRadius = word(&data[20]);
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::setCalibration(const imu_calib_t *c)
+{
+
+    char data[IMU_CALIB_LEN + 1];
+    char currentMode = getOpMode();
+    int16_t words[IMU_CALIB_LEN / 2];
+
+    for (int i = 0; i < 3; i++) {
+        words[i] = c->accelOffset[i];
+        words[3 + i] = c->magOffset[i];
+        words[6 + i] = c->gyroOffset[i];
+    }
+    words[9] = c->accelRadius;
+    words[10] = c->magRadius;
+
+    data[0] = ACCEL_OFFSET_X_LSB_ADDR;
+    for (int i = 0; i < IMU_CALIB_LEN / 2; i++) {
+        data[1 + 2 * i] = (char)(words[i] & 0xFF);
+        data[2 + 2 * i] = (char)((words[i] >> 8) & 0xFF);
+    }
+
+    setOpMode(OPERATION_MODE_CONFIG);
+    _i2c.write(addr, data, IMU_CALIB_LEN + 1);
+    setOpMode(currentMode);
+
+    if(_verbose == true)
+    {
+        _ser.printf("IMU calibration set\r\n");
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMU::saveCalibration(const char *path)
+{
+
+    imu_calib_t c;
+    FILE *fp;
+    int ok;
+
+    getCalibration(&c);
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        return false;
+    }
+
+    // One line of text: tag, accel offset, mag offset, gyro offset, radii
+    ok = fprintf(fp, "BNO055 %d %d %d %d %d %d %d %d %d %d %d\r\n",
+                 c.accelOffset[0], c.accelOffset[1], c.accelOffset[2],
+                 c.magOffset[0], c.magOffset[1], c.magOffset[2],
+                 c.gyroOffset[0], c.gyroOffset[1], c.gyroOffset[2],
+                 c.accelRadius, c.magRadius) > 0;
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    return ok;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMU::loadCalibration(const char *path)
+{
+
+    imu_calib_t c;
+    int v[IMU_CALIB_LEN / 2];
+    FILE *fp;
+    int n;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    n = fscanf(fp, "BNO055 %d %d %d %d %d %d %d %d %d %d %d",
+               &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+               &v[6], &v[7], &v[8], &v[9], &v[10]);
+    fclose(fp);
+    if (n != IMU_CALIB_LEN / 2) {
+        return false;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        c.accelOffset[i] = (int16_t)v[i];
+        c.magOffset[i] = (int16_t)v[3 + i];
+        c.gyroOffset[i] = (int16_t)v[6 + i];
+    }
+    c.accelRadius = (int16_t)v[9];
+    c.magRadius = (int16_t)v[10];
+    setCalibration(&c);
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
 char IMU::getOpMode(void)
 {
 
@@ -197,19 +378,14 @@ void IMU::getEulerAng(imu_euler_t *e)
 {
 
     char data[6];
-    int16_t h, p, r;
 
     data[0] = BNO055_EULER_H_LSB_ADDR;
     _i2c.write(addr, data, 1, true);
     _i2c.read(addr, data, 6);
 
-    h = data[1] << 8 | data[0];
-    p = data[3] << 8 | data[2];
-    r = data[5] << 8 | data[4];
-
-    e->heading = (float)h / 16;
-    e->pitch = (float)p / 16;
-    e->roll = (float)r / 16;
+    e->heading = (float)word(&data[0]) / 16;
+    e->pitch = (float)word(&data[2]) / 16;
+    e->roll = (float)word(&data[4]) / 16;
 
 }
 
@@ -219,19 +395,14 @@ void IMU::getLinAccel(imu_lin_accel_t *la)
 {
 
     char data[6];
-    int16_t x, y, z;
 
     data[0] = BNO055_LINEAR_ACCEL_DATA_X_LSB_ADDR;
     _i2c.write(addr, data, 1, true);
     _i2c.read(addr, data, 6);
 
-    x = data[1] << 8 | data[0];
-    y = data[3] << 8 | data[2];
-    z = data[5] << 8 | data[4];
-
-    la->x = (float)x;
-    la->y = (float)y;
-    la->z = (float)z;
+    la->x = (float)word(&data[0]);
+    la->y = (float)word(&data[2]);
+    la->z = (float)word(&data[4]);
 
 }
 
@@ -241,18 +412,288 @@ void IMU::getGravity(imu_gravity_t *g)
 {
 
     char data[6];
-    int16_t x, y, z;
 
     data[0] = BNO055_GRAVITY_DATA_X_LSB_ADDR;
     _i2c.write(addr, data, 1, true);
     _i2c.read(addr, data, 6);
 
-    x = data[1] << 8 | data[0];
-    y = data[3] << 8 | data[2];
-    z = data[5] << 8 | data[4];
+    g->x = (float)word(&data[0]);
+    g->y = (float)word(&data[2]);
+    g->z = (float)word(&data[4]);
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::getQuaternion(imu_quat_t *q)
+{
+
+    char data[8];
+
+    data[0] = BNO055_QUATERNION_DATA_W_LSB_ADDR;
+    _i2c.write(addr, data, 1, true);
+    _i2c.read(addr, data, 8);
+
+    // 1 = 2^14 LSB
+    q->w = (float)word(&data[0]) / 16384;
+    q->x = (float)word(&data[2]) / 16384;
+    q->y = (float)word(&data[4]) / 16384;
+    q->z = (float)word(&data[6]) / 16384;
+
+}
+
+//------------------------------------------------------------------------------
+
+float IMU::getHeading(void)
+{
+
+    imu_quat_t q;
+
+    getQuaternion(&q);
+    return heading(q);
+
+}
+
+//------------------------------------------------------------------------------
+
+float IMU::heading(const imu_quat_t &q)
+{
+
+    return _heading.update(quatHeading(q.w, q.x, q.y, q.z));
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::resetHeading(void)
+{
+
+    _heading.reset();
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMU::readAll(imu_data_t *d)
+{
+
+    char data[IMU_BURST_LEN];
+    uint32_t time = us_ticker_read();
+
+    data[0] = BNO055_ACCEL_DATA_X_LSB_ADDR;
+    if (_i2c.write(addr, data, 1, true) != 0 ||
+        _i2c.read(addr, data, IMU_BURST_LEN) != 0) {
+        return false;
+    }
+
+    decode(data, d);
+    d->time = time;
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::start(float period)
+{
+
+    _burstLen = _fusion != NULL ? IMU_RAW_LEN : IMU_BURST_LEN;
+    _ticker.attach(callback(this, &IMU::startBurst), period);
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::stop(void)
+{
+
+    uint32_t begin = us_ticker_read();
+
+    _ticker.detach();
+    while (_busy) {
+        if (us_ticker_read() - begin > IMU_STOP_TIMEOUT_US) {
+            // The completion callback is not coming, take the bus back
+            core_util_critical_section_enter();
+            if (_busy) {
+                _i2c.abort_transfer();
+                _busy = false;
+                _errors++;
+            }
+            core_util_critical_section_exit();
+        }
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMU::sample(imu_data_t *d, uint32_t *seen)
+{
+
+    return _samples.read(d, seen);
+
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t IMU::getErrors(void)
+{
+
+    return _errors;
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::filter(IMUFILTER *f)
+{
+
+    core_util_critical_section_enter();
+    _filter = f;
+    core_util_critical_section_exit();
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::fusion(MAHONY *f)
+{
+
+    core_util_critical_section_enter();
+    _fusion = f;
+    core_util_critical_section_exit();
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::setRawMode(void)
+{
+
+    char data[2];
+
+    setOpMode(OPERATION_MODE_CONFIG);
+
+    // The sensor configurations are on page 1 and only take in config mode
+    data[0] = BNO055_PAGE_ID_ADDR;
+    data[1] = 1;
+    _i2c.write(addr, data, 2);
+    data[0] = BNO055_ACC_CONFIG_ADDR;
+    data[1] = ACC_CONFIG_RAW;
+    _i2c.write(addr, data, 2);
+    data[0] = BNO055_GYRO_CONFIG_0_ADDR;
+    data[1] = GYRO_CONFIG_0_RAW;
+    _i2c.write(addr, data, 2);
+    data[0] = BNO055_MAG_CONFIG_ADDR;
+    data[1] = MAG_CONFIG_RAW;
+    _i2c.write(addr, data, 2);
+    data[0] = BNO055_PAGE_ID_ADDR;
+    data[1] = 0;
+    _i2c.write(addr, data, 2);
+
+    setOpMode(OPERATION_MODE_AMG);
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::startBurst(void)
+{
+
+    // Still reading the last one, the bus is slower than the period
+    if (_busy) {
+        _errors++;
+        return;
+    }
+
+    _busy = true;
+    _burstTime = us_ticker_read();
+    if (_i2c.transfer(addr, &_reg, 1, _burst, _burstLen,
+                      event_callback_t(this, &IMU::burstDone),
+                      I2C_EVENT_ALL) != 0) {
+        _busy = false;
+        _errors++;
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::burstDone(int event)
+{
+
+    imu_data_t *d;
+
+    if (event & I2C_EVENT_TRANSFER_COMPLETE) {
+        d = _samples.begin();
+        decode(_burst, d, _burstLen);
+        d->time = _burstTime;
+        if (_fusion != NULL) {
+            float q[4];
+            _fusion->update(d->gyro.x * GYRO_TO_RAD, d->gyro.y * GYRO_TO_RAD,
+                            d->gyro.z * GYRO_TO_RAD, d->accel.x, d->accel.y,
+                            d->accel.z, d->mag.x, d->mag.y, d->mag.z);
+            _fusion->getQuaternion(q);
+            d->quat.w = q[0];
+            d->quat.x = q[1];
+            d->quat.y = q[2];
+            d->quat.z = q[3];
+            d->euler.heading = _fusion->heading();
+        }
+        _samples.commit();
+        if (_filter != NULL) {
+            _filter->put(d->time, d->linAccel.x, d->linAccel.y, d->linAccel.z);
+        }
+    } else {
+        _errors++;
+    }
+    _busy = false;
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMU::decode(const char *data, imu_data_t *d, int len)
+{
+
+    d->accel.x = (float)word(BURST(BNO055_ACCEL_DATA_X_LSB_ADDR));
+    d->accel.y = (float)word(BURST(BNO055_ACCEL_DATA_Y_LSB_ADDR));
+    d->accel.z = (float)word(BURST(BNO055_ACCEL_DATA_Z_LSB_ADDR));
+
+    d->mag.x = (float)word(BURST(BNO055_MAG_DATA_X_LSB_ADDR));
+    d->mag.y = (float)word(BURST(BNO055_MAG_DATA_Y_LSB_ADDR));
+    d->mag.z = (float)word(BURST(BNO055_MAG_DATA_Z_LSB_ADDR));
+
+    d->gyro.x = (float)word(BURST(BNO055_GYRO_DATA_X_LSB_ADDR));
+    d->gyro.y = (float)word(BURST(BNO055_GYRO_DATA_Y_LSB_ADDR));
+    d->gyro.z = (float)word(BURST(BNO055_GYRO_DATA_Z_LSB_ADDR));
+
+    // Raw readings only, the fused ones were not read
+    if (len < IMU_BURST_LEN) {
+        d->euler = imu_euler_t();
+        d->quat = imu_quat_t();
+        d->linAccel = imu_lin_accel_t();
+        d->gravity = imu_gravity_t();
+        return;
+    }
+
+    // Same order as getEulerAng()
+    d->euler.heading = (float)word(BURST(BNO055_EULER_H_LSB_ADDR)) / 16;
+    d->euler.pitch = (float)word(BURST(BNO055_EULER_R_LSB_ADDR)) / 16;
+    d->euler.roll = (float)word(BURST(BNO055_EULER_P_LSB_ADDR)) / 16;
+
+    // 1 = 2^14 LSB
+    d->quat.w = (float)word(BURST(BNO055_QUATERNION_DATA_W_LSB_ADDR)) / 16384;
+    d->quat.x = (float)word(BURST(BNO055_QUATERNION_DATA_X_LSB_ADDR)) / 16384;
+    d->quat.y = (float)word(BURST(BNO055_QUATERNION_DATA_Y_LSB_ADDR)) / 16384;
+    d->quat.z = (float)word(BURST(BNO055_QUATERNION_DATA_Z_LSB_ADDR)) / 16384;
+
+    d->linAccel.x = (float)word(BURST(BNO055_LINEAR_ACCEL_DATA_X_LSB_ADDR));
+    d->linAccel.y = (float)word(BURST(BNO055_LINEAR_ACCEL_DATA_Y_LSB_ADDR));
+    d->linAccel.z = (float)word(BURST(BNO055_LINEAR_ACCEL_DATA_Z_LSB_ADDR));
 
-    g->x = (float)x;
-    g->y = (float)y;
-    g->z = (float)z;
+    d->gravity.x = (float)word(BURST(BNO055_GRAVITY_DATA_X_LSB_ADDR));
+    d->gravity.y = (float)word(BURST(BNO055_GRAVITY_DATA_Y_LSB_ADDR));
+    d->gravity.z = (float)word(BURST(BNO055_GRAVITY_DATA_Z_LSB_ADDR));
 
 }
\ No newline at end of file
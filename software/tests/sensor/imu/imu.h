@@ -10,6 +10,32 @@
 #define IMU_H_
 
 #include "mbed.h"           // Includes header for mbed drivers
+#include "snapshot.h"       // Includes header for sample hand over
+#include "imufilter.h"      // Includes header for sample filtering
+#include "heading.h"        // Includes header for the continuous heading
+#include "mahony.h"         // Includes header for orientation on the MCU
+
+// I2C clock, the BNO055 supports fast mode
+#define IMU_I2C_FREQUENCY 400000
+
+// Bytes in a burst of every data register, accel X LSB to gravity Z MSB
+#define IMU_BURST_LEN 44
+
+// Seconds between background bursts, the fusion output rate
+#define IMU_SAMPLE_PERIOD 0.01
+
+// Longest stop() waits for a burst in flight before aborting it (us), a
+// full burst takes about 1.2 ms at 400 kHz
+#define IMU_STOP_TIMEOUT_US 5000
+
+// Bytes of raw readings, accel X LSB to gyro Z MSB, all the raw modes have
+#define IMU_RAW_LEN 18
+
+// Seconds between background bursts of raw readings for fusion on the MCU
+#define IMU_RAW_PERIOD 0.0025
+
+// Bytes of calibration offsets and radii, accel offset X LSB to mag radius MSB
+#define IMU_CALIB_LEN 22
 
 //------------------------------------------------------------------------------
 /** @brief   This class will enable the 9 DOF IMU breakout board to communicate
@@ -20,13 +46,6 @@
 
 class IMU
 {
-private:
-
-    I2C _i2c;
-    Serial _ser;
-    bool _verbose;
-    char addr;
-
 public:
 
     //--------------------------------------------------------------------------
@@ -56,6 +75,55 @@ public:
         float z;
     } imu_gravity_t;
 
+    // Raw sensor axes
+    typedef struct
+    {
+        float x;
+        float y;
+        float z;
+    } imu_vector_t;
+
+    // Orientation quaternion
+    typedef struct
+    {
+        float w;
+        float x;
+        float y;
+        float z;
+    } imu_quat_t;
+
+    // Calibration status, 0 (none) to 3 (fully calibrated) each
+    typedef struct
+    {
+        uint8_t sys;
+        uint8_t gyro;
+        uint8_t accel;
+        uint8_t mag;
+    } imu_calib_status_t;
+
+    // Calibration profile, the offset and radius registers as they are
+    typedef struct
+    {
+        int16_t accelOffset[3];     // 1/100 m/s^2
+        int16_t magOffset[3];       // 1/16 uT
+        int16_t gyroOffset[3];      // 1/16 deg/s
+        int16_t accelRadius;
+        int16_t magRadius;
+    } imu_calib_t;
+
+    // Every data register, from one burst read
+    typedef struct
+    {
+        uint32_t time;              // us_ticker time the burst started
+        imu_vector_t accel;         // 1/100 m/s^2
+        imu_vector_t mag;           // 1/16 uT
+        imu_vector_t gyro;          // 1/16 deg/s
+        imu_euler_t euler;          // deg, as getEulerAng()
+        imu_quat_t quat;            // Unit quaternion
+        imu_lin_accel_t linAccel;   // 1/100 m/s^2, as getLinAccel()
+        imu_gravity_t gravity;      // 1/100 m/s^2, as getGravity()
+    } imu_data_t;
+
     //--------------------------------------------------------------------------
     /** Constructor that sets up the 9 DOF IMU object.
     *
@@ -147,6 +215,69 @@ public:
 
     void getSysStatus(void);
 
+    //--------------------------------------------------------------------------
+    /** Reads the calibration status register (0x35).
+    *
+    * Each sensor reads 3 once the fusion trusts its offsets. After
+    * setCalibration() the offsets are in use straight away but the status
+    * only climbs as the sensor sees some motion, the gyro as soon as it is
+    * held still.
+    *
+    *   @param s Filled with the status of the system and each sensor.
+    */
+
+    void getCalibStatus(imu_calib_status_t *s);
+
+    //--------------------------------------------------------------------------
+    /** Returns true if the sensors the current mode fuses are calibrated.
+    *
+    * IMUPLUS only fuses the gyro and accelerometer, the magnetometer
+    * counts as well in the modes that use it.
+    */
+
+    bool isCalibrated(void);
+
+    //--------------------------------------------------------------------------
+    /** Reads the calibration offsets and radii.
+    *
+    * Switches to config mode for the read, the data registers stop for
+    * about 30 ms, and back. Not while start() is running.
+    *
+    *   @param c Filled with the profile.
+    */
+
+    void getCalibration(imu_calib_t *c);
+
+    //--------------------------------------------------------------------------
+    /** Writes calibration offsets and radii, as read by getCalibration().
+    *
+    *   @param c Profile to restore.
+    */
+
+    void setCalibration(const imu_calib_t *c);
+
+    //--------------------------------------------------------------------------
+    /** Saves the calibration profile to a file, usually on the SD card.
+    *
+    *   @param path File to write, for example "/sd/imucal.txt".
+    *   @return     false if the file could not be written.
+    */
+
+    bool saveCalibration(const char *path);
+
+    //--------------------------------------------------------------------------
+    /** Restores a calibration profile saved by saveCalibration().
+    *
+    * The fusion then starts from the offsets of the last run rather than
+    * converging from scratch, so the heading is usable once the gyro
+    * reads calibrated, within a fraction of a second at rest.
+    *
+    *   @param path File to read.
+    *   @return     false if there is no valid profile, nothing is written.
+    */
+
+    bool loadCalibration(const char *path);
+
     //--------------------------------------------------------------------------
     /** TODO
     *
@@ -187,6 +318,158 @@ public:
 
     void getGravity(imu_gravity_t *g);
 
+    //--------------------------------------------------------------------------
+    /** Reads the orientation quaternion registers.
+    *
+    *   @param q Filled with the unit quaternion.
+    */
+
+    void getQuaternion(imu_quat_t *q);
+
+    //--------------------------------------------------------------------------
+    /** Reads the heading as a continuous angle.
+    *
+    * Reads the quaternion and passes it to heading(). Turning past north
+    * reads 360 or -1 rather than jumping, so a heading controller can take
+    * the difference to its setpoint straight.
+    *
+    *   @return Heading in degrees, clockwise, unwrapped.
+    */
+
+    float getHeading(void);
+
+    //--------------------------------------------------------------------------
+    /** Unwraps the heading of a quaternion already read.
+    *
+    * For samples from readAll() or sample(). Shares its unwrapping with
+    * getHeading(), so feed it from one source, often enough that the
+    * heading turns under 180 degrees between calls.
+    *
+    *   @param q Quaternion from the IMU.
+    *   @return  Heading in degrees, clockwise, unwrapped.
+    */
+
+    float heading(const imu_quat_t &q);
+
+    //--------------------------------------------------------------------------
+    /** Starts the continuous heading over from the next reading.
+    */
+
+    void resetHeading(void);
+
+    //--------------------------------------------------------------------------
+    /** Reads every data register in one transaction.
+    *
+    * Reads 0x08 to 0x33, accel through gravity, in a single burst. Takes
+    * about 1 ms on the bus where the three getters above take three
+    * transactions, and the values all come from the same fusion output.
+    *
+    *   @param d Filled with every reading, in the getters' units.
+    *   @return  false if the IMU did not answer, d is left as it was.
+    */
+
+    bool readAll(imu_data_t *d);
+
+    //--------------------------------------------------------------------------
+    /** Starts reading every data register in the background.
+    *
+    * A Ticker starts the readAll() burst as an interrupt driven transfer
+    * every period and the control loop carries on. Each finished burst is
+    * published for sample(). The blocking functions share the bus, do not
+    * call them until stop().
+    *
+    *   @param period Seconds between bursts.
+    */
+
+    void start(float period = IMU_SAMPLE_PERIOD);
+
+    //--------------------------------------------------------------------------
+    /** Stops the background reads, waiting for one in flight.
+    *
+    * A burst still going after IMU_STOP_TIMEOUT_US, on a stuck bus, is
+    * aborted and counted in getErrors().
+    */
+
+    void stop(void);
+
+    //--------------------------------------------------------------------------
+    /** Copies the latest background sample without waiting.
+    *
+    *   @param d    Filled with the latest sample if it is new.
+    *   @param seen Sequence of the last sample read, start it at 0.
+    *   @return     true if a new sample was copied.
+    */
+
+    bool sample(imu_data_t *d, uint32_t *seen);
+
+    //--------------------------------------------------------------------------
+    /** Returns how many background bursts failed or found the bus busy.
+    */
+
+    uint32_t getErrors(void);
+
+    //--------------------------------------------------------------------------
+    /** Feeds the linear acceleration of every background sample to a filter.
+    *
+    * The filter runs in the transfer interrupt at the start() rate, so set
+    * its rate to match. Consumers read it at any lower rate.
+    *
+    *   @param f Filter to feed, NULL to stop.
+    */
+
+    void filter(IMUFILTER *f);
+
+    //--------------------------------------------------------------------------
+    /** Switches to the raw accel, mag and gyro mode (AMG).
+    *
+    * The BNO055 fusion is off, so the Euler, quaternion, linear
+    * acceleration and gravity registers stop. The accel and gyro
+    * bandwidths go up to suit 400 Hz reads, 125 Hz and 116 Hz, the mag
+    * runs at its fastest 30 Hz.
+    */
+
+    void setRawMode(void);
+
+    //--------------------------------------------------------------------------
+    /** Runs an orientation filter on every background sample.
+    *
+    * Call before start(). The bursts then only read the raw registers,
+    * the filter is updated in the transfer interrupt and its quaternion
+    * and heading go into the quat and euler.heading of each sample, the
+    * rest of the fused readings are 0. Set the filter rate to match
+    * start(), usually IMU_RAW_PERIOD, and use it with setRawMode().
+    *
+    *   @param f Filter to run, NULL for the BNO055 fusion again.
+    */
+
+    void fusion(MAHONY *f);
+
+private:
+
+    I2C _i2c;
+    Serial _ser;
+    bool _verbose;
+    char addr;
+
+    // Background reads
+    Ticker _ticker;
+    char _reg;
+    char _burst[IMU_BURST_LEN];
+    volatile bool _busy;
+    uint32_t _burstTime;
+    volatile uint32_t _errors;
+    SNAPSHOT<imu_data_t> _samples;
+    IMUFILTER *_filter;
+    MAHONY *_fusion;
+    int _burstLen;
+
+    // Unwrapped heading
+    HEADING _heading;
+
+    void decode(const char *data, imu_data_t *d, int len = IMU_BURST_LEN);
+    void startBurst(void);
+    void burstDone(int event);
+
 }; // end of class imu
 
 //------------------------------------------------------------------------------
@@ -314,6 +597,12 @@ public:
 #define BNO055_SIC_MATRIX_8_LSB_ADDR        0x53
 #define BNO055_SIC_MATRIX_8_MSB_ADDR        0x54
 
+// Sensor configuration registers, on page 1
+#define BNO055_ACC_CONFIG_ADDR              0x08
+#define BNO055_MAG_CONFIG_ADDR              0x09
+#define BNO055_GYRO_CONFIG_0_ADDR           0x0A
+#define BNO055_GYRO_CONFIG_1_ADDR           0x0B
+
 // Accelerometer Offset registers
 #define ACCEL_OFFSET_X_LSB_ADDR             0x55
 #define ACCEL_OFFSET_X_MSB_ADDR             0x56
@@ -364,6 +653,12 @@ public:
 #define OPERATION_MODE_NDOF_FMC_OFF         0x0B
 #define OPERATION_MODE_NDOF                 0x0C
 
+// Sensor configurations for the raw mode: accel 4 g 125 Hz, gyro 2000 deg/s
+// 116 Hz, mag 30 Hz regular
+#define ACC_CONFIG_RAW                      0x11
+#define GYRO_CONFIG_0_RAW                   0x10
+#define MAG_CONFIG_RAW                      0x0F
+
 // Values for remapping the orientation x,y, and z axis
 #define REMAP_CONFIG_P0                     0x21
 #define REMAP_CONFIG_P1                     0x24 // default
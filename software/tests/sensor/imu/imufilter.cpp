@@ -0,0 +1,215 @@
+/* @file imufilter.cpp
+*
+* This file contains the low pass and decimation filter for IMU samples.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <math.h>
+#include "imufilter.h"
+#include "snapshot.h"
+
+#define RING_MASK (IMUFILTER_RING - 1)
+#define PI_F 3.14159265f
+
+//------------------------------------------------------------------------------
+
+IMUFILTER::IMUFILTER(float rate, float cutoff, int order): _rate(rate)
+{
+
+    _seq = 0;
+    lowpass(cutoff, order);
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMUFILTER::lowpass(float cutoff, int order)
+{
+
+    float w0 = 2 * PI_F * cutoff / _rate;
+    float cw = cosf(w0), sw = sinf(w0);
+    float q, alpha, a0;
+
+    _type = BIQUAD;
+    _stages = order / 2;
+    if (_stages < 1) {
+        _stages = 1;
+    }
+    if (_stages > IMUFILTER_STAGES) {
+        _stages = IMUFILTER_STAGES;
+    }
+
+    // Bilinear transform sections, the Qs of a Butterworth of that order
+    for (int k = 0; k < _stages; k++) {
+        q = 1 / (2 * sinf((2 * k + 1) * PI_F / (4 * _stages)));
+        alpha = sw / (2 * q);
+        a0 = 1 + alpha;
+        _coef[k][0] = (1 - cw) / 2 / a0;
+        _coef[k][1] = (1 - cw) / a0;
+        _coef[k][2] = (1 - cw) / 2 / a0;
+        _coef[k][3] = -2 * cw / a0;
+        _coef[k][4] = (1 - alpha) / a0;
+    }
+
+    clear();
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMUFILTER::cic(int decimation, int order)
+{
+
+    _type = CIC;
+    _decimation = decimation < 1 ? 1 : decimation;
+    _order = order < 1 ? 1 : (order > IMUFILTER_CIC_ORDER ? IMUFILTER_CIC_ORDER : order);
+    _gain = 1.0f;
+    for (int k = 0; k < _order; k++) {
+        _gain /= _decimation;
+    }
+
+    clear();
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMUFILTER::clear(void)
+{
+
+    for (int a = 0; a < 3; a++) {
+        for (int k = 0; k < IMUFILTER_STAGES; k++) {
+            _state[a][k][0] = 0;
+            _state[a][k][1] = 0;
+        }
+        for (int k = 0; k < IMUFILTER_CIC_ORDER; k++) {
+            _integ[a][k] = 0;
+            _comb[a][k] = 0;
+        }
+    }
+    _phase = 0;
+    _warm = 0;
+    _primed = false;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMUFILTER::put(uint32_t time, float x, float y, float z)
+{
+
+    float in[3] = {x, y, z};
+    float out[3];
+    int32_t v, prev;
+    int a, k;
+
+    if (_type == BIQUAD) {
+        for (a = 0; a < 3; a++) {
+            float s = in[a];
+            for (k = 0; k < _stages; k++) {
+                const float *c = _coef[k];
+                float *d = _state[a][k];
+                float o;
+                // Start settled on the first input, unity gain at DC
+                if (!_primed) {
+                    d[0] = (1 - c[0]) * s;
+                    d[1] = (c[2] - c[4]) * s;
+                }
+                o = c[0] * s + d[0];
+                d[0] = c[1] * s - c[3] * o + d[1];
+                d[1] = c[2] * s - c[4] * o;
+                s = o;
+            }
+            out[a] = s;
+        }
+        _primed = true;
+        publish(time, out[0], out[1], out[2]);
+        return true;
+    }
+
+    // CIC integrators at the input rate, wrapping is harmless
+    for (a = 0; a < 3; a++) {
+        _integ[a][0] += (int32_t)lrintf(in[a]);
+        for (k = 1; k < _order; k++) {
+            _integ[a][k] += _integ[a][k - 1];
+        }
+    }
+    if (++_phase < _decimation) {
+        return false;
+    }
+    _phase = 0;
+
+    // Combs at the output rate
+    for (a = 0; a < 3; a++) {
+        v = _integ[a][_order - 1];
+        for (k = 0; k < _order; k++) {
+            prev = _comb[a][k];
+            _comb[a][k] = v;
+            v -= prev;
+        }
+        out[a] = v * _gain;
+    }
+
+    // Until the averages span order * (decimation - 1) + 1 inputs they
+    // still take in the zeros before the first one
+    if ((_warm + 1) * _decimation < _order * (_decimation - 1) + 1) {
+        _warm++;
+        return false;
+    }
+
+    publish(time, out[0], out[1], out[2]);
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMUFILTER::publish(uint32_t time, float x, float y, float z)
+{
+
+    imu_filtered_t *s = &_ring[_seq & RING_MASK];
+
+    s->time = time;
+    s->x = x;
+    s->y = y;
+    s->z = z;
+    SNAPSHOT_BARRIER();
+    _seq = _seq + 1;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMUFILTER::read(imu_filtered_t *out, int ago)
+{
+
+    uint32_t seq;
+
+    if (ago < 0 || ago >= IMUFILTER_RING - 1) {
+        return false;
+    }
+
+    // The slot is rewritten once the sequence moves on RING - 1 - ago
+    do {
+        seq = _seq;
+        if ((uint32_t)ago >= seq) {
+            return false;
+        }
+        SNAPSHOT_BARRIER();
+        *out = _ring[(seq - 1 - ago) & RING_MASK];
+        SNAPSHOT_BARRIER();
+    } while (_seq - seq >= (uint32_t)(IMUFILTER_RING - 1 - ago));
+
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+float IMUFILTER::outputRate(void)
+{
+
+    return _type == CIC ? _rate / _decimation : _rate;
+
+}
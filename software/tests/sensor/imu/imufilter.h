@@ -0,0 +1,161 @@
+/* @file imufilter.h
+*
+* This file contains the low pass and decimation filter for IMU samples. It
+* has no mbed dependencies so it can be checked on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef IMUFILTER_H
+#define IMUFILTER_H
+
+#include <stdint.h>
+
+// Filtered samples kept, a power of 2
+#define IMUFILTER_RING 32
+
+// Most biquad sections in cascade, 2 per filter order
+#define IMUFILTER_STAGES 4
+
+// Most CIC integrator and comb pairs
+#define IMUFILTER_CIC_ORDER 4
+
+//------------------------------------------------------------------------------
+/* Filtered sample */
+
+typedef struct
+{
+    uint32_t time;      // us_ticker time of the newest input
+    float x;
+    float y;
+    float z;
+} imu_filtered_t;
+
+//------------------------------------------------------------------------------
+/** @brief   Filters three axes of IMU samples into a ring buffer.
+*   @details Samples come in at a fixed rate from put(), usually from the IMU
+*            background reads, and go through one of two filters:
+*
+*            lowpass() cascades biquads into a Butterworth low pass, run in
+*            single precision transposed direct form II, five multiply-adds
+*            per section and axis on the M4 FPU. Every input gives an
+*            output, a consumer running slower just reads the newest one,
+*            so the cutoff should be under half the consumer rate.
+*
+*            cic() is a cascaded integrator comb decimator on the integer
+*            sensor counts: order moving averages of length decimation, in
+*            exact int32 arithmetic, giving one output every decimation
+*            inputs. It has no multiplies and its own nulls at the aliasing
+*            frequencies of the output rate.
+*
+*            Outputs go into a ring of IMUFILTER_RING samples with a
+*            sequence number, read() copies one out without locking. put()
+*            must not preempt itself, lowpass() and cic() must not run while
+*            put() can.
+*/
+
+class IMUFILTER
+{
+
+public:
+
+    typedef enum
+    {
+        BIQUAD,
+        CIC
+    } type_t;
+
+    //--------------------------------------------------------------------------
+    /** Constructor that sets up a Butterworth low pass.
+    *
+    *   @param rate   Input sample rate (Hz).
+    *   @param cutoff -3 dB frequency (Hz).
+    *   @param order  Filter order, even, up to 2 * IMUFILTER_STAGES.
+    */
+
+    IMUFILTER(float rate = 100.0f, float cutoff = 10.0f, int order = 2);
+
+    //--------------------------------------------------------------------------
+    /** Switches to a Butterworth low pass, clearing the filter state.
+    */
+
+    void lowpass(float cutoff, int order = 2);
+
+    //--------------------------------------------------------------------------
+    /** Switches to a CIC decimator, clearing the filter state.
+    *
+    *   @param decimation Inputs per output, and the moving average length.
+    *   @param order      Moving averages in cascade, up to
+    *                     IMUFILTER_CIC_ORDER. decimation^order must stay
+    *                     under 65536 so int16 counts cannot overflow.
+    */
+
+    void cic(int decimation, int order = 2);
+
+    //--------------------------------------------------------------------------
+    /** Filters one input sample.
+    *
+    *   @param time us_ticker time of the sample.
+    *   @return     true if an output went into the ring.
+    */
+
+    bool put(uint32_t time, float x, float y, float z);
+
+    //--------------------------------------------------------------------------
+    /** Copies an output from the ring.
+    *
+    *   @param out Filled with the output.
+    *   @param ago 0 for the newest, 1 for the one before and so on.
+    *   @return    false if there is no such output (yet).
+    */
+
+    bool read(imu_filtered_t *out, int ago = 0);
+
+    //--------------------------------------------------------------------------
+    /** Returns the number of outputs so far, to tell a new one.
+    */
+
+    uint32_t sequence(void) { return _seq; }
+
+    //--------------------------------------------------------------------------
+    /** Returns the output rate (Hz).
+    */
+
+    float outputRate(void);
+
+    //--------------------------------------------------------------------------
+    /** Returns the filter in use.
+    */
+
+    type_t type(void) { return _type; }
+
+private:
+
+    void clear(void);
+    void publish(uint32_t time, float x, float y, float z);
+
+    type_t _type;
+    float _rate;
+    bool _primed;
+
+    // Biquads: b0, b1, b2, a1, a2 per section, two delays per axis
+    int _stages;
+    float _coef[IMUFILTER_STAGES][5];
+    float _state[3][IMUFILTER_STAGES][2];
+
+    // CIC
+    int _decimation;
+    int _order;
+    int _phase;
+    int _warm;      // Outputs dropped after clear()
+    int32_t _integ[3][IMUFILTER_CIC_ORDER];
+    int32_t _comb[3][IMUFILTER_CIC_ORDER];
+    float _gain;
+
+    // Outputs
+    imu_filtered_t _ring[IMUFILTER_RING];
+    volatile uint32_t _seq;
+
+}; // end of class imufilter
+
+#endif
@@ -0,0 +1,237 @@
+/* @file imufilterdev.cpp
+*
+* Host check of the IMU filter against a double precision reference, with
+* the frequency response and the cost per sample.
+*
+* g++ -O2 -I../../mbed -o imufilterdev imufilterdev.cpp imufilter.cpp && ./imufilterdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "imufilter.h"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+void near(const char *what, double got, double want, double tol) {
+    if (fabs(got - want) > tol) {
+        printf("FAIL %s: got %f want %f\n", what, got, want);
+        failed++;
+    }
+}
+
+//------------------------------------------------------------------------------
+/* Reference: the same Butterworth designed and run in double, direct form I,
+*  and the CIC as plain moving averages. */
+
+typedef struct
+{
+    int stages;
+    double c[4][5];
+    double x[4][2], y[4][2];
+    bool primed;
+} ref_biquad_t;
+
+void refDesign(ref_biquad_t *r, double rate, double cutoff, int order) {
+    double w0 = 2 * M_PI * cutoff / rate, q, alpha, a0;
+
+    r->stages = order / 2;
+    r->primed = false;
+    for (int k = 0; k < r->stages; k++) {
+        q = 1 / (2 * sin((2 * k + 1) * M_PI / (4 * r->stages)));
+        alpha = sin(w0) / (2 * q);
+        a0 = 1 + alpha;
+        r->c[k][0] = (1 - cos(w0)) / 2 / a0;
+        r->c[k][1] = (1 - cos(w0)) / a0;
+        r->c[k][2] = (1 - cos(w0)) / 2 / a0;
+        r->c[k][3] = -2 * cos(w0) / a0;
+        r->c[k][4] = (1 - alpha) / a0;
+    }
+}
+
+double refStep(ref_biquad_t *r, double s) {
+    for (int k = 0; k < r->stages; k++) {
+        double *c = r->c[k], o;
+        if (!r->primed) {
+            r->x[k][0] = r->x[k][1] = s;
+            r->y[k][0] = r->y[k][1] = s;
+        }
+        o = c[0] * s + c[1] * r->x[k][0] + c[2] * r->x[k][1] -
+            c[3] * r->y[k][0] - c[4] * r->y[k][1];
+        r->x[k][1] = r->x[k][0];
+        r->x[k][0] = s;
+        r->y[k][1] = r->y[k][0];
+        r->y[k][0] = o;
+        s = o;
+    }
+    r->primed = true;
+    return s;
+}
+
+// Moving averages of length n, order times over, of in[0..end]
+double refCic(const int *in, int end, int n, int order) {
+    static double buf[8][4096];
+    int i, k, j;
+
+    for (i = 0; i <= end; i++) {
+        buf[0][i] = in[i];
+    }
+    for (k = 1; k <= order; k++) {
+        for (i = 0; i <= end; i++) {
+            double sum = 0;
+            for (j = 0; j < n; j++) {
+                sum += i - j >= 0 ? buf[k - 1][i - j] : 0;
+            }
+            buf[k][i] = sum / n;
+        }
+    }
+    return buf[order][end];
+}
+
+//------------------------------------------------------------------------------
+
+// Steady state gain of the filter for a sine at freq
+double gain(float rate, float cutoff, int order, double freq) {
+    IMUFILTER f(rate, cutoff, order);
+    imu_filtered_t o;
+    double peak = 0;
+
+    for (int i = 0; i < 4000; i++) {
+        f.put(i, 1000 * cos(2 * M_PI * freq * i / rate), 0, 0);
+        f.read(&o);
+        if (i > 3000 && fabs(o.x) > peak) {
+            peak = fabs(o.x);
+        }
+    }
+    return peak / 1000;
+}
+
+int main() {
+    static int noise[4096];
+    imu_filtered_t o;
+    ref_biquad_t ref;
+    double worst = 0;
+    int i;
+
+    srand(3);
+    for (i = 0; i < 4096; i++) {
+        noise[i] = rand() % 2001 - 1000;
+    }
+
+    // Float biquads track the double reference on noise
+    for (int order = 2; order <= 8; order += 2) {
+        IMUFILTER f(100.0f, 8.0f, order);
+        refDesign(&ref, 100.0, 8.0, order);
+        worst = 0;
+        for (i = 0; i < 2000; i++) {
+            f.put(i, noise[i], -noise[i], 0);
+            f.read(&o);
+            double r = refStep(&ref, noise[i]);
+            if (fabs(o.x - r) > worst) {
+                worst = fabs(o.x - r);
+            }
+            near("y axis mirrors x", o.y, -o.x, 1e-3);
+        }
+        printf("order %d biquad, worst difference from double %.2e counts\n", order, worst);
+        near("biquad against reference", worst, 0, 0.05);
+    }
+
+    // Response: unity at DC, -3 dB at the cutoff, steep above
+    near("DC", gain(100.0f, 5.0f, 4, 0.0), 1.0, 1e-4);
+    near("cutoff", gain(100.0f, 5.0f, 4, 5.0), sqrt(0.5), 0.01);
+    printf("4th order 5 Hz at 100 Hz: 20 Hz %.1f dB, 40 Hz %.1f dB\n",
+           20 * log10(gain(100.0f, 5.0f, 4, 20.0)),
+           20 * log10(gain(100.0f, 5.0f, 4, 40.0)));
+    if (gain(100.0f, 5.0f, 4, 20.0) > 0.01) {
+        printf("FAIL stop band\n");
+        failed++;
+    }
+
+    // Settled from the first sample
+    {
+        IMUFILTER f(100.0f, 5.0f, 4);
+        f.put(10, 981, -5, 3);
+        f.read(&o);
+        near("primed x", o.x, 981, 1e-3);
+        near("primed z", o.z, 3, 1e-3);
+        check("time", o.time, 10);
+    }
+
+    // CIC: exact moving averages, one output per decimation
+    {
+        IMUFILTER f(100.0f);
+        int outputs = 0;
+        f.cic(5, 3);
+        near("CIC rate", f.outputRate(), 20.0, 1e-6);
+        worst = 0;
+        for (i = 0; i < 1000; i++) {
+            if (f.put(i, noise[i], 0, 0)) {
+                f.read(&o);
+                check("CIC output time", o.time, i);
+                if (fabs(o.x - refCic(noise, i, 5, 3)) > worst) {
+                    worst = fabs(o.x - refCic(noise, i, 5, 3));
+                }
+                outputs++;
+            }
+        }
+        check("CIC outputs after warm up", outputs, 1000 / 5 - 2);
+        near("CIC against reference", worst, 0, 1e-3);
+        check("CIC sequence", f.sequence(), outputs);
+    }
+
+    // CIC starts out settled
+    {
+        IMUFILTER f(100.0f);
+        f.cic(4, 2);
+        for (i = 0; !f.put(i, -250, 7, 1000); i++)
+            ;
+        f.read(&o);
+        near("CIC first x", o.x, -250, 0);
+        near("CIC first z", o.z, 1000, 0);
+    }
+
+    // Ring: the last IMUFILTER_RING - 1 outputs, in order
+    {
+        IMUFILTER f(100.0f, 10.0f, 2);
+        check("empty", f.read(&o), 0);
+        for (i = 0; i < 100; i++) {
+            f.put(i, 0, 0, 0);
+        }
+        f.read(&o, 0);
+        check("newest", o.time, 99);
+        f.read(&o, IMUFILTER_RING - 2);
+        check("oldest", o.time, 99 - (IMUFILTER_RING - 2));
+        check("too old", f.read(&o, IMUFILTER_RING - 1), 0);
+    }
+
+    // Cost per three axis sample on the host
+    {
+        IMUFILTER f(100.0f, 5.0f, 4);
+        clock_t t0 = clock();
+        float sink = 0;
+        for (i = 0; i < 2000000; i++) {
+            f.put(i, noise[i & 4095], noise[(i + 1) & 4095], noise[(i + 2) & 4095]);
+        }
+        f.read(&o);
+        sink += o.x;
+        printf("4th order put: %.1f ns per sample (host, %g)\n",
+               (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / 2000000, sink);
+    }
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,228 @@
+/* @file imupair.cpp
+*
+* This file contains the reading, averaging and fault voting of two BNO055s
+* on the same I2C bus.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <math.h>
+#include "imupair.h"
+
+//------------------------------------------------------------------------------
+/* Three axis helpers, for any of the IMU x, y, z structs */
+
+template <class T>
+static float maxDiff(const T &a, const T &b)
+{
+
+    float dx = fabsf(a.x - b.x), dy = fabsf(a.y - b.y), dz = fabsf(a.z - b.z);
+
+    return dx > dy ? (dx > dz ? dx : dz) : (dy > dz ? dy : dz);
+
+}
+
+template <class T>
+static void mean(const T &a, const T &b, T &d)
+{
+
+    d.x = (a.x + b.x) / 2;
+    d.y = (a.y + b.y) / 2;
+    d.z = (a.z + b.z) / 2;
+
+}
+
+// Halfway round the shorter way
+static float meanAngle(float a, float b)
+{
+
+    return a + angleDiff(b, a) / 2;
+
+}
+
+//------------------------------------------------------------------------------
+
+IMUPAIR::IMUPAIR(IMU &a, IMU &b)
+{
+
+    _imu[0] = &a;
+    _imu[1] = &b;
+    _data[0] = IMU::imu_data_t();
+    _data[1] = IMU::imu_data_t();
+    reset();
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMUPAIR::reset(void)
+{
+
+    for (int i = 0; i < 2; i++) {
+        _dropped[i] = false;
+        _stuck[i] = 0;
+        _strikes[i] = 0;
+        _faults[i] = 0;
+    }
+    _started = false;
+    _disagree = false;
+
+}
+
+//------------------------------------------------------------------------------
+
+int IMUPAIR::read(IMU::imu_data_t *d)
+{
+
+    IMU::imu_data_t now[2];
+    bool ok[2];
+    int i, win, lose;
+
+    // Back to back, one burst each
+    for (i = 0; i < 2; i++) {
+        ok[i] = false;
+        if (_dropped[i]) {
+            continue;
+        }
+        if (_imu[i]->readAll(&now[i])) {
+            ok[i] = usable(i, &now[i]);
+        } else {
+            _faults[i]++;
+        }
+    }
+
+    _disagree = false;
+    if (ok[0] && ok[1] && agree(&now[0], &now[1])) {
+        average(&now[0], &now[1], d);
+        _strikes[0] = 0;
+        _strikes[1] = 0;
+        _last = *d;
+        _started = true;
+        return 3;
+    }
+
+    if (ok[0] && ok[1]) {
+        // No third to tell which is wrong, keep the one that moved less
+        // from the last output, or the first unit until there is one
+        _disagree = true;
+        win = !_started || distance(&now[0]) <= distance(&now[1]) ? 0 : 1;
+        lose = 1 - win;
+        _faults[lose]++;
+        if (++_strikes[lose] >= IMUPAIR_STRIKES) {
+            _dropped[lose] = true;
+        }
+    } else if (ok[0] || ok[1]) {
+        win = ok[0] ? 0 : 1;
+    } else {
+        return 0;
+    }
+
+    _strikes[win] = 0;
+    *d = now[win];
+    _last = *d;
+    _started = true;
+    return 1 << win;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMUPAIR::dropped(int unit)
+{
+
+    return unit >= 0 && unit < 2 && _dropped[unit];
+
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t IMUPAIR::getFaults(int unit)
+{
+
+    return unit >= 0 && unit < 2 ? _faults[unit] : 0;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMUPAIR::usable(int unit, const IMU::imu_data_t *d)
+{
+
+    const IMU::imu_data_t *p = &_data[unit];
+    float n;
+
+    // Sensor noise moves the raw readings every time on a live unit
+    if (maxDiff(d->accel, p->accel) == 0 && maxDiff(d->gyro, p->gyro) == 0) {
+        _stuck[unit]++;
+    } else {
+        _stuck[unit] = 0;
+    }
+    _data[unit] = *d;
+
+    n = d->quat.w * d->quat.w + d->quat.x * d->quat.x +
+        d->quat.y * d->quat.y + d->quat.z * d->quat.z;
+    if (_stuck[unit] >= IMUPAIR_STUCK || fabsf(n - 1) > 0.1f) {
+        _faults[unit]++;
+        return false;
+    }
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool IMUPAIR::agree(const IMU::imu_data_t *a, const IMU::imu_data_t *b)
+{
+
+    return fabsf(angleDiff(a->euler.heading, b->euler.heading)) <= IMUPAIR_HEADING_TOL &&
+           maxDiff(a->gyro, b->gyro) <= IMUPAIR_GYRO_TOL &&
+           maxDiff(a->linAccel, b->linAccel) <= IMUPAIR_ACCEL_TOL;
+
+}
+
+//------------------------------------------------------------------------------
+
+float IMUPAIR::distance(const IMU::imu_data_t *d)
+{
+
+    // In tolerances, so heading and rate weigh the same
+    return fabsf(angleDiff(d->euler.heading, _last.euler.heading)) / IMUPAIR_HEADING_TOL +
+           maxDiff(d->gyro, _last.gyro) / IMUPAIR_GYRO_TOL;
+
+}
+
+//------------------------------------------------------------------------------
+
+void IMUPAIR::average(const IMU::imu_data_t *a, const IMU::imu_data_t *b, IMU::imu_data_t *d)
+{
+
+    float s = 1, n;
+
+    d->time = a->time;
+    mean(a->accel, b->accel, d->accel);
+    mean(a->mag, b->mag, d->mag);
+    mean(a->gyro, b->gyro, d->gyro);
+    mean(a->linAccel, b->linAccel, d->linAccel);
+    mean(a->gravity, b->gravity, d->gravity);
+
+    d->euler.heading = angleWrap360(meanAngle(a->euler.heading, b->euler.heading));
+    d->euler.pitch = angleWrap180(meanAngle(a->euler.pitch, b->euler.pitch));
+    d->euler.roll = angleWrap180(meanAngle(a->euler.roll, b->euler.roll));
+
+    // q and -q are the same turn, add them the same way round
+    if (a->quat.w * b->quat.w + a->quat.x * b->quat.x +
+        a->quat.y * b->quat.y + a->quat.z * b->quat.z < 0) {
+        s = -1;
+    }
+    d->quat.w = a->quat.w + s * b->quat.w;
+    d->quat.x = a->quat.x + s * b->quat.x;
+    d->quat.y = a->quat.y + s * b->quat.y;
+    d->quat.z = a->quat.z + s * b->quat.z;
+    n = 1.0f / sqrtf(d->quat.w * d->quat.w + d->quat.x * d->quat.x +
+                     d->quat.y * d->quat.y + d->quat.z * d->quat.z);
+    d->quat.w *= n;
+    d->quat.x *= n;
+    d->quat.y *= n;
+    d->quat.z *= n;
+
+}
@@ -0,0 +1,113 @@
+/* @file imupair.h
+*
+* This file contains the reading, averaging and fault voting of two BNO055s
+* on the same I2C bus.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef IMUPAIR_H
+#define IMUPAIR_H
+
+#include "imu.h"            // Includes header for the imu class
+
+// Most the two units may differ by and still be averaged
+#define IMUPAIR_HEADING_TOL 5.0f    // deg
+#define IMUPAIR_GYRO_TOL    80.0f   // 1/16 deg/s, 5 deg/s
+#define IMUPAIR_ACCEL_TOL   100.0f  // 1/100 m/s^2, 1 m/s^2
+
+// Identical raw readings in a row taken as a frozen unit
+#define IMUPAIR_STUCK 10
+
+// Votes lost in a row before a unit is dropped until reset()
+#define IMUPAIR_STRIKES 5
+
+//------------------------------------------------------------------------------
+/** @brief   Reads two BNO055s, one at each address, as one IMU.
+*   @details Both units are read with IMU::readAll() back to back in the
+*            caller's slot, one burst each, so the pair costs two
+*            transactions where the separate getters of one unit took
+*            three. The units must be mounted, or remapped with
+*            setMountingPosition(), to the same axes.
+*
+*            A unit is usable while it answers, its raw readings are not
+*            frozen and its quaternion is a unit one. Two usable units
+*            that agree are averaged, which takes the noise down by about
+*            a square root of two. When they disagree there is no third
+*            to break the tie, so the one closer to the last output is
+*            kept. A unit that loses IMUPAIR_STRIKES votes in a row is
+*            dropped and no longer read until reset().
+*/
+
+class IMUPAIR
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor that takes the two units.
+    *
+    *   @param a IMU at BNO055_G_CHIP_ADDR.
+    *   @param b IMU at BNO055_V_CHIP_ADDR.
+    */
+
+    IMUPAIR(IMU &a, IMU &b);
+
+    //--------------------------------------------------------------------------
+    /** Reads both units and combines them.
+    *
+    *   @param d Filled with the average of the units used.
+    *   @return  Units used, bit 0 for a and bit 1 for b, 0 if neither was
+    *            usable and d is left as it was.
+    */
+
+    int read(IMU::imu_data_t *d);
+
+    //--------------------------------------------------------------------------
+    /** Returns true if the last two usable readings disagreed.
+    */
+
+    bool disagree(void) { return _disagree; }
+
+    //--------------------------------------------------------------------------
+    /** Returns true if a unit has been dropped.
+    *
+    *   @param unit 0 for a, 1 for b.
+    */
+
+    bool dropped(int unit);
+
+    //--------------------------------------------------------------------------
+    /** Returns how many reads a unit failed, was stuck or lost the vote.
+    *
+    *   @param unit 0 for a, 1 for b.
+    */
+
+    uint32_t getFaults(int unit);
+
+    //--------------------------------------------------------------------------
+    /** Takes both units back and clears the fault counts.
+    */
+
+    void reset(void);
+
+private:
+
+    bool usable(int unit, const IMU::imu_data_t *d);
+    bool agree(const IMU::imu_data_t *a, const IMU::imu_data_t *b);
+    float distance(const IMU::imu_data_t *d);
+    void average(const IMU::imu_data_t *a, const IMU::imu_data_t *b, IMU::imu_data_t *d);
+
+    IMU *_imu[2];
+    IMU::imu_data_t _data[2];
+    IMU::imu_data_t _last;
+    bool _started;          // _last holds an output
+    bool _disagree;
+    bool _dropped[2];
+    int _stuck[2];
+    int _strikes[2];
+    uint32_t _faults[2];
+
+}; // end of class imupair
+
+#endif
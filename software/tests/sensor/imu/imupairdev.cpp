@@ -0,0 +1,234 @@
+/* @file imupairdev.cpp
+*
+* Host check of the IMU pair voting. imu.h needs mbed, so its guard is set
+* here and a stub IMU with the same data types plays each unit: it answers
+* or fails, moves its raw readings by a count every read like sensor noise
+* or freezes them, and reports the heading it is given.
+*
+* g++ -O2 -o imupairdev imupairdev.cpp heading.cpp && ./imupairdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "heading.h"
+
+// Stands in for imu.h
+#define IMU_H_
+
+class IMU
+{
+
+public:
+
+    typedef struct
+    {
+        float heading;
+        float roll;
+        float pitch;
+    } imu_euler_t;
+
+    typedef struct
+    {
+        float x;
+        float y;
+        float z;
+    } imu_vector_t;
+
+    typedef imu_vector_t imu_lin_accel_t;
+    typedef imu_vector_t imu_gravity_t;
+
+    typedef struct
+    {
+        float w;
+        float x;
+        float y;
+        float z;
+    } imu_quat_t;
+
+    typedef struct
+    {
+        uint32_t time;
+        imu_vector_t accel;
+        imu_vector_t mag;
+        imu_vector_t gyro;
+        imu_euler_t euler;
+        imu_quat_t quat;
+        imu_lin_accel_t linAccel;
+        imu_gravity_t gravity;
+    } imu_data_t;
+
+    IMU() : answers(true), frozen(false), reads(0), _noise(0) { look(0); }
+
+    // Level, at this heading
+    void look(float heading) {
+        float h = -heading * (float)M_PI / 360;
+        data.time = 0;
+        data.accel.x = 0;
+        data.accel.y = 0;
+        data.accel.z = 981;
+        data.mag.x = 400;
+        data.mag.y = 0;
+        data.mag.z = -640;
+        data.gyro.x = 0;
+        data.gyro.y = 0;
+        data.gyro.z = 0;
+        data.euler.heading = heading;
+        data.euler.roll = 0;
+        data.euler.pitch = 0;
+        data.quat.w = cosf(h);
+        data.quat.x = 0;
+        data.quat.y = 0;
+        data.quat.z = sinf(h);
+        data.linAccel.x = 0;
+        data.linAccel.y = 0;
+        data.linAccel.z = 0;
+        data.gravity = data.accel;
+    }
+
+    bool readAll(imu_data_t *d) {
+        reads++;
+        if (!answers) {
+            return false;
+        }
+        if (!frozen) {
+            _noise = !_noise;
+        }
+        *d = data;
+        d->accel.x += _noise;
+        return true;
+    }
+
+    bool answers;
+    bool frozen;
+    int reads;
+    imu_data_t data;
+
+private:
+
+    int _noise;
+
+};
+
+#include "imupair.cpp"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+void near(const char *what, double got, double want, double tol) {
+    if (fabs(got - want) > tol) {
+        printf("FAIL %s: got %f want %f\n", what, got, want);
+        failed++;
+    }
+}
+
+int main() {
+    IMU::imu_data_t d;
+
+    // Agree: averaged, the short way round north
+    {
+        IMU a, b;
+        IMUPAIR pair(a, b);
+        a.look(100);
+        b.look(102);
+        check("agree units", pair.read(&d), 3);
+        near("agree heading", d.euler.heading, 101, 1e-4);
+        check("agree vote", pair.disagree(), 0);
+        a.look(359);
+        b.look(1);
+        check("agree north units", pair.read(&d), 3);
+        near("agree north heading", angleDiff(d.euler.heading, 0), 0, 1e-4);
+        near("agree north quat", fabs(d.quat.w), 1, 1e-6);
+        check("agree faults", pair.getFaults(0) + pair.getFaults(1), 0);
+    }
+
+    // Disagree: the one nearer the last output is kept until the other is
+    // dropped, then only the one left is read
+    {
+        IMU a, b;
+        IMUPAIR pair(a, b);
+        a.look(100);
+        b.look(100);
+        pair.read(&d);
+        b.look(130);
+        for (int i = 1; i <= IMUPAIR_STRIKES; i++) {
+            check("disagree units", pair.read(&d), 1);
+            check("disagree vote", pair.disagree(), 1);
+            check("disagree dropped", pair.dropped(1), i == IMUPAIR_STRIKES);
+        }
+        near("disagree heading", d.euler.heading, 100, 0);
+        check("disagree faults", pair.getFaults(1), IMUPAIR_STRIKES);
+        b.reads = 0;
+        check("dropped units", pair.read(&d), 1);
+        check("dropped not read", b.reads, 0);
+        pair.reset();
+        b.look(101);
+        check("reset units", pair.read(&d), 3);
+    }
+
+    // No output yet to compare with, the first unit wins the tie
+    {
+        IMU a, b;
+        IMUPAIR pair(a, b);
+        a.look(10);
+        b.look(200);
+        check("first tie units", pair.read(&d), 1);
+    }
+
+    // One stuck: frozen raw readings count from the second read, the unit
+    // goes once IMUPAIR_STUCK reads in a row match
+    {
+        IMU a, b;
+        IMUPAIR pair(a, b);
+        b.frozen = true;
+        for (int i = 1; i <= IMUPAIR_STUCK; i++) {
+            check("stuck still used", pair.read(&d), 3);
+        }
+        check("stuck units", pair.read(&d), 1);
+        check("stuck faults", pair.getFaults(1), 1);
+        check("stuck not dropped", pair.dropped(1), 0);
+        b.frozen = false;
+        check("unstuck units", pair.read(&d), 3);
+    }
+
+    // One failed: the other alone, then neither and d untouched
+    {
+        IMU a, b;
+        IMUPAIR pair(a, b);
+        a.look(45);
+        b.look(45);
+        a.answers = false;
+        check("failed units", pair.read(&d), 2);
+        check("failed faults", pair.getFaults(0), 1);
+        near("failed heading", d.euler.heading, 45, 0);
+        b.answers = false;
+        d.euler.heading = -1;
+        check("both failed units", pair.read(&d), 0);
+        near("both failed untouched", d.euler.heading, -1, 0);
+    }
+
+    // A quaternion off the unit sphere is a bad read
+    {
+        IMU a, b;
+        IMUPAIR pair(a, b);
+        b.data.quat.w = 0;
+        b.data.quat.z = 0;
+        check("bad quat units", pair.read(&d), 1);
+        check("bad quat faults", pair.getFaults(1), 1);
+    }
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,224 @@
+/* @file mahony.cpp
+*
+* This file contains the orientation filter run on the raw IMU readings.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <math.h>
+#include "mahony.h"
+#include "heading.h"
+
+//------------------------------------------------------------------------------
+
+MAHONY::MAHONY(float rate, float kp, float ki): _dt(1.0f / rate), _kp(kp), _ki(ki)
+{
+
+    reset();
+
+}
+
+//------------------------------------------------------------------------------
+
+void MAHONY::reset(void)
+{
+
+    _q[0] = 1;
+    _q[1] = 0;
+    _q[2] = 0;
+    _q[3] = 0;
+    _bias[0] = 0;
+    _bias[1] = 0;
+    _bias[2] = 0;
+    _startTime = MAHONY_START_TIME;
+    _started = false;
+
+}
+
+//------------------------------------------------------------------------------
+
+void MAHONY::start(float ax, float ay, float az, float mx, float my, float mz)
+{
+
+    float r[3][3];
+    float n, t, s;
+    int i;
+
+    // Earth axes in sensor axes: up along gravity, west across up and the
+    // field, north across west and up. Without a field sensor x is north.
+    if (mx == 0 && my == 0 && mz == 0) {
+        mx = 1;
+    }
+    r[2][0] = ax;
+    r[2][1] = ay;
+    r[2][2] = az;
+    r[1][0] = ay * mz - az * my;
+    r[1][1] = az * mx - ax * mz;
+    r[1][2] = ax * my - ay * mx;
+    r[0][0] = r[1][1] * az - r[1][2] * ay;
+    r[0][1] = r[1][2] * ax - r[1][0] * az;
+    r[0][2] = r[1][0] * ay - r[1][1] * ax;
+    for (i = 0; i < 3; i++) {
+        n = sqrtf(r[i][0] * r[i][0] + r[i][1] * r[i][1] + r[i][2] * r[i][2]);
+        if (n == 0) {
+            return;
+        }
+        r[i][0] /= n;
+        r[i][1] /= n;
+        r[i][2] /= n;
+    }
+
+    // Rotation matrix to quaternion, from the largest component
+    t = r[0][0] + r[1][1] + r[2][2];
+    if (t > 0) {
+        s = 2 * sqrtf(t + 1);
+        _q[0] = s / 4;
+        _q[1] = (r[2][1] - r[1][2]) / s;
+        _q[2] = (r[0][2] - r[2][0]) / s;
+        _q[3] = (r[1][0] - r[0][1]) / s;
+    } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        s = 2 * sqrtf(1 + r[0][0] - r[1][1] - r[2][2]);
+        _q[0] = (r[2][1] - r[1][2]) / s;
+        _q[1] = s / 4;
+        _q[2] = (r[0][1] + r[1][0]) / s;
+        _q[3] = (r[0][2] + r[2][0]) / s;
+    } else if (r[1][1] > r[2][2]) {
+        s = 2 * sqrtf(1 + r[1][1] - r[0][0] - r[2][2]);
+        _q[0] = (r[0][2] - r[2][0]) / s;
+        _q[1] = (r[0][1] + r[1][0]) / s;
+        _q[2] = s / 4;
+        _q[3] = (r[1][2] + r[2][1]) / s;
+    } else {
+        s = 2 * sqrtf(1 + r[2][2] - r[0][0] - r[1][1]);
+        _q[0] = (r[1][0] - r[0][1]) / s;
+        _q[1] = (r[0][2] + r[2][0]) / s;
+        _q[2] = (r[1][2] + r[2][1]) / s;
+        _q[3] = s / 4;
+    }
+    _started = true;
+
+}
+
+//------------------------------------------------------------------------------
+
+void MAHONY::update(float gx, float gy, float gz, float ax, float ay, float az,
+                    float mx, float my, float mz)
+{
+
+    float q0, q1, q2, q3;
+    float ex = 0, ey = 0, ez = 0;
+    float n, kp;
+
+    // First orientation straight from the readings, not converged on
+    if (!_started && (ax != 0 || ay != 0 || az != 0)) {
+        start(ax, ay, az, mx, my, mz);
+    }
+    q0 = _q[0];
+    q1 = _q[1];
+    q2 = _q[2];
+    q3 = _q[3];
+
+    if (ax != 0 || ay != 0 || az != 0) {
+        float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+        float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+        float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+        n = 1.0f / sqrtf(ax * ax + ay * ay + az * az);
+        ax *= n;
+        ay *= n;
+        az *= n;
+
+        // Gravity direction estimated in sensor axes, half of it
+        float vx = q1q3 - q0q2;
+        float vy = q0q1 + q2q3;
+        float vz = 0.5f - q1q1 - q2q2;
+
+        ex = ay * vz - az * vy;
+        ey = az * vx - ax * vz;
+        ez = ax * vy - ay * vx;
+
+        if (mx != 0 || my != 0 || mz != 0) {
+            n = 1.0f / sqrtf(mx * mx + my * my + mz * mz);
+            mx *= n;
+            my *= n;
+            mz *= n;
+
+            // Field turned into the earth frame, then the reference field
+            // north and down in the same plane, back in sensor axes
+            float hx = mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2);
+            float hy = mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1);
+            float bz = mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2);
+            float bx = sqrtf(hx * hx + hy * hy);
+            float wx = 2 * (bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2));
+            float wy = 2 * (bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3));
+            float wz = 2 * (bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2));
+
+            ex += my * wz - mz * wy;
+            ey += mz * wx - mx * wz;
+            ez += mx * wy - my * wx;
+        }
+
+        // The half vectors above halve the error, double the gains back
+        kp = 2 * _kp;
+        if (_startTime > 0) {
+            kp *= MAHONY_START_GAIN;
+            _startTime -= _dt;
+        } else if (_ki > 0) {
+            _bias[0] += 2 * _ki * ex * _dt;
+            _bias[1] += 2 * _ki * ey * _dt;
+            _bias[2] += 2 * _ki * ez * _dt;
+        }
+        ex *= kp;
+        ey *= kp;
+        ez *= kp;
+    }
+
+    gx = (gx + _bias[0] + ex) * 0.5f * _dt;
+    gy = (gy + _bias[1] + ey) * 0.5f * _dt;
+    gz = (gz + _bias[2] + ez) * 0.5f * _dt;
+
+    q0 += -q1 * gx - q2 * gy - q3 * gz;
+    q1 += _q[0] * gx + q2 * gz - q3 * gy;
+    q2 += _q[0] * gy - _q[1] * gz + q3 * gx;
+    q3 += _q[0] * gz + _q[1] * gy - _q[2] * gx;
+
+    n = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    _q[0] = q0 * n;
+    _q[1] = q1 * n;
+    _q[2] = q2 * n;
+    _q[3] = q3 * n;
+
+}
+
+//------------------------------------------------------------------------------
+
+void MAHONY::getQuaternion(float q[4])
+{
+
+    q[0] = _q[0];
+    q[1] = _q[1];
+    q[2] = _q[2];
+    q[3] = _q[3];
+
+}
+
+//------------------------------------------------------------------------------
+
+float MAHONY::heading(void)
+{
+
+    return quatHeading(_q[0], _q[1], _q[2], _q[3]);
+
+}
+
+//------------------------------------------------------------------------------
+
+void MAHONY::getBias(float b[3])
+{
+
+    // The integral cancels the bias
+    b[0] = -_bias[0];
+    b[1] = -_bias[1];
+    b[2] = -_bias[2];
+
+}
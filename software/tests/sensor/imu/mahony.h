@@ -0,0 +1,103 @@
+/* @file mahony.h
+*
+* This file contains the orientation filter run on the raw IMU readings. It
+* has no mbed dependencies so it can be checked on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef MAHONY_H
+#define MAHONY_H
+
+// Proportional and integral feedback gains, per second
+#define MAHONY_KP 2.0f
+#define MAHONY_KI 0.3f
+
+// Seconds of raised gain after a reset, to settle the noise of the first
+// readings the orientation starts from
+#define MAHONY_START_TIME 1.0f
+#define MAHONY_START_GAIN 10.0f
+
+//------------------------------------------------------------------------------
+/** @brief   Mahony complementary filter for orientation from gyro, accel and
+*            mag readings.
+*   @details The gyro is integrated into a quaternion, and the cross product
+*            between measured and estimated gravity and magnetic field
+*            directions is fed back as a rate correction, proportional
+*            against drift and integral against gyro bias. About 150
+*            single precision operations and four square roots per update,
+*            a few microseconds on the M4 FPU, so 400 Hz or more is fine in
+*            an interrupt.
+*
+*            The earth frame is x north, z up, the quaternion turns sensor
+*            axes into it, as the BNO055 one. Accel and mag may be in any
+*            units, they are normalised, the gyro is in rad/s. Updates must
+*            not preempt each other.
+*/
+
+class MAHONY
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor, the first update with an acceleration sets the start.
+    *
+    *   @param rate Update rate (Hz).
+    *   @param kp   Proportional gain (1/s).
+    *   @param ki   Integral gain (1/s^2), 0 to not estimate gyro bias.
+    */
+
+    MAHONY(float rate = 400.0f, float kp = MAHONY_KP, float ki = MAHONY_KI);
+
+    //--------------------------------------------------------------------------
+    /** Adds one set of readings.
+    *
+    *   @param gx,gy,gz Angular rate (rad/s).
+    *   @param ax,ay,az Acceleration, gravity up, 0 0 0 to skip the correction.
+    *   @param mx,my,mz Magnetic field, 0 0 0 to go on gyro and accel only.
+    */
+
+    void update(float gx, float gy, float gz, float ax, float ay, float az,
+                float mx = 0, float my = 0, float mz = 0);
+
+    //--------------------------------------------------------------------------
+    /** Returns the orientation quaternion.
+    *
+    *   @param q Filled with w, x, y, z.
+    */
+
+    void getQuaternion(float q[4]);
+
+    //--------------------------------------------------------------------------
+    /** Returns the compass heading, clockwise from north (deg).
+    */
+
+    float heading(void);
+
+    //--------------------------------------------------------------------------
+    /** Returns the gyro bias estimate (rad/s).
+    */
+
+    void getBias(float b[3]);
+
+    //--------------------------------------------------------------------------
+    /** Starts over from the next readings, with the raised gain.
+    */
+
+    void reset(void);
+
+private:
+
+    void start(float ax, float ay, float az, float mx, float my, float mz);
+
+    float _dt;
+    float _kp;
+    float _ki;
+    float _q[4];
+    float _bias[3];     // Integral feedback, the negative gyro bias
+    float _startTime;   // Seconds of raised gain left
+    bool _started;     // Orientation taken from the readings
+}; // end of class mahony
+
+#endif
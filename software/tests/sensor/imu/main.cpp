@@ -1,9 +1,12 @@
 #include "imu.h"
+#include "imupair.h"
 #include "mbed.h"
  
 int main()
 {
     IMU imu(I2C_SDA, I2C_SCL, BNO055_G_CHIP_ADDR, true);
+    IMU imu2(I2C_SDA, I2C_SCL, BNO055_V_CHIP_ADDR, true);
+    IMUPAIR pair(imu, imu2);
     Serial ser(USBTX, USBRX);
 
     while(1)
@@ -12,16 +15,43 @@ int main()
         IMU::imu_euler_t euler;
         IMU::imu_lin_accel_t linAccel;
         IMU::imu_gravity_t grav;
+        IMU::imu_data_t all;
+        IMU::imu_data_t both;
+        IMU::imu_calib_status_t calib;
+        Timer busTimer;
+        int separateUs, burstUs, pairUs, used;
         
         // Gets system status and prints variable values
         imu.getSysStatus();
+        imu.getCalibStatus(&calib);
+        ser.printf("Calibration: sys %d gyro %d accel %d mag %d\r\n", calib.sys, calib.gyro, calib.accel, calib.mag);
         ser.printf("\r\n");
+
+        // Times the three separate reads against the one burst
+        busTimer.start();
         imu.getEulerAng(&euler);
-        ser.printf("Heading: %f Pitch: %f Roll: %f\r\n", euler.heading, euler.pitch, euler.roll);
         imu.getLinAccel(&linAccel);
-        ser.printf("LinX: %f LinY: %f LinZ: %f\r\n", linAccel.x, linAccel.y, linAccel.z);
         imu.getGravity(&grav);
+        separateUs = busTimer.read_us();
+        busTimer.reset();
+        imu.readAll(&all);
+        burstUs = busTimer.read_us();
+        busTimer.reset();
+        used = pair.read(&both);
+        pairUs = busTimer.read_us();
+
+        ser.printf("Heading: %f Pitch: %f Roll: %f\r\n", euler.heading, euler.pitch, euler.roll);
+        ser.printf("LinX: %f LinY: %f LinZ: %f\r\n", linAccel.x, linAccel.y, linAccel.z);
         ser.printf("GravX: %f GravY: %f GravZ: %f\r\n", grav.x, grav.y, grav.z);
+        ser.printf("Quat: %f %f %f %f\r\n", all.quat.w, all.quat.x, all.quat.y, all.quat.z);
+        ser.printf("Gyro: %f %f %f\r\n", all.gyro.x, all.gyro.y, all.gyro.z);
+        ser.printf("Bus time: 3 reads %d us, burst %d us, pair %d us\r\n", separateUs, burstUs, pairUs);
+        if (used) {
+            ser.printf("Pair: units %d heading %f disagree %d faults %lu %lu\r\n", used, both.euler.heading,
+                       pair.disagree(), pair.getFaults(0), pair.getFaults(1));
+        } else {
+            ser.printf("Pair: no usable unit, faults %lu %lu\r\n", pair.getFaults(0), pair.getFaults(1));
+        }
         ser.printf("\r\n");
         wait_ms(1000);
     }
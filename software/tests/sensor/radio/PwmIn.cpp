@@ -22,32 +22,102 @@
 
 #include "PwmIn.h"
 
-PwmIn::PwmIn(PinName p) : _p(p) {
-    _p.rise(this, &PwmIn::rise);
-    _p.fall(this, &PwmIn::fall);
-    _period = 0.0;
-    _pulsewidth = 0.0;
+PwmIn::PwmIn(PinName p) {
+    _p = new InterruptIn(p);
+    _p->rise(this, &PwmIn::rise);
+    _p->fall(this, &PwmIn::fall);
+    _period = 0;
+    _pulsewidth = 0;
+    _edge = 0;
     _t.start();
 }
 
+PwmIn::PwmIn() : _p(NULL) {
+    _period = 0;
+    _pulsewidth = 0;
+    _edge = 0;
+}
+
+PwmIn::~PwmIn() {
+    delete _p;
+}
+
 float PwmIn::period() {
-    return _period;
+    return (float)period_us() / 1000000.0f;
 }
 
 float PwmIn::pulsewidth() {
-    return _pulsewidth;
+    return (float)pulsewidth_us() / 1000000.0f;
 }
 
 float PwmIn::dutycycle() {
-    return _pulsewidth / _period;
+    return (float)pulsewidth_us() / period_us();
+}
+
+int PwmIn::period_us() {
+    return _period;
+}
+
+int PwmIn::pulsewidth_us() {
+    return _pulsewidth;
+}
+
+void PwmIn::attach(Callback<void()> func) {
+    _fall = func;
+}
+
+int PwmIn::filtered_us() {
+    return _filter.value();
+}
+
+void PwmIn::filter(RCFILTER::mode_t mode) {
+    core_util_critical_section_enter();
+    _filter.setMode(mode);
+    core_util_critical_section_exit();
+}
+
+int PwmIn::quality() {
+    int q;
+    core_util_critical_section_enter();
+    q = _filter.quality(us_ticker_read());
+    core_util_critical_section_exit();
+    return q;
+}
+
+bool PwmIn::stale() {
+    bool s;
+    core_util_critical_section_enter();
+    s = _filter.stale(us_ticker_read());
+    core_util_critical_section_exit();
+    return s;
+}
+
+uint32_t PwmIn::edge_us() {
+    return _edge;
+}
+
+void PwmIn::getStats(rcfilter_stats_t *stats) {
+    core_util_critical_section_enter();
+    _filter.getStats(stats);
+    core_util_critical_section_exit();
 }
 
 void PwmIn::rise() {
-    _period = _t.read();
+    _period = _t.read_us();
     _t.reset();
 }
 
 void PwmIn::fall() {
-    _pulsewidth = _t.read();
+    uint32_t edge = us_ticker_read();
+    _pulsewidth = _t.read_us();
+    frame(_pulsewidth, _period, edge);
+}
+
+void PwmIn::frame(int pulsewidth, int period, uint32_t edge) {
+    _edge = edge;
+    _filter.frame(pulsewidth, period, us_ticker_read());
+    if (_fall) {
+        _fall();
+    }
 }
 
@@ -24,6 +24,7 @@
 #define MBED_PWMIN_H
 
 #include "mbed.h"
+#include "rcfilter.h"
 
 /** PwmIn class to read PWM inputs
  * 
@@ -31,6 +32,12 @@
  * and record the time they occur
  *
  * @note uses InterruptIn, so not available on p19/p20
+ *
+ * The _us reads and attach() are virtual so a backend such as
+ * PwmInCapture can take the measurement some other way.
+ *
+ * Every pulse also goes through an RCFILTER, which drops glitches and
+ * keeps a filtered value and a quality figure for failsafe decisions.
  */
 class PwmIn {
 public:
@@ -39,6 +46,8 @@ public:
      * @param p The pwm input pin (must support InterruptIn)
      */ 
     PwmIn(PinName p);
+
+    virtual ~PwmIn();
     
     /** Read the current period
      *
@@ -58,13 +67,86 @@ public:
      */
     float dutycycle();
 
-protected:        
+    /** Read the current period
+     *
+     * @returns the period in microseconds
+     */
+    virtual int period_us();
+
+    /** Read the current pulsewidth
+     *
+     * @returns the pulsewidth in microseconds
+     */
+    virtual int pulsewidth_us();
+
+    /** Attach a function to call at the end of every pulse
+     *
+     * The function runs in interrupt context after the new pulsewidth
+     * has been stored, so it can act on a pulse without polling.
+     *
+     * @param func The function to call, or an empty Callback to detach
+     */
+    virtual void attach(Callback<void()> func);
+
+    /** Read the filtered pulsewidth
+     *
+     * Worked out at the end of each pulse, so this is a single load.
+     *
+     * @returns the pulsewidth in microseconds, 0 before the first good pulse
+     */
+    int filtered_us();
+
+    /** Choose the filter behind filtered_us()
+     *
+     * @param mode RCFILTER::MEDIAN (default) or RCFILTER::TRIMMED_MEAN
+     */
+    void filter(RCFILTER::mode_t mode);
+
+    /** Read the signal quality
+     *
+     * @returns the percentage of recent frames received in range
+     */
+    int quality();
+
+    /** Check for a lost channel
+     *
+     * @returns true if no good pulse has arrived for a few frames
+     */
+    bool stale();
+
+    /** Read the frame, rejected and missing frame counts
+     */
+    void getStats(rcfilter_stats_t *stats);
+
+    /** Read when the last pulse ended
+     *
+     * Taken from the backend's own record of the edge where it has one,
+     * so it leads the attached function by the interrupt latency.
+     *
+     * @returns the us_ticker time of the falling edge, 0 before the first
+     */
+    uint32_t edge_us();
+
+protected:
+    /** Create a PwmIn with no InterruptIn, for backends
+     */
+    PwmIn();
+
     void rise();
     void fall();
+
+    /** Pass a finished pulse to the filter, then call the attached function
+     *
+     * @param edge us_ticker time of the falling edge
+     */
+    void frame(int pulsewidth, int period, uint32_t edge);
     
-    InterruptIn _p;
+    InterruptIn *_p;
     Timer _t;
-    float _pulsewidth, _period;
+    volatile int _pulsewidth, _period;
+    volatile uint32_t _edge;
+    Callback<void()> _fall;
+    RCFILTER _filter;
 };
 
 #endif
@@ -0,0 +1,149 @@
+/* @file PwmInCapture.cpp
+*
+* This file contains the timer input capture backend for PwmIn.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "PwmInCapture.h"
+#include "pinmap.h"
+
+//------------------------------------------------------------------------------
+/* Capture pins */
+
+typedef struct
+{
+    PinName pin;
+    TIM_TypeDef *tim;
+    int channel;
+    int af;
+    IRQn_Type irq;
+} capture_pin_t;
+
+static const capture_pin_t capturePins[] = {
+    {PB_3,  TIM2, 2, GPIO_AF1_TIM2, TIM2_IRQn},
+    {PC_8,  TIM8, 3, GPIO_AF3_TIM8, TIM8_CC_IRQn},
+    {PA_11, TIM1, 4, GPIO_AF1_TIM1, TIM1_CC_IRQn},
+};
+
+// Channels in use, searched by the interrupt handlers
+static PwmInCapture *owners[CAPTURE_MAX_CHANNELS];
+static TIMCAPTURE *channels[CAPTURE_MAX_CHANNELS];
+static int ownerCount = 0;
+
+//------------------------------------------------------------------------------
+
+// Kernel clock of a timer, twice its bus clock when the bus is divided
+static uint32_t timerClock(TIM_TypeDef *tim)
+{
+
+    if (tim == TIM1 || tim == TIM8) {
+        return HAL_RCC_GetPCLK2Freq() * ((RCC->CFGR & RCC_CFGR_PPRE2_2) ? 2 : 1);
+    }
+    return HAL_RCC_GetPCLK1Freq() * ((RCC->CFGR & RCC_CFGR_PPRE1_2) ? 2 : 1);
+
+}
+
+//------------------------------------------------------------------------------
+
+PwmInCapture::PwmInCapture(PinName p) : PwmIn()
+{
+
+    const capture_pin_t *cp = NULL;
+    uint32_t vector;
+
+    for (unsigned int i = 0; i < sizeof(capturePins) / sizeof(capturePins[0]); i++) {
+        if (capturePins[i].pin == p) {
+            cp = &capturePins[i];
+        }
+    }
+    if (cp == NULL || ownerCount >= CAPTURE_MAX_CHANNELS) {
+        error("PwmInCapture: no capture channel on pin %d\r\n", p);
+    }
+
+    if (cp->tim == TIM1) {
+        __HAL_RCC_TIM1_CLK_ENABLE();
+        vector = (uint32_t)&PwmInCapture::tim1Irq;
+    } else if (cp->tim == TIM2) {
+        __HAL_RCC_TIM2_CLK_ENABLE();
+        vector = (uint32_t)&PwmInCapture::tim2Irq;
+    } else {
+        __HAL_RCC_TIM8_CLK_ENABLE();
+        vector = (uint32_t)&PwmInCapture::tim8Irq;
+    }
+
+    pin_function(p, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, cp->af));
+
+    // One interrupt per pulse feeds the PwmIn filter
+    _cap = new TIMCAPTURE(cp->tim, cp->channel, timerClock(cp->tim));
+    _cap->interrupt(true);
+
+    core_util_critical_section_enter();
+    owners[ownerCount] = this;
+    channels[ownerCount] = _cap;
+    ownerCount++;
+    core_util_critical_section_exit();
+
+    NVIC_SetVector(cp->irq, vector);
+    NVIC_EnableIRQ(cp->irq);
+
+}
+
+//------------------------------------------------------------------------------
+
+int PwmInCapture::period_us()
+{
+
+    return _cap->period_us();
+
+}
+
+//------------------------------------------------------------------------------
+
+int PwmInCapture::pulsewidth_us()
+{
+
+    return _cap->pulsewidth_us();
+
+}
+
+//------------------------------------------------------------------------------
+
+void PwmInCapture::dispatch(TIM_TypeDef *tim)
+{
+
+    for (int i = 0; i < ownerCount; i++) {
+        if (channels[i]->timer() == tim && channels[i]->irq()) {
+            owners[i]->frame(channels[i]->pulsewidth_us(), channels[i]->period_us(),
+                             us_ticker_read() - channels[i]->sinceEdge_us());
+        }
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void PwmInCapture::tim1Irq(void)
+{
+
+    dispatch(TIM1);
+
+}
+
+//------------------------------------------------------------------------------
+
+void PwmInCapture::tim2Irq(void)
+{
+
+    dispatch(TIM2);
+
+}
+
+//------------------------------------------------------------------------------
+
+void PwmInCapture::tim8Irq(void)
+{
+
+    dispatch(TIM8);
+
+}
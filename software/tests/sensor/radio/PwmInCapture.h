@@ -0,0 +1,68 @@
+/* @file PwmInCapture.h
+*
+* This file contains the timer input capture backend for PwmIn.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef PWMINCAPTURE_H
+#define PWMINCAPTURE_H
+
+#include "mbed.h"
+#include "PwmIn.h"
+#include "timcapture.h"
+
+// Most capture channels in use at once
+#define CAPTURE_MAX_CHANNELS 8
+
+//------------------------------------------------------------------------------
+/** @brief   PwmIn that lets a timer capture channel time the pulse.
+*   @details Same API as PwmIn, but the edge times are latched by the timer
+*            instead of read from a Timer in an InterruptIn handler. On a
+*            channel 1 or 2 pin one interrupt at the end of each pulse copies
+*            the latched values into the PwmIn filter; on a channel 3 or 4
+*            pin there is one short interrupt per edge to flip the capture
+*            polarity. See TIMCAPTURE.
+*
+*            Radio pins on this board:
+*            THRO PB_3  TIM2_CH2, PWM input mode
+*            LRIN PC_8  TIM8_CH3, edge mode (TIM3 runs the brake PWM)
+*            ESTO PA_11 TIM1_CH4, edge mode
+*            MODE PB_0 (only TIM3_CH3) and BRAK PA_12 (no channel) cannot be
+*            captured and stay on the InterruptIn PwmIn.
+*/
+
+class PwmInCapture : public PwmIn
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor that claims the timer channel of a pin.
+    *
+    * Stops with error() if the pin is not in the capture table.
+    *
+    *   @param p Radio input pin.
+    */
+
+    PwmInCapture(PinName p);
+
+    //--------------------------------------------------------------------------
+    /** Latest period and pulse width in microseconds.
+    */
+
+    virtual int period_us();
+    virtual int pulsewidth_us();
+
+private:
+
+    static void dispatch(TIM_TypeDef *tim);
+    static void tim1Irq(void);
+    static void tim2Irq(void);
+    static void tim8Irq(void);
+
+    TIMCAPTURE *_cap;
+
+}; // end of class pwmincapture
+
+#endif
@@ -0,0 +1,121 @@
+/* @file capturedev.cpp
+*
+* Host test of the timer capture backend against mock TIM registers.
+*
+* g++ -I../../mbed -o capturedev capturedev.cpp timcapture.cpp && ./capturedev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include "timcapture.h"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got 0x%lx want 0x%lx\n", what, got, want);
+        failed++;
+    }
+}
+
+// Plays one capture on a channel and runs the handler
+bool edge(TIM_TypeDef *tim, TIMCAPTURE &cap, int channel, uint32_t count) {
+    uint32_t flag = 1 << channel;
+    bool end;
+
+    (&tim->CCR1)[channel - 1] = count & 0xFFFF;
+    tim->SR = flag;
+    end = cap.irq();
+    check("flag cleared", tim->SR & flag, 0);
+    tim->SR = 0;
+    return end;
+}
+
+int main() {
+    TIM_TypeDef tim2, tim8;
+
+    // THRO: TIM2_CH2 in PWM input mode at 90 MHz
+    memset(&tim2, 0, sizeof(tim2));
+    TIMCAPTURE thro(&tim2, 2, 90000000);
+    check("pwm input", thro.pwmInput(), 1);
+    check("tim2 PSC", tim2.PSC, 89);
+    check("tim2 ARR", tim2.ARR, 0xFFFF);
+    check("tim2 SMCR reset on TI2FP2", tim2.SMCR, 0x64);
+    check("tim2 CCMR1 IC2=TI2, IC1=TI2", tim2.CCMR1, 0x3132);
+    check("tim2 CCER CC2 rising, CC1 falling", tim2.CCER, 0x13);
+    check("tim2 no interrupt", tim2.DIER, 0);
+    check("tim2 running", tim2.CR1 & 1, 1);
+
+    // Read on demand straight from the capture registers
+    tim2.CCR2 = 20000;
+    tim2.CCR1 = 1500;
+    check("thro period", thro.period_us(), 20000);
+    check("thro width", thro.pulsewidth_us(), 1500);
+
+    // With a callback the falling capture interrupts and is cached
+    thro.interrupt(true);
+    check("tim2 CC1IE", tim2.DIER, 0x2);
+    tim2.SR = 0;
+    tim2.CCR1 = 1700;
+    tim2.CCR2 = 19990;
+    check("thro pulse end", edge(&tim2, thro, 1, 1700), 1);
+    tim2.CCR1 = 0;
+    check("thro cached width", thro.pulsewidth_us(), 1700);
+    check("thro cached period", thro.period_us(), 19990);
+    tim2.CNT = 1750;
+    check("thro since edge", thro.sinceEdge_us(), 50);
+    thro.interrupt(false);
+    check("tim2 CC1IE off", tim2.DIER, 0);
+
+    // LRIN: TIM8_CH3 in edge mode at 180 MHz
+    memset(&tim8, 0, sizeof(tim8));
+    TIMCAPTURE lr(&tim8, 3, 180000000);
+    check("edge mode", lr.pwmInput(), 0);
+    check("tim8 PSC", tim8.PSC, 179);
+    check("tim8 SMCR untouched", tim8.SMCR, 0);
+    check("tim8 CCMR2 IC3=TI3", tim8.CCMR2, 0x31);
+    check("tim8 CCER CC3 rising", tim8.CCER, 0x100);
+    check("tim8 CC3IE", tim8.DIER, 0x8);
+
+    // Rise near the top of the count, fall after the wrap
+    check("lr rise", edge(&tim8, lr, 3, 65000), 0);
+    check("lr falling next", tim8.CCER, 0x300);
+    check("lr fall", edge(&tim8, lr, 3, 65000 + 1500), 1);
+    check("lr rising next", tim8.CCER, 0x100);
+    check("lr width across wrap", lr.pulsewidth_us(), 1500);
+    tim8.CNT = (65000 + 1500 + 80) & 0xFFFF;
+    check("lr since edge", lr.sinceEdge_us(), 80);
+    check("lr no period yet", lr.period_us(), 0);
+    edge(&tim8, lr, 3, 65000 + 20000);
+    check("lr period", lr.period_us(), 20000);
+    edge(&tim8, lr, 3, 65000 + 20000 + 1234);
+    check("lr width", lr.pulsewidth_us(), 1234);
+
+    // Overcapture means an edge was lost, resync on the next rise
+    edge(&tim8, lr, 3, 65000 + 40000);
+    tim8.SR = (1 << 3) | (1 << 11);
+    check("lr overcapture", lr.irq(), 0);
+    check("lr overcapture cleared", tim8.SR & ((1 << 3) | (1 << 11)), 0);
+    check("lr resync rising", tim8.CCER, 0x100);
+    tim8.SR = 0;
+    check("lr resync rise", edge(&tim8, lr, 3, 5000), 0);
+    check("lr resync fall", edge(&tim8, lr, 3, 6600), 1);
+    check("lr resync width", lr.pulsewidth_us(), 1600);
+
+    // A second edge channel on the same timer leaves the first alone
+    TIMCAPTURE other(&tim8, 4, 180000000);
+    check("tim8 CCER both", tim8.CCER, 0x1100);
+    check("tim8 CCMR2 both", tim8.CCMR2, 0x3131);
+    tim8.SR = 1 << 4;
+    check("ch3 ignores ch4 flag", lr.irq(), 0);
+    check("ch4 rise", other.irq(), 0);
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
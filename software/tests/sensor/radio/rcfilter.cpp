@@ -0,0 +1,177 @@
+/* @file rcfilter.cpp
+*
+* This file contains the glitch filter and signal quality tracking kept for
+* each radio channel by PwmIn. It has no mbed dependencies so it can be run
+* on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "rcfilter.h"
+
+#define WINDOW_MASK ((uint16_t)((1UL << RCFILTER_WINDOW) - 1))
+
+//------------------------------------------------------------------------------
+
+RCFILTER::RCFILTER(mode_t mode): _mode(mode)
+{
+
+    _head = 0;
+    _count = 0;
+    _value = 0;
+    _period = RCFILTER_PERIOD_US;
+    _window = 0;
+    _seen = false;
+    _good = false;
+    _lastFrame = 0;
+    _lastGood = 0;
+    _frames = 0;
+    _rejected = 0;
+    _missing = 0;
+
+}
+
+//------------------------------------------------------------------------------
+
+void RCFILTER::setMode(mode_t mode)
+{
+
+    _mode = mode;
+
+}
+
+//------------------------------------------------------------------------------
+
+// Whole frames that should have arrived since the last one but have not
+int RCFILTER::overdue(uint32_t now_us)
+{
+
+    uint32_t gap = now_us - _lastFrame;
+
+    if (!_seen) {
+        return 0;
+    }
+    return (int)((gap + _period / 2) / _period) - 1;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool RCFILTER::frame(int width_us, int period_us, uint32_t now_us)
+{
+
+    int lost = overdue(now_us);
+    bool ok = width_us >= RCFILTER_MIN_US && width_us <= RCFILTER_MAX_US;
+    uint16_t window = _window;
+
+    if (period_us >= RCFILTER_PERIOD_MIN_US && period_us <= RCFILTER_PERIOD_MAX_US) {
+        _period = period_us;
+    }
+
+    if (lost > 0) {
+        _missing += lost;
+        window = lost >= RCFILTER_WINDOW ? 0 : (uint16_t)(window << lost);
+    }
+    _window = (uint16_t)(((window << 1) | (ok ? 1 : 0)) & WINDOW_MASK);
+
+    _frames++;
+    _seen = true;
+    _lastFrame = now_us;
+
+    if (!ok) {
+        _rejected++;
+        return false;
+    }
+
+    _hist[(_head + _count) % RCFILTER_HISTORY] = width_us;
+    if (_count < RCFILTER_HISTORY) {
+        _count++;
+    } else {
+        _head = (_head + 1) % RCFILTER_HISTORY;
+    }
+    _value = filter();
+    _good = true;
+    _lastGood = now_us;
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+int RCFILTER::filter(void)
+{
+
+    int s[RCFILTER_HISTORY];
+    int sum = 0;
+    int i, j, v;
+
+    // Insertion sort, the ring is only a few entries long
+    for (i = 0; i < _count; i++) {
+        v = _hist[i];
+        for (j = i; j > 0 && s[j - 1] > v; j--) {
+            s[j] = s[j - 1];
+        }
+        s[j] = v;
+    }
+
+    if (_mode == MEDIAN) {
+        if (_count & 1) {
+            return s[_count / 2];
+        }
+        return (s[_count / 2 - 1] + s[_count / 2]) / 2;
+    }
+
+    if (_count < 3) {
+        for (i = 0; i < _count; i++) {
+            sum += s[i];
+        }
+        return sum / _count;
+    }
+    for (i = 1; i < _count - 1; i++) {
+        sum += s[i];
+    }
+    return sum / (_count - 2);
+
+}
+
+//------------------------------------------------------------------------------
+
+int RCFILTER::quality(uint32_t now_us)
+{
+
+    int lost = overdue(now_us);
+    uint16_t window = _window;
+    int n = 0;
+
+    if (lost >= RCFILTER_WINDOW) {
+        return 0;
+    }
+    if (lost > 0) {
+        window = (uint16_t)((window << lost) & WINDOW_MASK);
+    }
+    for (; window; window &= window - 1) {
+        n++;
+    }
+    return n * 100 / RCFILTER_WINDOW;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool RCFILTER::stale(uint32_t now_us)
+{
+
+    return !_good || now_us - _lastGood > (uint32_t)(RCFILTER_STALE_FRAMES * _period);
+
+}
+
+//------------------------------------------------------------------------------
+
+void RCFILTER::getStats(rcfilter_stats_t *stats)
+{
+
+    stats->frames = _frames;
+    stats->rejected = _rejected;
+    stats->missing = _missing;
+
+}
@@ -0,0 +1,152 @@
+/* @file rcfilter.h
+*
+* This file contains the glitch filter and signal quality tracking kept for
+* each radio channel by PwmIn. It has no mbed dependencies so it can be run
+* on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef RCFILTER_H
+#define RCFILTER_H
+
+#include <stdint.h>
+
+// Pulses outside this range are rejected (us)
+#define RCFILTER_MIN_US 900
+#define RCFILTER_MAX_US 2100
+
+// Accepted pulses kept for the filter
+#define RCFILTER_HISTORY 5
+
+// Frames behind quality(), at most 16
+#define RCFILTER_WINDOW 16
+
+// Frame period assumed until one is measured, and the range trusted (us)
+#define RCFILTER_PERIOD_US     20000
+#define RCFILTER_PERIOD_MIN_US 5000
+#define RCFILTER_PERIOD_MAX_US 30000
+
+// Periods without an accepted pulse before the channel is stale
+#define RCFILTER_STALE_FRAMES 3
+
+// Counters since construction
+typedef struct
+{
+    uint32_t frames;    // Pulses seen, accepted or not
+    uint32_t rejected;  // Pulses outside RCFILTER_MIN_US to RCFILTER_MAX_US
+    uint32_t missing;   // Frames that never arrived
+} rcfilter_stats_t;
+
+//------------------------------------------------------------------------------
+/** @brief   Filters the pulse widths of one radio channel.
+*   @details frame() is called at the end of every pulse, normally from an
+*            interrupt. Out of range pulses are counted and dropped, accepted
+*            ones go into a short ring and the filtered value is worked out
+*            there and then, so value() is a single load. Gaps between pulses
+*            longer than the frame period are counted as missing frames.
+*
+*            quality() is the percentage of the last RCFILTER_WINDOW frames
+*            that arrived in range, counting frames overdue at the time of
+*            the call as lost, so it falls when the receiver goes quiet.
+*
+*            Times are microsecond counter values and may wrap. All outputs
+*            are integers, nothing here uses the FPU.
+*/
+
+class RCFILTER
+{
+
+public:
+
+    enum mode_t
+    {
+        MEDIAN,         // Median of the ring
+        TRIMMED_MEAN    // Mean of the ring without its lowest and highest
+    };
+
+    //--------------------------------------------------------------------------
+    /** Constructor with an empty history.
+    *
+    *   @param mode Filter applied to the ring.
+    */
+
+    RCFILTER(mode_t mode = MEDIAN);
+
+    //--------------------------------------------------------------------------
+    /** Changes the filter, the next accepted pulse uses it.
+    */
+
+    void setMode(mode_t mode);
+
+    //--------------------------------------------------------------------------
+    /** Takes one pulse.
+    *
+    *   @param width_us  Pulse width.
+    *   @param period_us Time since the previous pulse started, 0 if unknown.
+    *   @param now_us    Time of the pulse.
+    *   @return true if the pulse was accepted.
+    */
+
+    bool frame(int width_us, int period_us, uint32_t now_us);
+
+    //--------------------------------------------------------------------------
+    /** Returns the filtered pulse width in us, 0 before the first accepted
+    *   pulse.
+    */
+
+    int value(void) { return _value; }
+
+    //--------------------------------------------------------------------------
+    /** Returns the share of recent frames received in range, 0 to 100.
+    *
+    *   @param now_us Time of the call.
+    */
+
+    int quality(uint32_t now_us);
+
+    //--------------------------------------------------------------------------
+    /** Returns true if no pulse has been accepted for RCFILTER_STALE_FRAMES
+    *   frame periods, or none ever has.
+    *
+    *   @param now_us Time of the call.
+    */
+
+    bool stale(uint32_t now_us);
+
+    //--------------------------------------------------------------------------
+    /** Copies the counters.
+    */
+
+    void getStats(rcfilter_stats_t *stats);
+
+private:
+
+    int filter(void);
+    int overdue(uint32_t now_us);
+
+    mode_t _mode;
+
+    // Accepted pulses, oldest first from _head
+    int _hist[RCFILTER_HISTORY];
+    int _head;
+    int _count;
+
+    volatile int _value;
+    volatile int _period;
+
+    // Bit 0 is the latest frame, set if it was accepted
+    volatile uint16_t _window;
+
+    volatile bool _seen;
+    volatile bool _good;
+    volatile uint32_t _lastFrame;
+    volatile uint32_t _lastGood;
+
+    volatile uint32_t _frames;
+    volatile uint32_t _rejected;
+    volatile uint32_t _missing;
+
+}; // end of class rcfilter
+
+#endif
@@ -0,0 +1,114 @@
+/* @file rcfilterdev.cpp
+*
+* Host test of the radio channel filter.
+*
+* g++ -o rcfilterdev rcfilterdev.cpp rcfilter.cpp && ./rcfilterdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "rcfilter.h"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+int main() {
+    rcfilter_stats_t s;
+    uint32_t t;
+    int i;
+
+    // Nothing received yet
+    RCFILTER f;
+    check("empty value", f.value(), 0);
+    check("empty stale", f.stale(0), 1);
+    check("empty quality", f.quality(0), 0);
+
+    // Median follows the middle of the ring and ignores a single spike
+    t = 0xFFFF0000UL;   // Wraps during the test
+    f.frame(1500, 20000, t);
+    check("one pulse", f.value(), 1500);
+    f.frame(1520, 20000, t += 20000);
+    check("even median", f.value(), 1510);
+    f.frame(2000, 20000, t += 20000);
+    check("median of three", f.value(), 1520);
+    f.frame(1510, 20000, t += 20000);
+    f.frame(1505, 20000, t += 20000);
+    check("spike ignored", f.value(), 1510);
+    check("fresh", f.stale(t), 0);
+
+    // Out of range pulses are counted and leave the value alone
+    check("reject short", f.frame(899, 20000, t += 20000), 0);
+    check("reject long", f.frame(2101, 20000, t += 20000), 0);
+    check("accept edge", f.frame(900, 20000, t += 20000), 1);
+    check("accept edge", f.frame(2100, 20000, t += 20000), 1);
+    f.getStats(&s);
+    check("frames", s.frames, 9);
+    check("rejected", s.rejected, 2);
+    check("missing", s.missing, 0);
+
+    // 7 of the last 16 frames in range
+    check("quality", f.quality(t), 7 * 100 / 16);
+    for (i = 0; i < 16; i++) {
+        f.frame(1500, 20000, t += 20000);
+    }
+    check("quality full", f.quality(t), 100);
+    check("quality late but not lost", f.quality(t + 29000), 100);
+    check("quality one lost", f.quality(t + 31000), 15 * 100 / 16);
+
+    // A gap of three periods is two missing frames
+    f.frame(1500, 20000, t += 60000);
+    f.getStats(&s);
+    check("missing counted", s.missing, 2);
+    check("quality after gap", f.quality(t), 14 * 100 / 16);
+
+    // Stale after three periods without a good pulse, rejects do not help
+    f.frame(500, 20000, t + 20000);
+    f.frame(500, 20000, t + 40000);
+    f.frame(500, 20000, t + 60000);
+    check("not yet stale", f.stale(t + 60000), 0);
+    check("stale", f.stale(t + 60001), 1);
+    check("silent receiver", f.quality(t + 60000 + 16 * 20000), 0);
+
+    // Measured period is used for the gap and stale checks
+    RCFILTER g;
+    g.frame(1500, 10000, 0);
+    g.frame(1500, 10000, 10000);
+    check("fast stale", g.stale(40001), 1);
+    g.frame(1500, 10000, 40000);
+    g.getStats(&s);
+    check("fast missing", s.missing, 2);
+    g.frame(1500, 100000, 50000);
+    check("period out of range ignored", g.stale(80000), 0);
+    check("period out of range ignored", g.stale(80001), 1);
+
+    // Trimmed mean drops the lowest and highest of the ring
+    RCFILTER m(RCFILTER::TRIMMED_MEAN);
+    m.frame(1000, 20000, 0);
+    check("mean of one", m.value(), 1000);
+    m.frame(1100, 20000, 20000);
+    check("mean of two", m.value(), 1050);
+    m.frame(2000, 20000, 40000);
+    check("trimmed three", m.value(), 1100);
+    m.frame(1200, 20000, 60000);
+    m.frame(1300, 20000, 80000);
+    check("trimmed five", m.value(), 1200);
+    m.frame(1400, 20000, 100000);
+    check("oldest dropped", m.value(), 1300);
+    m.setMode(RCFILTER::MEDIAN);
+    m.frame(1400, 20000, 120000);
+    check("mode switched", m.value(), 1400);
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
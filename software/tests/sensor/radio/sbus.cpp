@@ -0,0 +1,111 @@
+/* @file sbus.cpp
+*
+* This file contains the SBUS byte stream decoder used by SBUSRX. It has no
+* mbed dependencies so it can be run on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <string.h>
+#include "sbus.h"
+
+// Footer is 0x00 on SBUS, SBUS2 receivers cycle 0x04, 0x14, 0x24, 0x34
+#define FOOTER_OK(b) ((b) == 0x00 || ((b) & 0xCF) == 0x04)
+
+//------------------------------------------------------------------------------
+
+SBUS::SBUS()
+{
+
+    _len = 0;
+    memset(&_frame, 0, sizeof(_frame));
+    memset(&_stats, 0, sizeof(_stats));
+
+}
+
+//------------------------------------------------------------------------------
+
+bool SBUS::put(uint8_t byte, uint32_t now_us)
+{
+
+    if (_len == 0 && byte != SBUS_HEADER) {
+        _stats.skipped++;
+        return false;
+    }
+
+    _buf[_len++] = byte;
+    if (_len < SBUS_FRAME_LEN) {
+        return false;
+    }
+
+    if (!FOOTER_OK(_buf[SBUS_FRAME_LEN - 1])) {
+        _stats.bad++;
+        resync();
+        return false;
+    }
+
+    decode();
+    _frame.time = now_us;
+    _stats.frames++;
+    _len = 0;
+    return true;
+
+}
+
+//------------------------------------------------------------------------------
+
+void SBUS::gap(void)
+{
+
+    _len = 0;
+
+}
+
+//------------------------------------------------------------------------------
+
+// Restarts from the next header after the first byte of a rejected frame
+void SBUS::resync(void)
+{
+
+    int i = 1;
+
+    while (i < _len && _buf[i] != SBUS_HEADER) {
+        i++;
+    }
+    _stats.skipped += i;
+    _len -= i;
+    memmove(_buf, _buf + i, _len);
+
+}
+
+//------------------------------------------------------------------------------
+
+// Unpacks the channels, least significant bit first
+void SBUS::decode(void)
+{
+
+    const uint8_t *p = _buf + 1;
+    uint32_t bits = 0;
+    int have = 0;
+
+    for (int ch = 0; ch < SBUS_CHANNELS; ch++) {
+        while (have < 11) {
+            bits |= (uint32_t)*p++ << have;
+            have += 8;
+        }
+        _frame.raw[ch] = bits & 0x7FF;
+        bits >>= 11;
+        have -= 11;
+    }
+    _frame.flags = _buf[SBUS_FRAME_LEN - 2];
+
+}
+
+//------------------------------------------------------------------------------
+
+void SBUS::getStats(sbus_stats_t *stats)
+{
+
+    *stats = _stats;
+
+}
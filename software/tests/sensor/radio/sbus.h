@@ -0,0 +1,111 @@
+/* @file sbus.h
+*
+* This file contains the SBUS byte stream decoder used by SBUSRX. It has no
+* mbed dependencies so it can be run on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef SBUS_H
+#define SBUS_H
+
+#include <stdint.h>
+
+// Frame layout: header, 16 packed 11 bit channels, flags, footer
+#define SBUS_FRAME_LEN 25
+#define SBUS_HEADER    0x0F
+#define SBUS_CHANNELS  16
+
+// Flag byte
+#define SBUS_FLAG_CH17      0x01
+#define SBUS_FLAG_CH18      0x02
+#define SBUS_FLAG_LOST      0x04    // Receiver missed a radio frame, values held
+#define SBUS_FLAG_FAILSAFE  0x08    // Receiver lost the transmitter
+
+// One decoded frame
+typedef struct
+{
+    uint32_t time;                  // Time passed with the last byte (us),
+                                    // the idle line interrupt in SBUSRX
+    uint16_t raw[SBUS_CHANNELS];    // Channel values, 0 to 2047
+    uint8_t flags;
+} sbus_frame_t;
+
+// Decoder counters since construction
+typedef struct
+{
+    uint32_t frames;    // Good frames
+    uint32_t bad;       // Frames dropped for a bad footer
+    uint32_t skipped;   // Bytes dropped looking for a header
+} sbus_stats_t;
+
+//------------------------------------------------------------------------------
+/** @brief   Decodes the SBUS serial stream from a radio receiver.
+*   @details Bytes go in one at a time as they arrive (100000 baud 8E2, one
+*            frame every 7 or 14 ms). A frame starts with the header byte and
+*            is only accepted if its 25th byte is a valid footer, otherwise
+*            the decoder looks for the next header inside the bytes it
+*            already has, so it locks on again within a frame or two after
+*            joining mid stream or losing a byte. gap() tells it the line went
+*            idle, which always falls between frames.
+*/
+
+class SBUS
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor, waits for a header.
+    */
+
+    SBUS();
+
+    //--------------------------------------------------------------------------
+    /** Takes one byte.
+    *
+    *   @param byte   Received byte.
+    *   @param now_us Time to stamp a frame it completes with.
+    *   @return true if it completed a good frame, see frame().
+    */
+
+    bool put(uint8_t byte, uint32_t now_us);
+
+    //--------------------------------------------------------------------------
+    /** Drops any partial frame, for an idle line between frames.
+    */
+
+    void gap(void);
+
+    //--------------------------------------------------------------------------
+    /** Returns the latest good frame.
+    */
+
+    const sbus_frame_t &frame(void) { return _frame; }
+
+    //--------------------------------------------------------------------------
+    /** Copies the counters.
+    */
+
+    void getStats(sbus_stats_t *stats);
+
+    //--------------------------------------------------------------------------
+    /** Converts a channel value to the servo pulse width it stands for, using
+    *   the usual FrSky scale: 172 is 988 us, 992 is 1500 us, 1811 is 2011 us.
+    */
+
+    static int toPulse_us(uint16_t raw) { return 1500 + ((int)raw - 992) * 5 / 8; }
+
+private:
+
+    void decode(void);
+    void resync(void);
+
+    uint8_t _buf[SBUS_FRAME_LEN];
+    int _len;
+    sbus_frame_t _frame;
+    sbus_stats_t _stats;
+
+}; // end of class sbus
+
+#endif
@@ -0,0 +1,135 @@
+/* @file sbusdev.cpp
+*
+* Host test of the SBUS decoder against a recorded style byte stream.
+*
+* g++ -o sbusdev sbusdev.cpp sbus.cpp && ./sbusdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "sbus.h"
+
+static int failed = 0;
+
+void check(const char *what, long got, long want) {
+    if (got != want) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+        failed++;
+    }
+}
+
+// Channels 172, 992, 1811, 992, 1500, 200, 1024, 2047, 0, 1, 2, 4, 8, 16,
+// 1000, 1811, no flags
+static const uint8_t frameA[SBUS_FRAME_LEN] = {
+    0x0F, 0xAC, 0x00, 0xDF, 0xC4, 0xC1, 0xC7, 0x5D, 0x64, 0x00, 0xF0, 0xFF,
+    0x00, 0x08, 0x80, 0x00, 0x08, 0x80, 0x00, 0x08, 0xA0, 0x6F, 0xE2, 0x00,
+    0x00};
+static const uint16_t rawA[SBUS_CHANNELS] = {
+    172, 992, 1811, 992, 1500, 200, 1024, 2047, 0, 1, 2, 4, 8, 16, 1000, 1811};
+
+// All 992 but channel 2 at 1200 and channel 5 at 1811, SBUS2 footer
+static const uint8_t frameB[SBUS_FRAME_LEN] = {
+    0x0F, 0xE0, 0x03, 0x1F, 0x2C, 0xC1, 0x07, 0xBE, 0x89, 0x83, 0x0F, 0x7C,
+    0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0x00,
+    0x14};
+
+// All 992, frame lost and failsafe set
+static const uint8_t frameC[SBUS_FRAME_LEN] = {
+    0x0F, 0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C,
+    0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0x0C,
+    0x00};
+
+// Channel 0 at 128 and channel 15 at 1024, each only bit 7 of its byte, so
+// a UART that keeps parity in bit 7 would zero both
+static const uint8_t frameD[SBUS_FRAME_LEN] = {
+    0x0F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00,
+    0x00};
+
+// Feeds bytes and returns how many frames they completed
+int feed(SBUS &s, const uint8_t *data, int n, uint32_t now) {
+    int frames = 0;
+
+    for (int i = 0; i < n; i++) {
+        frames += s.put(data[i], now);
+    }
+    return frames;
+}
+
+int main() {
+    sbus_stats_t st;
+    int i;
+
+    // Pulse width scale
+    check("min pulse", SBUS::toPulse_us(172), 988);
+    check("mid pulse", SBUS::toPulse_us(992), 1500);
+    check("max pulse", SBUS::toPulse_us(1811), 2011);
+
+    // Joining mid frame: the tail of a frame, an idle gap, then whole frames
+    // split across DMA chunks the way the idle interrupt hands them over
+    SBUS s;
+    check("tail", feed(s, frameB + 10, 15, 100), 0);
+    s.gap();
+    check("first half", feed(s, frameA, 12, 7000), 0);
+    check("second half", feed(s, frameA + 12, 13, 7000), 1);
+    for (i = 0; i < SBUS_CHANNELS; i++) {
+        check("frame A channel", s.frame().raw[i], rawA[i]);
+    }
+    check("frame A flags", s.frame().flags, 0);
+    check("frame A time", s.frame().time, 7000);
+    s.gap();
+
+    check("frame B", feed(s, frameB, SBUS_FRAME_LEN, 14000), 1);
+    check("frame B ch2", s.frame().raw[2], 1200);
+    check("frame B ch5", s.frame().raw[5], 1811);
+    check("frame B ch0", s.frame().raw[0], 992);
+    s.gap();
+
+    check("frame C", feed(s, frameC, SBUS_FRAME_LEN, 21000), 1);
+    check("frame C flags", s.frame().flags, SBUS_FLAG_LOST | SBUS_FLAG_FAILSAFE);
+    s.gap();
+
+    s.getStats(&st);
+    check("frames", st.frames, 3);
+    check("bad", st.bad, 0);
+
+    // Without gaps: a frame missing three bytes runs into the next, whose
+    // header is found again inside the rejected bytes
+    SBUS r;
+    check("short frame", feed(r, frameA, SBUS_FRAME_LEN - 3, 0), 0);
+    check("resync on B", feed(r, frameB, SBUS_FRAME_LEN, 7000), 1);
+    check("resync B ch2", r.frame().raw[2], 1200);
+    check("back to back", feed(r, frameA, SBUS_FRAME_LEN, 14000), 1);
+    check("back to back ch7", r.frame().raw[7], 2047);
+    r.getStats(&st);
+    check("resync bad", st.bad, 1);
+    check("resync skipped", st.skipped, SBUS_FRAME_LEN - 3);
+
+    // A corrupt footer is never accepted
+    uint8_t bad[SBUS_FRAME_LEN];
+    for (i = 0; i < SBUS_FRAME_LEN; i++) {
+        bad[i] = frameA[i];
+    }
+    bad[SBUS_FRAME_LEN - 1] = 0x80;
+    SBUS b;
+    check("bad footer", feed(b, bad, SBUS_FRAME_LEN, 0), 0);
+    b.gap();
+    check("after bad footer", feed(b, frameB, SBUS_FRAME_LEN, 0), 1);
+
+    // Bit 7 is data
+    SBUS d;
+    check("bit 7 frame", feed(d, frameD, SBUS_FRAME_LEN, 0), 1);
+    check("bit 7 ch0", d.frame().raw[0], 128);
+    check("bit 7 ch15", d.frame().raw[15], 1024);
+    for (i = 1; i < SBUS_CHANNELS - 1; i++) {
+        check("bit 7 others", d.frame().raw[i], 0);
+    }
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+/* @file sbusrx.cpp
+*
+* This file contains the SBUS receiver on USART6 with DMA, and the PwmIn
+* channels it feeds.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "sbusrx.h"
+
+// DMA2 stream 1 flags in LISR/LIFCR (RM0390 section 9.5)
+#define DMA_S1_FLAGS (DMA_LIFCR_CFEIF1 | DMA_LIFCR_CDMEIF1 | DMA_LIFCR_CTEIF1 | \
+                      DMA_LIFCR_CHTIF1 | DMA_LIFCR_CTCIF1)
+
+static const sbus_frame_t sbusInit = {0, {0}, 0};
+
+SBUSRX *SBUSRX::_self = NULL;
+
+//------------------------------------------------------------------------------
+
+void PwmInSbus::pulse(int width_us, int period_us, uint32_t time_us)
+{
+
+    _pulsewidth = width_us;
+    _period = period_us;
+    frame(width_us, period_us, time_us);
+
+}
+
+//------------------------------------------------------------------------------
+
+SBUSRX::SBUSRX(PinName rx): _serial(NC, rx, 100000), _snap(sbusInit)
+{
+
+    if (rx != PC_7 || _self != NULL) {
+        error("SBUSRX: SBUS needs PC_7 (USART6_RX)\r\n");
+    }
+    _self = this;
+    _tail = 0;
+    _seen = false;
+    _last = 0;
+
+    // 8 data bits, even parity, 2 stop bits. The parity bit sits inside the
+    // word, and the STM32F4 serial_format() only sets a 9 bit word for 9, so
+    // 8 here would leave 7 data bits and parity in bit 7 of every byte.
+    _serial.format(9, SerialBase::Even, 2);
+
+    // Bytes go straight from the data register into the circular buffer
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    DMA2_Stream1->CR = 0;
+    while (DMA2_Stream1->CR & DMA_SxCR_EN) {
+    }
+    DMA2->LIFCR = DMA_S1_FLAGS;
+    DMA2_Stream1->PAR = (uint32_t)&USART6->DR;
+    DMA2_Stream1->M0AR = (uint32_t)_dma;
+    DMA2_Stream1->NDTR = SBUS_DMA_LEN;
+    DMA2_Stream1->CR = DMA_SxCR_CHSEL_0 * 5 | DMA_SxCR_MINC | DMA_SxCR_CIRC;
+    DMA2_Stream1->CR |= DMA_SxCR_EN;
+
+    USART6->CR3 |= USART_CR3_DMAR;
+    USART6->CR1 |= USART_CR1_IDLEIE;
+    NVIC_SetVector(USART6_IRQn, (uint32_t)&SBUSRX::irq);
+    NVIC_EnableIRQ(USART6_IRQn);
+
+}
+
+//------------------------------------------------------------------------------
+
+void SBUSRX::irq(void)
+{
+
+    _self->service();
+
+}
+
+//------------------------------------------------------------------------------
+
+// Decodes everything the DMA has written since the last idle line
+void SBUSRX::service(void)
+{
+
+    uint32_t now = us_ticker_read();
+    int head;
+
+    // Reading SR then DR clears IDLE and any error flag, the line is quiet
+    // so no byte is lost to the DMA
+    (void)USART6->SR;
+    (void)USART6->DR;
+
+    head = SBUS_DMA_LEN - DMA2_Stream1->NDTR;
+    while (_tail != head) {
+        if (_sbus.put(_dma[_tail], now)) {
+            publish();
+        }
+        _tail = (_tail + 1) % SBUS_DMA_LEN;
+    }
+    _sbus.gap();
+
+}
+
+//------------------------------------------------------------------------------
+
+void SBUSRX::publish(void)
+{
+
+    const sbus_frame_t &f = _sbus.frame();
+    int period = _seen ? (int)(f.time - _last) : 0;
+
+    _seen = true;
+    _last = f.time;
+
+    *_snap.begin() = f;
+    _snap.commit();
+
+    if (f.flags & (SBUS_FLAG_LOST | SBUS_FLAG_FAILSAFE)) {
+        return;
+    }
+    for (int ch = 0; ch < SBUS_CHANNELS; ch++) {
+        _ch[ch].pulse(SBUS::toPulse_us(f.raw[ch]), period, f.time);
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void SBUSRX::getStats(sbus_stats_t *stats)
+{
+
+    core_util_critical_section_enter();
+    _sbus.getStats(stats);
+    core_util_critical_section_exit();
+
+}
+
+//------------------------------------------------------------------------------
+
+void SBUSRX::report(Serial &pc)
+{
+
+    sbus_stats_t s;
+
+    getStats(&s);
+    pc.printf("SBUS: %lu frames, %lu bad, %lu bytes skipped\r\n",
+              s.frames, s.bad, s.skipped);
+
+}
@@ -0,0 +1,126 @@
+/* @file sbusrx.h
+*
+* This file contains the SBUS receiver on USART6 with DMA, and the PwmIn
+* channels it feeds.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef SBUSRX_H
+#define SBUSRX_H
+
+#include "mbed.h"
+#include "PwmIn.h"
+#include "sbus.h"
+#include "snapshot.h"
+
+// Circular DMA buffer, holds more than two frames
+#define SBUS_DMA_LEN 64
+
+//------------------------------------------------------------------------------
+/** @brief   One SBUS channel behind the PwmIn API.
+*   @details Filled by SBUSRX with the pulse width the channel value stands
+*            for, so filtered_us(), quality(), stale() and attach() behave as
+*            on a PWM pin. period_us() is the SBUS frame interval.
+*/
+
+class PwmInSbus : public PwmIn
+{
+
+public:
+
+    PwmInSbus() : PwmIn() {}
+
+    //--------------------------------------------------------------------------
+    /** Takes the channel from a new frame, in interrupt context.
+    *
+    *   @param time_us The frame's time, taken as the end of the pulse.
+    */
+
+    void pulse(int width_us, int period_us, uint32_t time_us);
+
+}; // end of class pwminsbus
+
+//------------------------------------------------------------------------------
+/** @brief   Receives every radio channel from one SBUS pin.
+*   @details The five PWM inputs cost a pin and two interrupts each per frame.
+*            SBUS brings all 16 channels down one wire: DMA copies the bytes
+*            into a circular buffer and the USART idle line interrupt, which
+*            fires once after each frame, runs them through the SBUS decoder.
+*            Each good frame is published with its time in a SNAPSHOT and
+*            passed to the channel objects. Frames flagged lost or failsafe
+*            by the receiver are not passed on, so the channels go stale the
+*            same way a silent PWM input does.
+*
+*            SBUS is inverted UART and the F446 USART cannot invert its
+*            input, so the receiver must go through an inverter (or use an
+*            uninverted SBUS output) to SBRX on PC_7, USART6_RX, which runs
+*            on DMA2 stream 1 channel 5. Only one SBUSRX can exist.
+*/
+
+class SBUSRX
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor that sets up the USART, DMA and interrupt.
+    *
+    * Stops with error() for any pin but PC_7.
+    *
+    *   @param rx Receive pin.
+    */
+
+    SBUSRX(PinName rx);
+
+    //--------------------------------------------------------------------------
+    /** Returns a channel with the PwmIn API.
+    *
+    *   @param ch Channel, 0 to 15.
+    */
+
+    PwmIn &channel(int ch) { return _ch[ch]; }
+
+    //--------------------------------------------------------------------------
+    /** Copies the latest frame if it changed since the last read.
+    *
+    *   @param f    Frame copy.
+    *   @param seen Sequence of the last frame read, updated.
+    *   @return true if the frame is new.
+    */
+
+    bool read(sbus_frame_t *f, uint32_t *seen) { return _snap.read(f, seen); }
+
+    //--------------------------------------------------------------------------
+    /** Copies the decoder counters.
+    */
+
+    void getStats(sbus_stats_t *stats);
+
+    //--------------------------------------------------------------------------
+    /** Prints the decoder counters.
+    */
+
+    void report(Serial &pc);
+
+private:
+
+    static void irq(void);
+    void service(void);
+    void publish(void);
+
+    RawSerial _serial;
+    SBUS _sbus;
+    SNAPSHOT<sbus_frame_t> _snap;
+    PwmInSbus _ch[SBUS_CHANNELS];
+
+    uint8_t _dma[SBUS_DMA_LEN];
+    int _tail;
+    bool _seen;
+    uint32_t _last;
+
+    static SBUSRX *_self;
+
+}; // end of class sbusrx
+
+#endif
@@ -0,0 +1,225 @@
+/* @file timcapture.cpp
+*
+* This file contains the register level timer input capture used by
+* PwmInCapture. It only touches the TIM registers so it can run against
+* stm32_mock.h on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "timcapture.h"
+
+// TIMx register fields (RM0390 section 17.4 and 18.4)
+#define CR1_CEN       0x0001
+#define EGR_UG        0x0001
+#define SMCR_SMS_RST  0x0004    // Slave mode: reset on trigger
+#define SMCR_TS_TI1   0x0050    // Trigger: TI1FP1
+#define SMCR_TS_TI2   0x0060    // Trigger: TI2FP2
+#define CCMR_CCS_DIR  0x01      // ICx on its own input TIx
+#define CCMR_CCS_ALT  0x02      // ICx on the other input of the pair
+#define CCMR_ICF_N8   0x30      // 8 samples at the timer clock
+#define CCMR_MASK     0xFF
+#define CCER_CCE      0x1
+#define CCER_CCP      0x2       // With CCNP clear: falling edge
+#define CCER_CCNP     0x8
+#define CCER_MASK     0xF
+
+//------------------------------------------------------------------------------
+
+// Capture/compare mode register and bit offset of a channel
+static volatile uint32_t *ccmr(TIM_TypeDef *tim, int channel, int *shift)
+{
+
+    *shift = ((channel - 1) & 1) * 8;
+    return channel <= 2 ? &tim->CCMR1 : &tim->CCMR2;
+
+}
+
+//------------------------------------------------------------------------------
+
+// Sets a channel to capture its rising or falling edge
+static void polarity(TIM_TypeDef *tim, int channel, bool falling)
+{
+
+    int shift = (channel - 1) * 4;
+
+    if (falling) {
+        tim->CCER |= CCER_CCP << shift;
+    } else {
+        tim->CCER &= ~(CCER_CCP << shift);
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+TIMCAPTURE::TIMCAPTURE(TIM_TypeDef *tim, int channel, uint32_t clock_hz):
+                       _tim(tim), _channel(channel)
+{
+
+    volatile uint32_t *mode;
+    int shift;
+
+    _pwmInput = channel <= 2;
+    _fallChannel = 3 - channel;
+    _high = false;
+    _seen = false;
+    _irqOn = false;
+    _rise = 0;
+    _fall = 0;
+    _period = 0;
+    _pulsewidth = 0;
+
+    // Count microseconds, wrapping at 16 bits even on TIM2 and TIM5
+    _tim->CR1 &= ~CR1_CEN;
+    _tim->PSC = clock_hz / 1000000 - 1;
+    _tim->ARR = 0xFFFF;
+
+    mode = ccmr(_tim, _channel, &shift);
+    *mode = (*mode & ~(CCMR_MASK << shift)) |
+            ((CCMR_CCS_DIR | CCMR_ICF_N8) << shift);
+    _tim->CCER &= ~(CCER_MASK << ((_channel - 1) * 4));
+
+    if (_pwmInput) {
+        // Second capture of the same input latches the falling edge
+        mode = ccmr(_tim, _fallChannel, &shift);
+        *mode = (*mode & ~(CCMR_MASK << shift)) |
+                ((CCMR_CCS_ALT | CCMR_ICF_N8) << shift);
+        _tim->CCER &= ~(CCER_MASK << ((_fallChannel - 1) * 4));
+        _tim->CCER |= (CCER_CCE | CCER_CCP) << ((_fallChannel - 1) * 4);
+
+        // Rising edge restarts the count
+        _tim->SMCR = (_channel == 1 ? SMCR_TS_TI1 : SMCR_TS_TI2) | SMCR_SMS_RST;
+    }
+
+    _tim->CCER |= CCER_CCE << ((_channel - 1) * 4);
+
+    if (!_pwmInput) {
+        interrupt(true);
+    }
+
+    _tim->EGR = EGR_UG;
+    _tim->CR1 |= CR1_CEN;
+
+}
+
+//------------------------------------------------------------------------------
+
+volatile uint32_t *TIMCAPTURE::ccr(int channel)
+{
+
+    return &_tim->CCR1 + (channel - 1);
+
+}
+
+//------------------------------------------------------------------------------
+
+int TIMCAPTURE::period_us(void)
+{
+
+    if (_pwmInput && !_irqOn) {
+        return (int)*ccr(_channel);
+    }
+    return _period;
+
+}
+
+//------------------------------------------------------------------------------
+
+int TIMCAPTURE::pulsewidth_us(void)
+{
+
+    // Reading CCRx clears its flag, so once the interrupt is on only the
+    // handler reads the registers
+    if (_pwmInput && !_irqOn) {
+        return (int)*ccr(_fallChannel);
+    }
+    return _pulsewidth;
+
+}
+
+//------------------------------------------------------------------------------
+
+int TIMCAPTURE::sinceEdge_us(void)
+{
+
+    return (uint16_t)(_tim->CNT - _fall);
+
+}
+
+//------------------------------------------------------------------------------
+
+void TIMCAPTURE::interrupt(bool on)
+{
+
+    int flag = 1 << (_pwmInput ? _fallChannel : _channel);
+
+    if (on) {
+        _tim->SR = ~flag;
+        _tim->DIER |= flag;
+    } else if (_pwmInput) {
+        _tim->DIER &= ~flag;
+    }
+    _irqOn = on || !_pwmInput;
+
+}
+
+//------------------------------------------------------------------------------
+
+bool TIMCAPTURE::irq(void)
+{
+
+    uint32_t sr = _tim->SR;
+    uint32_t flag;
+    uint16_t t;
+
+    if (_pwmInput) {
+        flag = 1 << _fallChannel;
+        if (!(sr & flag) || !(_tim->DIER & flag)) {
+            return false;
+        }
+        // The count restarted at the rising edge, so the width is also the
+        // count at the falling edge
+        _pulsewidth = (int)*ccr(_fallChannel);
+        _period = (int)*ccr(_channel);
+        _fall = (uint16_t)_pulsewidth;
+        _tim->SR = ~(flag | (flag << 8));
+        return true;
+    }
+
+    flag = 1 << _channel;
+
+    // An edge was missed, start again from the next rising edge
+    if (sr & (flag << 8)) {
+        _tim->SR = ~(flag | (flag << 8));
+        polarity(_tim, _channel, false);
+        _high = false;
+        _seen = false;
+        return false;
+    }
+
+    if (!(sr & flag)) {
+        return false;
+    }
+
+    t = (uint16_t)*ccr(_channel);
+    _tim->SR = ~flag;
+
+    if (!_high) {
+        if (_seen) {
+            _period = (uint16_t)(t - _rise);
+        }
+        _rise = t;
+        _seen = true;
+        _high = true;
+        polarity(_tim, _channel, true);
+        return false;
+    }
+
+    _pulsewidth = (uint16_t)(t - _rise);
+    _fall = t;
+    _high = false;
+    polarity(_tim, _channel, false);
+    return true;
+
+}
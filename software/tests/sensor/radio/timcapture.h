@@ -0,0 +1,114 @@
+/* @file timcapture.h
+*
+* This file contains the register level timer input capture used by
+* PwmInCapture. It only touches the TIM registers so it can run against
+* stm32_mock.h on the host.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef TIMCAPTURE_H
+#define TIMCAPTURE_H
+
+#ifdef __MBED__
+#include "mbed.h"
+#else
+#include "stm32_mock.h"
+#endif
+
+//------------------------------------------------------------------------------
+/** @brief   Measures a radio pulse with one STM32 timer capture channel.
+*   @details The timer counts microseconds. Channels 1 and 2 use PWM input
+*            mode: the rising edge resets the counter through the slave
+*            controller and latches the period, a second capture on the same
+*            input latches the falling edge, so both values are read straight
+*            from CCRx with no interrupt at all. PWM input mode needs the
+*            slave controller, so such a timer serves one channel only.
+*
+*            Channels 3 and 4 have no PWM input mode. They capture the
+*            rising edge, flip to the falling edge in the interrupt and flip
+*            back, with the edge times still latched by the hardware. Other
+*            channels of the same timer can be used the same way.
+*/
+
+class TIMCAPTURE
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /** Constructor that configures the channel and starts the timer.
+    *
+    *   @param tim      Timer register block.
+    *   @param channel  Capture channel, 1 to 4.
+    *   @param clock_hz Timer kernel clock, must be a multiple of 1 MHz.
+    */
+
+    TIMCAPTURE(TIM_TypeDef *tim, int channel, uint32_t clock_hz);
+
+    //--------------------------------------------------------------------------
+    /** Returns true if the channel runs in PWM input mode.
+    */
+
+    bool pwmInput(void) { return _pwmInput; }
+
+    //--------------------------------------------------------------------------
+    /** Reads the latest period and pulse width in microseconds.
+    */
+
+    int period_us(void);
+    int pulsewidth_us(void);
+
+    //--------------------------------------------------------------------------
+    /** Returns the microseconds from the falling edge that ended the last
+    *   pulse to now, as the timer latched it. Good for 65 ms after the edge.
+    */
+
+    int sinceEdge_us(void);
+
+    //--------------------------------------------------------------------------
+    /** Turns the capture interrupt on or off.
+    *
+    * Edge mode channels always need it. In PWM input mode it is only needed
+    * to be told about each new pulse.
+    */
+
+    void interrupt(bool on);
+
+    //--------------------------------------------------------------------------
+    /** Handles this channel's part of the timer interrupt.
+    *
+    *   @return true if a pulse ended.
+    */
+
+    bool irq(void);
+
+    //--------------------------------------------------------------------------
+    /** Returns the timer register block.
+    */
+
+    TIM_TypeDef *timer(void) { return _tim; }
+
+private:
+
+    volatile uint32_t *ccr(int channel);
+
+    TIM_TypeDef *_tim;
+    int _channel;
+    bool _pwmInput;
+
+    // Channel latching the falling edge in PWM input mode
+    int _fallChannel;
+    bool _irqOn;
+
+    // Edge mode state, written in the interrupt
+    volatile bool _high;
+    volatile bool _seen;
+    volatile uint16_t _rise;
+    volatile uint16_t _fall;
+    volatile int _period;
+    volatile int _pulsewidth;
+
+}; // end of class timcapture
+
+#endif
@@ -31,12 +31,13 @@ bool Adafruit_GPS::parse(char *nmea) {
   // do checksum check
 
   // first look if we even have one
-  if (nmea[strlen(nmea)-4] == '*') {
-    uint16_t sum = parseHex(nmea[strlen(nmea)-3]) * 16;
-    sum += parseHex(nmea[strlen(nmea)-2]);
+  size_t len = strlen(nmea);
+  if (len > 4 && nmea[len-4] == '*') {
+    uint16_t sum = parseHex(nmea[len-3]) * 16;
+    sum += parseHex(nmea[len-2]);
     
     // check checksum 
-    for (uint8_t i=1; i < (strlen(nmea)-4); i++) {
+    for (size_t i=1; i < (len-4); i++) {
       sum ^= nmea[i];
     }
     if (sum != 0) {
@@ -62,6 +63,7 @@ bool Adafruit_GPS::parse(char *nmea) {
     // parse out latitude
     p = strchr(p, ',')+1;
     latitude = atof(p);
+    latitude_fixed = coordFromNmea(p, *(strchr(p, ',')+1));
 
     p = strchr(p, ',')+1;
     if (p[0] == 'N') lat = 'N';
@@ -72,6 +74,7 @@ bool Adafruit_GPS::parse(char *nmea) {
     // parse out longitude
     p = strchr(p, ',')+1;
     longitude = atof(p);
+    longitude_fixed = coordFromNmea(p, *(strchr(p, ',')+1));
 
     p = strchr(p, ',')+1;
     if (p[0] == 'W') lon = 'W';
@@ -121,6 +124,7 @@ bool Adafruit_GPS::parse(char *nmea) {
     // parse out latitude
     p = strchr(p, ',')+1;
     latitude = atof(p);
+    latitude_fixed = coordFromNmea(p, *(strchr(p, ',')+1));
 
     p = strchr(p, ',')+1;
     if (p[0] == 'N') lat = 'N';
@@ -131,6 +135,7 @@ bool Adafruit_GPS::parse(char *nmea) {
     // parse out longitude
     p = strchr(p, ',')+1;
     longitude = atof(p);
+    longitude_fixed = coordFromNmea(p, *(strchr(p, ',')+1));
 
     p = strchr(p, ',')+1;
     if (p[0] == 'W') lon = 'W';
@@ -215,6 +220,7 @@ void Adafruit_GPS::common_init(void) {
   lat = lon = mag = 0; // char
   fix = false; // bool
   milliseconds = 0; // uint16_t
+  latitude_fixed = longitude_fixed = 0; // coord_t
   latitude = longitude = geoidheight = altitude =
     speed = angle = magvariation = HDOP = 0.0; // float
 }
@@ -10,7 +10,10 @@
 
 #include "imu.h"
 #include "Adafruit_GPS.h"
+#include "gpscfg.h"
+#include "geo.h"
 #include "QEI.h"
+#include "QEIGroup.h"
 #include "motor.h"
 #include "PwmIn.h"
 #include "PID.h"
@@ -19,26 +22,10 @@
 #define KI_ACCEL 0.0
 #define KD_ACCEL 0.0
 #define ACCEL_INTERVAL 0.028
-#define FILTER_INTERVAL 0.004
+#define IMU_RATE 100.0 // Background IMU sample rate (Hz)
+#define ACCEL_CUTOFF 8.0 // Accel low pass (Hz), under half the loop rate
 #define PULSES_TO_M 0.0000713051
 
-#define EARTH_RADIUS 6731 //miles
-
-// Converts GPS coordinates to corresponding distances between points
-// Implements the Haversine formula
-float convertGPStoDist(float lat1, float lat2, float long1, float long2) {
-    float a;
-
-    lat1 = lat1 * 3.14159/180;
-    lat2 = lat2 * 3.14159/180;
-    long1 = long1 * 3.14159/180;
-    long2 = long2 * 3.14159/180;
-
-    a = pow(sin((lat2 - lat1)/2),2) + cos(lat1)*cos(lat2)*pow(sin((long2 - long1)/2),2);
-
-    return EARTH_RADIUS*2*atan2(sqrt(a), sqrt(1-a));
-}
-
 int main()
 {
     // Debug objects
@@ -51,8 +38,12 @@ int main()
     IMU imu(IMDA, IMCL, BNO055_G_CHIP_ADDR);
     Serial gpsSer(GPTX, GPRX, 57600);
     Adafruit_GPS Gps(&gpsSer);
+    GPSCONFIG gpsCfg;
+    Timer gpsClock;
+    char gpsCmd[GPSCFG_CMD_LEN];
     QEI EncoderL(CHA1_MOD, CHB1_MOD, NC, 192, QEI::X4_ENCODING);
     QEI EncoderR(CHA2_MOD, CHB2_MOD, NC, 192, QEI::X4_ENCODING);
+    QEIGroup Encoders;
     DigitalIn button(USER_BUTTON);
 
     // Motor objects
@@ -61,7 +52,6 @@ int main()
 
     // Timer
     Timer accelTimer;
-    Timer filterTimer;
 
     // Data variables
     int pCount = 0;
@@ -71,11 +61,19 @@ int main()
 
     // Sensor variables
     int lenc, renc;
+    qei_latch_t enc;
+    enc_speed_t lvel, rvel;
     int lock = 0;
+    ENU gpsPlane;   // Origin at the first fix of the run
+    float gpsX = 0.0, gpsY = 0.0;
 
     // Creates variables of reading data types
     IMU::imu_euler_t euler;
     IMU::imu_lin_accel_t linAccel;
+    IMU::imu_data_t imuData;
+    uint32_t imuSeen = 0;
+    IMUFILTER accelFilter(IMU_RATE, ACCEL_CUTOFF, 4);
+    imu_filtered_t accelFiltered;
 
     // PID control variables
     float accelSp = 0.0;
@@ -85,7 +83,6 @@ int main()
     float motorLOutput = 0.0;
     int distance = 0;
     float xAccel = 0.0;
-    int accelRead = 0;
 
     // Trigger points
     int dist[4] = {0, 7011/2, 14024/2, 21037/2}; // pulses, [0m, 0.25m, 0.5m, 0.75m]
@@ -107,11 +104,30 @@ int main()
 	}	
     Pc.printf("FileSystem ready\r\n");
 
-    // Start GPS
-    Gps.begin(57600);
-    Gps.sendCommand(PMTK_SET_BAUD_57600);
-    Gps.sendCommand(PMTK_SET_NMEA_OUTPUT_RMCONLY);
-    Gps.sendCommand(PMTK_SET_NMEA_UPDATE_10HZ);
+    // Start GPS, every setting acknowledged, a few seconds at worst if it
+    // never answers
+    gpsClock.start();
+    gpsCfg.start(gpsClock.read_ms());
+    while (!gpsCfg.done() && !gpsCfg.failed()) {
+        while (gpsSer.readable()) {
+            Gps.read();
+        }
+        if (Gps.newNMEAreceived()) {
+            gpsCfg.sentence(Gps.lastNMEA());
+        }
+        switch (gpsCfg.step(gpsClock.read_ms(), gpsCmd, sizeof(gpsCmd))) {
+        case GPSCFG_SEND:
+            Gps.sendCommand(gpsCmd);
+            break;
+        case GPSCFG_BAUD:
+            Gps.begin(gpsCfg.baud());
+            break;
+        default:
+            break;
+        }
+    }
+    Pc.printf("GPS %s at %d baud, fix every %d ms\r\n",
+              gpsCfg.done() ? "configured" : "not answering", gpsCfg.baud(), gpsCfg.period());
     
 	//Initialize motors
 	MotorL.start(0);
@@ -125,9 +141,9 @@ int main()
 
     // Print collumn catagories
     fprintf(ofp, "Point#, timeElapsed, ");
-    fprintf(ofp, "gpsDate, gpsTime, lat, long, ");
+    fprintf(ofp, "gpsDate, gpsTime, lat e7, long e7, gpsX, gpsY, ");
     fprintf(ofp, "xAcc, yAcc, zAcc, heading, pitch, roll, ");
-    fprintf(ofp, "lEncoder, rEncoder, lMotor, rMotor\r\n");
+    fprintf(ofp, "lEncoder, rEncoder, lVel, rVel, lVelSd, rVelSd, lMotor, rMotor\r\n");
 
     // Wait for button press
     while (button)
@@ -139,19 +155,22 @@ int main()
     // Start PID
     accelPID.start();
 
-    // Start timer
+    // Encoder deltas run from here
+    Encoders.add(EncoderL);
+    Encoders.add(EncoderR);
+
+    // Start timer and background IMU reads
     accelTimer.start();
-    filterTimer.start();
+    imu.filter(&accelFilter);
+    imu.start(1/IMU_RATE);
 
     //main loop, breaks out if estop tripped
 	while(distance < dist[3] && button) {
 
-        if(filterTimer.read() > FILTER_INTERVAL){
-            filterTimer.reset();
-
-            imu.getLinAccel(&linAccel);
-            xAccel += linAccel.x/100;
-            accelRead++;
+        // Keep the newest IMU sample, never waits
+        if (imu.sample(&imuData, &imuSeen)) {
+            euler = imuData.euler;
+            linAccel = imuData.linAccel;
         }
         
         if(accelTimer.read() > ACCEL_INTERVAL){
@@ -159,25 +178,31 @@ int main()
             tElapsed += accelTimer.read();
             accelTimer.reset();
 
-            // Read data from IMU
-            imu.getEulerAng(&euler);
-            imu.getLinAccel(&linAccel);
-            xAccel += linAccel.x/100;
-            accelRead++;
-            xAccel = xAccel/accelRead;
+            // Low passed acceleration, 0 until the first sample
+            if (accelFilter.read(&accelFiltered)) {
+                xAccel = accelFiltered.x/100;
+            }
             Pc.printf("X Accel: %f\r\n", xAccel);
 
-            // Read encoder counts
-            lenc = EncoderL.getPulses();
-            renc = EncoderR.getPulses();
-            EncoderL.reset();
-            EncoderR.reset();
+            // Read encoder counts since the last loop, both at once, and
+            // speeds (pulses/sec)
+            Encoders.latch(&enc);
+            lenc = enc.delta[0];
+            renc = enc.delta[1];
+            lvel = EncoderL.getVelocity();
+            rvel = EncoderR.getVelocity();
             distance += lenc;
 
             // Read GPS data
             if (Gps.newNMEAreceived()) {
                 lock = Gps.parse(Gps.lastNMEA());
                 gpsCount = 0;
+                if (lock && Gps.fix) {
+                    if (!gpsPlane.hasOrigin()) {
+                        gpsPlane.setOrigin(Gps.latitude_fixed, Gps.longitude_fixed);
+                    }
+                    gpsPlane.toLocal(Gps.latitude_fixed, Gps.longitude_fixed, &gpsX, &gpsY);
+                }
             }
 
             // Stop PID before writing to shared variables
@@ -213,9 +238,10 @@ int main()
 
                 // Record gps data if available
                 if (lock) {
-                    fprintf(ofp, "%d/%d/%d, %d:%d:%d, %f, %f, ", Gps.month, Gps.day, Gps.year, Gps.hour, Gps.minute, Gps.seconds, Gps.latitude, Gps.longitude);
+                    fprintf(ofp, "%d/%d/%d, %d:%d:%d, %ld, %ld, ", Gps.month, Gps.day, Gps.year, Gps.hour, Gps.minute, Gps.seconds, (long)Gps.latitude_fixed, (long)Gps.longitude_fixed);
+                    fprintf(ofp, "%f, %f, ", gpsX, gpsY);
                 } else {
-                    fprintf(ofp, "NL, NL, NL, NL, ");
+                    fprintf(ofp, "NL, NL, NL, NL, NL, NL, ");
                 }
 
                 // Record data from IMU
@@ -224,14 +250,12 @@ int main()
 
                 //record encoder variables
                 fprintf(ofp, "%d, %d, ", lenc, renc);
+                fprintf(ofp, "%f, %f, %f, %f, ", lvel.rate, rvel.rate, lvel.sigma, rvel.sigma);
 
                 //record motor variables
                 fprintf(ofp, "%f, %f\r\n", motorLOutput, motorROutput); 
                 saveCount = 0;
             }
-
-            xAccel = 0.0;
-            accelRead = 0;
                 
             //Increment data point count    
             pCount++;
@@ -244,9 +268,10 @@ int main()
     MotorL.stop();
     MotorR.stop();
 
-    // Stop timer and PID
+    // Stop timer, PID and IMU reads
     accelTimer.stop();
     accelPID.stop();
+    imu.stop();
 
     //Unmount the filesystem
     fprintf(ofp,"End of Program\r\n");
@@ -0,0 +1,141 @@
+/* @file estop.cpp
+*
+* This file contains the latched e-stop that shuts the vehicle down from the
+* ESTO radio channel edge interrupt, or when that channel goes quiet.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "estop.h"
+
+//------------------------------------------------------------------------------
+
+ESTOP::ESTOP(PwmIn &in, DigitalOut &power, MCP4922 &motors, BRAKE &brake,
+             int frames):
+             _in(in), _power(power), _motors(motors), _brake(brake),
+             _frames(frames)
+{
+
+    _tripped = false;
+    _lost = false;
+    _count = 0;
+    _last = 0;
+    _glitches = 0;
+    _power_us = 0;
+    _outputs_us = 0;
+
+}
+
+//------------------------------------------------------------------------------
+
+void ESTOP::arm(void)
+{
+
+    _count = 0;
+    _last = us_ticker_read();
+    _in.attach(callback(this, &ESTOP::frame));
+    _watchdog.attach_us(callback(this, &ESTOP::watchdog), RCFILTER_PERIOD_US);
+
+}
+
+//------------------------------------------------------------------------------
+
+void ESTOP::frame(void)
+{
+
+    // Latency is timed from the edge itself, the capture and interrupt
+    // entry delay included
+    uint32_t edge = _in.edge_us();
+    int width = _in.pulsewidth_us();
+
+    if (_tripped) {
+        return;
+    }
+
+    if (width < ESTOP_VALID_MIN_US || width > ESTOP_MAX_US) {
+        _glitches++;
+        _count = 0;
+        return;
+    }
+
+    _last = edge;
+
+    if (width < ESTOP_MIN_US) {
+        _count = 0;
+        return;
+    }
+
+    if (++_count < _frames) {
+        return;
+    }
+
+    trip(edge, false);
+
+}
+
+//------------------------------------------------------------------------------
+
+void ESTOP::watchdog(void)
+{
+
+    uint32_t now = us_ticker_read();
+
+    if (!_tripped && now - _last > ESTOP_LOST_FRAMES * RCFILTER_PERIOD_US) {
+        trip(now, true);
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void ESTOP::trip(uint32_t start, bool lost)
+{
+
+    // The edge and loss interrupts can both get here, only one shuts down
+    core_util_critical_section_enter();
+    if (_tripped) {
+        core_util_critical_section_exit();
+        return;
+    }
+
+    // Contactor first, it removes drive power whatever the DACs say. The
+    // SPI and PWM calls are safe here as the build has no RTOS mutexes.
+    _power = 0;
+    _power_us = us_ticker_read() - start;
+
+    _brake.setExtend();
+    _motors.write_u16(MCP4922::DAC_A, 0);
+    _motors.write_u16(MCP4922::DAC_B, 0);
+    _outputs_us = us_ticker_read() - start;
+
+    _lost = lost;
+    _tripped = true;
+    core_util_critical_section_exit();
+
+}
+
+//------------------------------------------------------------------------------
+
+void ESTOP::getStats(estop_stats_t *s)
+{
+
+    s->trips = _tripped ? 1 : 0;
+    s->lost = _lost ? 1 : 0;
+    s->glitches = _glitches;
+    s->power_us = _power_us;
+    s->outputs_us = _outputs_us;
+
+}
+
+//------------------------------------------------------------------------------
+
+void ESTOP::report(Serial &ser)
+{
+
+    estop_stats_t s;
+
+    getStats(&s);
+    ser.printf("estop trips %lu, lost %lu, glitches %lu, power %lu us, outputs %lu us\r\n",
+               s.trips, s.lost, s.glitches, s.power_us, s.outputs_us);
+
+}
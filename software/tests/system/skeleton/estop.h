@@ -0,0 +1,123 @@
+/* @file estop.h
+*
+* This file contains the latched e-stop that shuts the vehicle down from the
+* ESTO radio channel edge interrupt, or when that channel goes quiet.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef ESTOP_H
+#define ESTOP_H
+
+#include "mbed.h"
+#include "PwmIn.h"
+#include "MCP4922.h"
+#include "brake.h"
+
+// Pulse widths that count as an e-stop command (us)
+#define ESTOP_MIN_US 1800
+#define ESTOP_MAX_US 2200
+
+// Pulse widths outside this range are glitches (us)
+#define ESTOP_VALID_MIN_US 800
+
+// Radio frames without a valid e-stop pulse before the signal counts as
+// lost and the e-stop trips, checked once a frame
+#define ESTOP_LOST_FRAMES 5
+
+//------------------------------------------------------------------------------
+/** @brief   Runs the safety shutdown from the end of the e-stop pulse.
+*   @details Once armed, every falling edge of the e-stop channel checks the
+*            new pulse width. After the configured number of consecutive
+*            frames between ESTOP_MIN_US and ESTOP_MAX_US the e-stop latches
+*            and, still in the interrupt, drops the power contactor, extends
+*            the brake and writes zero to both motor DAC channels. Pulses
+*            outside the valid range are counted as glitches and restart the
+*            count. A lost signal has no edges at all, so a Ticker also
+*            trips it once ESTOP_LOST_FRAMES frames pass without a valid
+*            pulse. Nothing clears the latch short of a reset.
+*/
+
+class ESTOP
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /* Trip statistics */
+
+    typedef struct
+    {
+        uint32_t trips;        // 1 once latched
+        uint32_t lost;         // 1 if it latched on a lost signal
+        uint32_t glitches;     // Pulses outside the valid range
+        uint32_t power_us;     // Falling edge to contactor open
+        uint32_t outputs_us;   // Falling edge to brake and DACs commanded
+    } estop_stats_t;
+
+    //--------------------------------------------------------------------------
+    /** Constructor that sets the channel and the outputs to shut down.
+    *
+    *   @param in     E-stop radio channel.
+    *   @param power  Power contactor, 0 opens it.
+    *   @param motors Motor DAC, both channels are zeroed.
+    *   @param brake  Brake actuator, extended on a trip.
+    *   @param frames Consecutive e-stop frames needed to trip.
+    */
+
+    ESTOP(PwmIn &in, DigitalOut &power, MCP4922 &motors, BRAKE &brake,
+          int frames = 2);
+
+    //--------------------------------------------------------------------------
+    /** Starts watching the e-stop channel and its loss timer.
+    */
+
+    void arm(void);
+
+    //--------------------------------------------------------------------------
+    /** Returns true once the e-stop has latched.
+    */
+
+    bool tripped(void) { return _tripped; }
+
+    //--------------------------------------------------------------------------
+    /** Reads the trip statistics.
+    *
+    *   @param s Filled with a copy of the statistics.
+    */
+
+    void getStats(estop_stats_t *s);
+
+    //--------------------------------------------------------------------------
+    /** Prints the trip statistics.
+    *
+    *   @param ser Serial port to print on.
+    */
+
+    void report(Serial &ser);
+
+private:
+
+    void frame(void);
+    void watchdog(void);
+    void trip(uint32_t start, bool lost);
+
+    PwmIn &_in;
+    DigitalOut &_power;
+    MCP4922 &_motors;
+    BRAKE &_brake;
+    int _frames;
+    Ticker _watchdog;
+
+    // Written in the edge and loss interrupts
+    volatile bool _tripped;
+    volatile bool _lost;
+    volatile int _count;
+    volatile uint32_t _last;      // Edge of the last valid pulse
+    volatile uint32_t _glitches;
+    volatile uint32_t _power_us;
+    volatile uint32_t _outputs_us;
+
+}; // end of class estop
+
+#endif
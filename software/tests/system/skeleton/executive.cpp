@@ -0,0 +1,174 @@
+/* @file executive.cpp
+*
+* This file contains a table driven rate monotonic executive that replaces the
+* busy-wait polling of the main loop.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "executive.h"
+
+//------------------------------------------------------------------------------
+
+EXECUTIVE::EXECUTIVE(const task_t *table, int count, uint32_t tick_us):
+                     _table(table), _count(count), _tick_us(tick_us)
+{
+
+    if (_count > EXEC_MAX_TASKS) {
+        error("EXECUTIVE: too many tasks\r\n");
+    }
+    if (_tick_us == 0) {
+        error("EXECUTIVE: tick must be at least 1 us\r\n");
+    }
+
+    for (int i = 0; i < _count; i++) {
+        if (_table[i].period_us < _tick_us || _table[i].period_us % _tick_us) {
+            error("EXECUTIVE: %s period is not a multiple of the tick\r\n",
+                  _table[i].name);
+        }
+        _countdown[i] = 1;
+        _release_us[i] = 0;
+        _dropped[i] = 0;
+        _ready[i] = false;
+        _stats[i].runs = 0;
+        _stats[i].overruns = 0;
+        _stats[i].maxExec_us = 0;
+        _stats[i].maxLate_us = 0;
+    }
+
+    _idle_us = 0;
+    _start_us = 0;
+
+}
+
+//------------------------------------------------------------------------------
+
+void EXECUTIVE::start(void)
+{
+
+    _start_us = us_ticker_read();
+    _ticker.attach_us(callback(this, &EXECUTIVE::tick), _tick_us);
+
+}
+
+//------------------------------------------------------------------------------
+
+void EXECUTIVE::stop(void)
+{
+
+    _ticker.detach();
+
+}
+
+//------------------------------------------------------------------------------
+
+void EXECUTIVE::tick(void)
+{
+
+    uint32_t now = us_ticker_read();
+
+    for (int i = 0; i < _count; i++) {
+        if (--_countdown[i] == 0) {
+            _countdown[i] = _table[i].period_us / _tick_us;
+
+            // Previous release never got to run, it is lost
+            if (_ready[i]) {
+                _dropped[i]++;
+            }
+
+            _release_us[i] = now;
+            _ready[i] = true;
+        }
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void EXECUTIVE::dispatch(void)
+{
+
+    int next = -1;
+    uint32_t release;
+    uint32_t begin, end;
+
+    // Interrupts stay off between the ready check and the sleep so a release
+    // cannot slip in between them; WFI still wakes on the pending interrupt.
+    __disable_irq();
+    for (int i = 0; i < _count; i++) {
+        if (_ready[i] && (next < 0 || _table[i].priority < _table[next].priority)) {
+            next = i;
+        }
+    }
+
+    if (next < 0) {
+        begin = us_ticker_read();
+        __WFI();
+        __enable_irq();
+        _idle_us += us_ticker_read() - begin;
+        return;
+    }
+
+    _ready[next] = false;
+    release = _release_us[next];
+    __enable_irq();
+
+    begin = us_ticker_read();
+    _table[next].func();
+    end = us_ticker_read();
+
+    task_stats_t *s = &_stats[next];
+    s->runs++;
+    if (end - begin > s->maxExec_us) {
+        s->maxExec_us = end - begin;
+    }
+    if (end - release > s->maxLate_us) {
+        s->maxLate_us = end - release;
+    }
+    if (end - release > _table[next].period_us) {
+        s->overruns++;
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void EXECUTIVE::getStats(int task, task_stats_t *s)
+{
+
+    *s = _stats[task];
+    s->overruns += _dropped[task];
+
+}
+
+//------------------------------------------------------------------------------
+
+void EXECUTIVE::getIdle(uint32_t *idle_us, uint32_t *total_us)
+{
+
+    *idle_us = _idle_us;
+    *total_us = us_ticker_read() - _start_us;
+
+}
+
+//------------------------------------------------------------------------------
+
+void EXECUTIVE::report(Serial &ser)
+{
+
+    task_stats_t s;
+    uint32_t idle, total;
+
+    ser.printf("task, period(us), runs, overruns, maxExec(us), maxLate(us)\r\n");
+    for (int i = 0; i < _count; i++) {
+        getStats(i, &s);
+        ser.printf("%s, %lu, %lu, %lu, %lu, %lu\r\n", _table[i].name,
+                   _table[i].period_us, s.runs, s.overruns, s.maxExec_us,
+                   s.maxLate_us);
+    }
+
+    getIdle(&idle, &total);
+    ser.printf("idle %lu of %lu us (%d%%)\r\n", idle, total,
+               total ? (int)((uint64_t)idle * 100 / total) : 0);
+
+}
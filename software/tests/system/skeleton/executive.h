@@ -0,0 +1,136 @@
+/* @file executive.h
+*
+* This file contains a table driven rate monotonic executive that replaces the
+* busy-wait polling of the main loop.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef EXECUTIVE_H
+#define EXECUTIVE_H
+
+#include "mbed.h"
+
+// Maximum number of tasks the executive will schedule
+#define EXEC_MAX_TASKS 8
+
+//------------------------------------------------------------------------------
+/** @brief   Runs a fixed table of periodic tasks from a single us_ticker based
+*            Ticker.
+*   @details The Ticker interrupt only releases tasks, the tasks themselves run
+*            from dispatch() in the main thread so a slow I2C or SPI call in one
+*            task can never corrupt another. When more than one task is ready
+*            the one with the lowest priority number runs first (give shorter
+*            periods lower numbers for rate monotonic order). A task that
+*            finishes after its next release, or is released again before it
+*            got to run, counts a deadline overrun. Time spent with no task
+*            ready is slept away and accumulated as idle time.
+*/
+
+class EXECUTIVE
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /* Task table entry */
+
+    typedef struct
+    {
+        const char *name;     // Name printed in the report
+        void (*func)(void);   // Task body, runs in thread context
+        uint32_t period_us;   // Release period, a multiple of the tick
+        uint8_t priority;     // 0 is the highest priority
+    } task_t;
+
+    //--------------------------------------------------------------------------
+    /* Per task run time statistics */
+
+    typedef struct
+    {
+        uint32_t runs;        // Number of completed runs
+        uint32_t overruns;    // Late completions plus dropped releases
+        uint32_t maxExec_us;  // Longest single execution
+        uint32_t maxLate_us;  // Longest release to completion time
+    } task_stats_t;
+
+    //--------------------------------------------------------------------------
+    /** Constructor that loads the task table.
+    *
+    *   @param table   Array of tasks, must outlive the executive.
+    *   @param count   Number of entries in table (at most EXEC_MAX_TASKS).
+    *   @param tick_us Ticker period, not 0, every task period must be a
+    *                  multiple.
+    */
+
+    EXECUTIVE(const task_t *table, int count, uint32_t tick_us);
+
+    //--------------------------------------------------------------------------
+    /** Starts the Ticker and releases every task on the first tick.
+    */
+
+    void start(void);
+
+    //--------------------------------------------------------------------------
+    /** Stops the Ticker, tasks already released are left pending.
+    */
+
+    void stop(void);
+
+    //--------------------------------------------------------------------------
+    /** Runs the highest priority ready task, or sleeps until the next
+    *   interrupt if no task is ready.
+    *
+    * Call this repeatedly from the main loop.
+    */
+
+    void dispatch(void);
+
+    //--------------------------------------------------------------------------
+    /** Reads the statistics of one task.
+    *
+    *   @param task Index of the task in the table.
+    *   @param s    Filled with a copy of the statistics.
+    */
+
+    void getStats(int task, task_stats_t *s);
+
+    //--------------------------------------------------------------------------
+    /** Reads the idle time.
+    *
+    *   @param idle_us  Time spent with no task ready since start().
+    *   @param total_us Time since start().
+    */
+
+    void getIdle(uint32_t *idle_us, uint32_t *total_us);
+
+    //--------------------------------------------------------------------------
+    /** Prints the statistics of every task and the idle fraction.
+    *
+    *   @param ser Serial port to print on.
+    */
+
+    void report(Serial &ser);
+
+private:
+
+    void tick(void);
+
+    Ticker _ticker;
+    const task_t *_table;
+    int _count;
+    uint32_t _tick_us;
+
+    // Written by tick(), read by dispatch()
+    volatile uint32_t _countdown[EXEC_MAX_TASKS];
+    volatile uint32_t _release_us[EXEC_MAX_TASKS];
+    volatile uint32_t _dropped[EXEC_MAX_TASKS];
+    volatile bool _ready[EXEC_MAX_TASKS];
+
+    task_stats_t _stats[EXEC_MAX_TASKS];
+    uint32_t _idle_us;
+    uint32_t _start_us;
+
+}; // end of class executive
+
+#endif
@@ -16,43 +16,76 @@
 #include "GPS.h"
 #include "QEI.h"
 #include "PwmIn.h"
+#include "PwmInCapture.h"
+#include "sbusrx.h"
 #include "MCP4922.h"
 #include "brake.h"
-
-// Main loop period
-#define INTERVAL 0.009
+#include "executive.h"
+#include "profiler.h"
+#include "estop.h"
+#include "snapshot.h"
+#include "rcmap.h"
+
+// Executive tick and task periods (us)
+#define TICK_PERIOD  5000
+#define BRAKE_PERIOD 5000   // 200 Hz
+#define IMU_PERIOD   10000  // 100 Hz
+#define RADIO_PERIOD 20000  // 50 Hz, one radio frame
+#define GPS_PERIOD   100000 // 10 Hz
+#define LOG_PERIOD   200000 // 5 Hz
+
+// Lowest throttle and steering quality (%) the motors run on
+#define RADIO_QUALITY 50
+
+// Uncomment to take the radio from an SBUS receiver on SBRX instead of the
+// five PWM pins, channels numbered from 0 in the receiver's order (AETR)
+// #define RADIO_SBUS
+#define SBUS_LRIN 0
+#define SBUS_BRAK 1
+#define SBUS_THRO 2
+#define SBUS_MODE 4
+#define SBUS_ESTO 5
+
+// Brake travel limits and deadband on the read_u16() scale
+#define BRAKE_MIN  10486    // 0.16
+#define BRAKE_MAX  53739    // 0.82
+#define BRAKE_BAND 3277     // 0.05
+
+// Core clock the DWT cycle counter runs at
+#define CPU_HZ 180000000
 // #define ENC_PPR 2048
 // #define GEAR_RATIO 0.244444
 // #define WHEEL_SIZE 0.833333
 
-// /*********************/
-// /** Data Structures **/
-
-// typedef struct Buffer{
-//     int b_time = 0;
-//     int b_estop = 0;
-//     float b_break = 0;
-//     float b_A_heading = 0;
-//     float b_V_heading = 0;
-//     float b_accel = 0;
-//     float b_vel = 0;
-//     int   b_encoderAv = 0;    
-//     int b_waypoint = 0;
-// } Buffer;
+/*********************/
+/** Data Structures **/
+
+// Latest sensor frame, published from the edge interrupts
+typedef struct Buffer{
+    uint32_t b_time;      // us_ticker time of the newest pulse
+    int32_t b_throt;      // Filtered radio pulse widths (us)
+    int32_t b_lr;
+    int32_t b_mode;
+    int32_t b_break;
+    // float b_A_heading;
+    // float b_V_heading;
+    // float b_accel;
+    // float b_vel;
+    // int   b_encoderAv;
+    // int b_waypoint;
+} Buffer;
 
 /******************************/
 /** Data Retriving Functions **/
 
-// // Retreives encoder readings and converts them to ft/s
+// // Retreives encoder speeds from the edge times and converts them to ft/s
 // void sc_encoders(QEI &encoderL, QEI &encoderR, float *encReading) {
-//     encReading[0] = encoderL.getPulses();
-//     encReading[1] = encoderR.getPulses();
+//     encReading[0] = encoderL.getVelocity().rate;
+//     encReading[1] = encoderR.getVelocity().rate;
 //     encReading[2] = (encReading[0] + encReading[1])/2;
-//     encoderL.reset();
-//     encoderR.reset();
 
 //     for (int i = 0; i < 3; i += 1){
-//         encReading[i] = ((encReading[i]/ENC_PPR)*GEAR_RATIO*WHEEL_SIZE)/INTERVAL;
+//         encReading[i] = (encReading[i]/ENC_PPR)*GEAR_RATIO*WHEEL_SIZE;
 //     }
 // }
 
@@ -98,93 +131,236 @@
 // 	return 0;
 // }
 
-//Function allows driving by RC controler
-int modeRC(float throtle, float lrat, float brake, float *mr, float *ml, float *bA) {
+/*********************/
+/** Vehicle Objects **/
+
+/* Test Objects */
+Serial Pc(USBTX,USBRX);
+
+// /* file system objects */
+// SDFileSystem sd(DI, DO, CLK, CS, "sd");
+
+// /* Encoder Objects */
+// QEI EncoderL(CHA1, CHB1, NC, 2048, QEI::X4_ENCODING);
+// QEI EncoderR(CHA2, CHB2, NC, 2048, QEI::X4_ENCODING);
+// float encReading[3];
+
+// /* IMU Objects */
+// IMU Imu(IMDA, IMCL, BNO055_G_CHIP_ADDR);
+// IMU::imu_euler_t euler;
+// IMU::imu_lin_accel_t linAccel;
+
+// /* GPS Objects */
+// GPS Gps(GPTX, GPRX);
+// int lock = 0;
+
+#ifdef RADIO_SBUS
+/* Radio Objects, all channels from one SBUS frame */
+SBUSRX Radio(SBRX);
+PwmIn &Throt = Radio.channel(SBUS_THRO);
+PwmIn &Lr = Radio.channel(SBUS_LRIN);
+PwmIn &Mode = Radio.channel(SBUS_MODE);
+PwmIn &E_Stop = Radio.channel(SBUS_ESTO);
+PwmIn &Brake = Radio.channel(SBUS_BRAK);
+#else
+/* Radio Objects, timer capture where the pin has a free channel */
+PwmInCapture Throt(THRO);
+PwmInCapture Lr(LRIN);
+PwmIn Mode(MODE);
+PwmInCapture E_Stop(ESTO);
+PwmIn Brake(BRAK);
+#endif
+
+// Main contactor, off until the user GO
+DigitalOut Power(PC_4, 0);
+
+/* Motor Objects */
+MCP4922 motors(MOSI2, SCLK2, CSM1, 1000000);
+const MCP4922::MCPDAC motor_left = MCP4922::DAC_B;
+const MCP4922::MCPDAC motor_righ = MCP4922::DAC_A;
+
+/* Brake Objects */
+BRAKE brakeAct(LPWM,RPWM,BRAKE_EN,BRAKE_POS);
+
+// Latched e-stop, shuts down from the ESTO edge interrupt or on a lost ESTO
+// signal once armed
+ESTOP Safety(E_Stop, Power, motors, brakeAct);
+
+/* Sensor Frame */
+const Buffer frameInit = {0, 0, 0, 0, 0};
+SNAPSHOT<Buffer> frame(frameInit);
+
+// Publishes one radio channel into the frame at the end of its pulse
+void publishPulse(PwmIn &in, int32_t Buffer::*field) {
+    Buffer *b = frame.begin();
+    b->*field = in.filtered_us();
+    b->b_time = us_ticker_read();
+    frame.commit();
+}
 
-	throtle *= 1000000;
-	throtle -= 1100;
-	throtle /= 8;
-	
-	lrat *= 1000000;
-	lrat -= 1000;
-	lrat /= 5000;
+void throtPulse(void) { publishPulse(Throt, &Buffer::b_throt); }
+void lrPulse(void) { publishPulse(Lr, &Buffer::b_lr); }
+void modePulse(void) { publishPulse(Mode, &Buffer::b_mode); }
+void brakePulse(void) { publishPulse(Brake, &Buffer::b_break); }
 
-    brake *= 1000000;
-    brake -= 1500;
-    brake /= 500;
+/********************/
+/** Loop Variables **/
 
-    if (brake < 0){
-        brake *= -1;
-    }
+//radio variables
+Buffer rc = frameInit;
+uint32_t rcSeen = 0;
+int32_t throtle = 0, leftright = 0, mode = 0, brake = 0;
+float estop = 0.0;
 
-	*ml = ((1 - lrat)* throtle) / 100;
-	*mr = (lrat * throtle) / 100;
-    *bA = brake;
+//motor variables, MCP4922 codes
+uint16_t mr = 0, ml = 0;
 
-    if (*ml < 0.01)
-        *ml = 0;
-    if (*mr < 0.01)
-        *mr = 0;
+// Brake variables, read_u16() scale
+uint32_t bA = 0;
+uint16_t brakePos = 0;
 
+// Most important variable
+volatile int stop = 0;
+int stopCount = 0;
 
-	return 0;
-}
+// Data point count
+int pCount = 0;
 
-int main()
-{
-    // /* Test Objects */
-    Serial Pc(USBTX,USBRX);
-    Pc.printf("Started program\r\n");
-    // // /* file system objects */
-    // // SDFileSystem sd(DI, DO, CLK, CS, "sd");
+// Stage profiler, send 'p' on the serial port to dump it
+PROFILER prof(PROFILER::dwtCycles, CPU_HZ);
+int profRadio, profPulse, profModeRC, profDac, profBrakePos;
 
-    // // /* IMU objects */
-    // // IMU imu(I2C_SDA, I2C_SCL, BNO055_G_CHIP_ADDR);
+/***********/
+/** Tasks **/
 
-    /* Timer Objects */
-    Timer timer;
+// Prints the filter counters of one radio channel
+void reportRadio(const char *name, PwmIn &in) {
+    rcfilter_stats_t s;
+    in.getStats(&s);
+    Pc.printf("%s: %lu frames, %lu rejected, %lu missing, quality %d%%\r\n",
+              name, s.frames, s.rejected, s.missing, in.quality());
+}
 
-    // /* Encoder Objects */
-    // QEI EncoderL(CHA1, CHB1, NC, 2048, QEI::X4_ENCODING);
-    // QEI EncoderR(CHA2, CHB2, NC, 2048, QEI::X4_ENCODING);
-    // float encReading[3];
+// Bang-bang brake servo towards the radio brake command
+void brakeTask(void) {
+    if (bA > BRAKE_MAX) {
+        bA = BRAKE_MAX;
+    }
+    if (bA < BRAKE_MIN) {
+        bA = BRAKE_MIN;
+    }
 
-    // /* IMU Objects */
-    // IMU Imu(IMDA, IMCL, BNO055_G_CHIP_ADDR);
+    {
+        PROF_SCOPE scope(prof, profBrakePos);
+        brakePos = brakeAct.getPosition_u16();
+    }
 
-    // /* GPS Objects */
-    // GPS Gps(GPTX, GPRX);
+    // The e-stop interrupt must not land between the check and the command
+    core_util_critical_section_enter();
+    if (Safety.tripped()) {
+        // Leave the brake extending
+    } else if ((int32_t)bA < brakePos - BRAKE_BAND){
+        brakeAct.setRetract();
+    } else if((int32_t)bA > brakePos + BRAKE_BAND){
+        brakeAct.setExtend();
+    }
+    else {
+        brakeAct.setStop();
+    }
+    core_util_critical_section_exit();
+}
 
-    /* Radio Objects */
-    PwmIn Throt(THRO);
-    PwmIn Lr(LRIN);
-    PwmIn Mode(MODE);
-    PwmIn E_Stop(ESTO);
-    PwmIn Brake(BRAK);
+// // Reads the IMU
+// void imuTask(void) {
+//     sc_imu(Imu, &euler, &linAccel);
+// }
 
-    // Main contactor
-    DigitalOut Power(PC_4);
-    Power = 0;
+// Updates the motor outputs from the filtered radio frame
+void radioTask(void) {
+    prof.mark(profRadio);
+    {
+        PROF_SCOPE scope(prof, profPulse);
+        frame.read(&rc, &rcSeen);
+    }
+    throtle = rc.b_throt;
+    leftright = rc.b_lr;
+    brake = rc.b_break;
+    mode = rc.b_mode;
+
+    {
+        PROF_SCOPE scope(prof, profModeRC);
+        // Coast when throttle or steering drops out, brake fully when the
+        // brake channel does
+        if (Throt.stale() || Lr.stale() ||
+            Throt.quality() < RADIO_QUALITY || Lr.quality() < RADIO_QUALITY) {
+            ml = 0;
+            mr = 0;
+        } else {
+            rcMotors(throtle, leftright, 1, &ml, &mr);
+        }
+        bA = Brake.stale() ? BRAKE_MAX : rcBrake(brake, 1);
+    }
 
-    // Map mp;
-    // mp.nw.init = 0;
-    // mp.ne.init = 0;
-    // mp.sw.init = 0;
-    // mp.se.init = 0;
+    {
+        PROF_SCOPE scope(prof, profDac);
+        core_util_critical_section_enter();
+        if (!Safety.tripped()) {
+            motors.write_u16(motor_left, ml << 4);
+            motors.write_u16(motor_righ, mr << 4);
+        }
+        core_util_critical_section_exit();
+    }
+}
+
+// // Parses what the GPS sent since the last run, never waits on the UART
+// void gpsTask(void) {
+//     int r = Gps.poll();
+//     if (r >= 0) {
+//         lock = r;
+//     }
+// }
 
-    // float pCount = 0;
-    // int saveCount = 0;
+// Records data and decisions
+void logTask(void) {
+    // ///////////////////////////Record data and decisions to file
+    // //record map relevent data (not currently used)
+    // fprintf(ofp, "%d, %d, %d, ", pCount, 0, 0);
+    // //record radio values
+    // fprintf(ofp, "%f, %f, %f, %f, ", throtle, leftright, estop, mode);
+    // //record gps data if available
+    // if (lock) {
+    //     fprintf(ofp, "%f, %ld, %ld, %d, ", Gps.time, (long)Gps.data.lat,
+    //         (long)Gps.data.lon, Gps.satellites);
+    // } else {
+    //     fprintf(ofp, "NL, NL, NL, NL, ");
+    // }
+    // //record data from IMU
+    // fprintf(ofp, "%f, %f, %f, ", linAccel.x, linAccel.y, linAccel.z);
+    // fprintf(ofp, "%f, %f, %f, ", euler.heading, euler.pitch, euler.roll);
+    // //record motor variables
+    // fprintf(ofp, "%f, %f\r\n", ml, mr);
+    pCount++;
+
+    if (Pc.readable() && Pc.getc() == 'p') {
+        prof.dump(stdout);
+    }
+}
 
-    //radio variables
-    float throtle, leftright, mode, estop, brake;
-    throtle = 0.0; leftright = 0.0; mode = 0.0; estop = 0.0; brake = 0.0;
+// Task table, lower priority number runs first when several are ready
+const EXECUTIVE::task_t tasks[] = {
+    // name     function    period (us)     priority
+    {"brake",   brakeTask,  BRAKE_PERIOD,   0},
+    // {"imu",     imuTask,    IMU_PERIOD,     2},
+    {"radio",   radioTask,  RADIO_PERIOD,   3},
+    // {"gps",     gpsTask,    GPS_PERIOD,     4},
+    {"log",     logTask,    LOG_PERIOD,     5},
+};
 
-    //motor variables
-    float mr, ml;
-    MCP4922 motors(MOSI2, SCLK2, CSM1, 100000);
-    MCP4922::MCPDAC motor_left, motor_righ;
-    motor_left = MCP4922::DAC_B;
-    motor_righ = MCP4922::DAC_A;
+EXECUTIVE exec(tasks, sizeof(tasks) / sizeof(tasks[0]), TICK_PERIOD);
+
+int main()
+{
+    Pc.printf("Started program\r\n");
 
     motors.referenceMode(motor_left, MCP4922::REF_UNBUFFERED);
     motors.gainMode(motor_left, MCP4922::GAIN_1X);
@@ -197,26 +373,8 @@ int main()
     motors.write(motor_left, 0.0);
     motors.write(motor_righ, 0.0);
 
-    // Brake variables
-    float bA, brakePos;
-    bA = 0.0; brakePos = 0.0;
-    BRAKE brakeAct(LPWM,RPWM,BRAKE_EN,BRAKE_POS);
     brakeAct.setPosition(0.8);
 
-    // Most important variable
-    int stop = 0;
-    int stopCount = 0;
-
-    //encoder variables
-    // int lenc, renc;
-
-    //gps variables
-    // int lock = 0;
-
-    // // Creates variables of reading data types
-    // IMU::imu_euler_t euler;
-    // IMU::imu_lin_accel_t linAccel;
-	
     //Mount the filesystem
     // Pc.printf("Mounting SD card\r\n");
     // sd.mount();
@@ -276,109 +434,36 @@ int main()
     // Pc.printf("User GO accepted starting run\r\n");
     // fprintf(ofp, "Point#, nearest waypoint, next waypoint, ");
     // fprintf(ofp, "rcThrot, rcDir, rcE-stop, rcMode, ");
-    // fprintf(ofp, "time, lat, long, #sat, ");
+    // fprintf(ofp, "time, lat e7, long e7, #sat, ");
     // fprintf(ofp, "xAcc, yAcc, zAcc, heading, pitch, roll, ");
     // fprintf(ofp, "lEncoder, rEncoder, lMotor, rMotor\r\n");
     
+    // //GPS sentences arrive by DMA from here, gpsTask parses them and
+    // //finishes setting up the receiver
+    // Gps.startDMA();
+    // Gps.configure();
+
+    PROFILER::enableDwt();
+    profRadio = prof.stage("radio period");
+    profPulse = prof.stage("frame read");
+    profModeRC = prof.stage("rcMotors");
+    profDac = prof.stage("MCP4922 write");
+    profBrakePos = prof.stage("brake getPosition");
+
+    Throt.attach(callback(throtPulse));
+    Lr.attach(callback(lrPulse));
+    Mode.attach(callback(modePulse));
+    Brake.attach(callback(brakePulse));
+
     Power = 1;
-    timer.start();
+    Safety.arm();
+    exec.start();
     //main loop, breaks out if estop tripped
-	while(!stop) {
-
-        if (timer.read() > INTERVAL) {
-            timer.reset();
-
-            ////////////////////////////Gather Data
-            //get radio values
-            throtle += Throt.pulsewidth();
-            leftright += Lr.pulsewidth();
-            brake += Brake.pulsewidth();
-
-            estop = E_Stop.pulsewidth();
-            mode = Mode.pulsewidth();
-            // Pc.printf("E-Stop Value = %f\r\n", estop);
-            //Read data from IMU
-            // imu.getEulerAng(&euler);
-            // imu.getLinAccel(&linAccel);
-            // //get encoder data and reset encoders
-            // sc_encoders(EncoderL, EncoderR, encReading);
-            // lenc = EncoderL.getPulses();
-            // renc = EncoderR.getPulses();
-            // EncoderL.reset();
-            // EncoderR.reset();
-
-            if (setCount >= 3){
-                throtle /= 3;
-                leftright /= 3;
-                brake /= 3;
-                modeRC(throtle, leftright, brake, &mr, &ml, &bA);
-                throtle = Throt.pulsewidth();
-                leftright = Lr.pulsewidth();
-                brake = Brake.pulsewidth();
-            }
-
-            // if (saveCount > 19) {
-            //     ///////////////////////////Record data and decisions to file
-            //     //record map relevent data (not currently used)   
-            //     fprintf(ofp, "%d, %d, %d, ", pCount*INTERVAL, 0, 0); 
-            //     //record radio values
-            //     fprintf(ofp, "%f, %f, %f, %f, ", throtle, leftright, estop, mode);
-            //     //record gps data if available
-            //     if (lock) {
-            //         fprintf(ofp, "%f, %f, %f, %d, ", Gps.time, Gps.latitude,
-            //             Gps.longitude, Gps.satellites);
-            //     } else {
-            //         fprintf(ofp, "NL, NL, NL, NL, ");
-            //     }
-            //     //record data from IMU
-            //     fprintf(ofp, "%f, %f, %f, ", linAccel.x, linAccel.y, linAccel.z);
-            //     fprintf(ofp, "%f, %f, %f, ", euler.heading, euler.pitch, euler.roll);
-            //     //record encoder data
-            //     fprintf(ofp, "%d, %d, ", encReading[0], encReading[1]);
-            //     //record motor variables
-            //     fprintf(ofp, "%d, %d\r\n", ml, mr); 
-            //     saveCount = 0;
-            // }
-
-            motors.write(motor_left, ml);
-            motors.write(motor_righ, mr);
-            if (bA > 0.82) {
-                bA = 0.82;
-            }
-            if (bA < 0.16) {
-                bA = 0.16;
-            }
-
-            brakePos = brakeAct.getPosition();
-            if (bA < brakePos - 0.05){
-                brakeAct.setRetract();
-            } else if(bA > brakePos + 0.05){
-                brakeAct.setExtend();
-            }
-            else {
-                brakeAct.setStop();
-            }
-                
-            // ////////////////////////////end of loop cleanup and multiloop funcs    
-            // //Increment data point count    
-            // pCount++;
-            // saveCount++;
-
-            if ((estop * 1000000) > 1800 && stopCount < 3){
-                stopCount++;
-            }
-            else if ((estop * 1000000) > 1800 && stopCount >= 3) {
-                stop = 1;
-                stopCount = 0;
-                Pc.printf("E-Stop engaged\r\n");
-            }
-            else {
-                stopCount = 0;
-            }
-        }
-
+	while(!Safety.tripped()) {
+        exec.dispatch();
     }
-
+    exec.stop();
+    Pc.printf("E-Stop engaged\r\n");
 
     //power down motors
     motors.write(motor_left, 0);
@@ -387,7 +472,15 @@ int main()
     Pc.printf("Program exiting\r\n");
     
     Power = 0;
-    timer.stop();
+    exec.report(Pc);
+    Safety.report(Pc);
+    reportRadio("THRO", Throt);
+    reportRadio("LRIN", Lr);
+    reportRadio("BRAK", Brake);
+#ifdef RADIO_SBUS
+    Radio.report(Pc);
+#endif
+    prof.dump(stdout);
     // //Unmount the filesystem
     // fprintf(ofp,"End of Program\r\n");
     // fclose(ofp);
@@ -639,7 +732,7 @@ int main()
 //             lr = Lr.pulsewidth();
 //             // Read data from IMU
 //             sc_imu(imu, &euler, &linAccel);
-//             // Get encoder data and reset encoders
+//             // Get encoder speeds
 //             sc_encoders(encoderL, encoderR, encReading);
 //             modeRC(throt, lr, &mr, &ml);
 
@@ -1,13 +1,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "geo.h"
 #define MAX_BUFF 200
 
 /* map structure */
 typedef struct Point {
     float time;
-    float lat; //need to change to GPS relevent values
-    float lon;
+    coord_t lat; //1e-7 deg, as the GPS decodes it
+    coord_t lon;
     float vel; //need to change to imu relevent values
     float velAng;
     float accel;
@@ -42,6 +43,11 @@ int readPoint(char *line, Map *mp);
 //-4 on error parsing a point
 //-5 on error parsing whole line
 int readMap(FILE *fp, Map *mp);
+//returns 0 on success
+//-1 if a north corner is south of a south corner
+//-2 if a west corner is east of an east corner
+//-3 if a point is missing
+//-4 if a point is outside the bounds
 int checkMap(Map *mp);
 
 
@@ -0,0 +1,103 @@
+/* @file profdev.cpp
+*
+* Host test of the profiler histograms using a fake cycle source.
+*
+* g++ -o profdev profdev.cpp profiler.cpp && ./profdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "profiler.h"
+
+static uint32_t fakeCycles = 0;
+static int failed = 0;
+
+uint32_t fakeSource(void) {
+    return fakeCycles;
+}
+
+void check(const char *what, uint32_t got, uint32_t lo, uint32_t hi) {
+    if (got < lo || got > hi) {
+        printf("FAIL %s: %lu not in [%lu, %lu]\n", what, (unsigned long)got,
+               (unsigned long)lo, (unsigned long)hi);
+        failed++;
+    }
+}
+
+int main() {
+    PROFILER prof(fakeSource, 180000000);
+    int flat, loop, big, scope;
+
+    flat = prof.stage("flat");
+    loop = prof.stage("loop");
+    big = prof.stage("big");
+    scope = prof.stage("scope");
+
+    // Every bin edge must map back into its own bin
+    for (int b = 0; b < PROF_BINS; b++) {
+        check("binOf(binFloor)", PROFILER::binOf(PROFILER::binFloor(b)), b, b);
+    }
+    for (uint32_t v = 1; v < 100000; v++) {
+        int b = PROFILER::binOf(v);
+        check("binFloor <= v", PROFILER::binFloor(b), 0, v);
+        if (b < PROF_BINS - 1) {
+            check("v < next floor", v, 0, PROFILER::binFloor(b + 1) - 1);
+        }
+    }
+
+    // Uniform 1000..1999 cycles, percentiles within one bin (25%)
+    for (uint32_t v = 1000; v < 2000; v++) {
+        prof.record(flat, v);
+    }
+    check("flat count", prof.get(flat)->count, 1000, 1000);
+    check("flat min", prof.get(flat)->min, 1000, 1000);
+    check("flat max", prof.get(flat)->max, 1999, 1999);
+    check("flat p50", prof.percentile(flat, 50), 1500, 1875);
+    check("flat p90", prof.percentile(flat, 90), 1900, 1999);
+    check("flat p100", prof.percentile(flat, 100), 1999, 1999);
+
+    // Loop period of 9 ms at 180 MHz with a 1% late pass, across a wrap
+    fakeCycles = 0xFFFFFFFF - 5 * 1620000;
+    for (int i = 0; i < 1000; i++) {
+        prof.mark(loop);
+        fakeCycles += (i % 100 == 99) ? 1800000 : 1620000;
+    }
+    check("loop count", prof.get(loop)->count, 999, 999);
+    check("loop min", prof.get(loop)->min, 1620000, 1620000);
+    check("loop max", prof.get(loop)->max, 1800000, 1800000);
+    check("loop p50", prof.percentile(loop, 50), 1620000, 1620000 * 5 / 4);
+    check("loop p99", prof.percentile(loop, 99), 1620000, 1620000 * 5 / 4);
+    check("loop p100", prof.percentile(loop, 100), 1800000, 1800000);
+
+    // Saturating counts halve the histogram instead of wrapping
+    for (uint32_t i = 0; i < 200000; i++) {
+        prof.record(big, (i & 1) ? 100 : 10000);
+    }
+    check("big count", prof.get(big)->count, 200000, 200000);
+    check("big p25", prof.percentile(big, 25), 100, 127);
+    check("big p75", prof.percentile(big, 75), 10000, 12287);
+
+    // Scope records the cycles spent inside it
+    {
+        PROF_SCOPE s(prof, scope);
+        fakeCycles += 360;
+    }
+    check("scope max", prof.get(scope)->max, 360, 360);
+
+    prof.record(-1, 5);
+    prof.record(PROF_MAX_STAGES, 5);
+
+    prof.dump(stdout);
+
+    prof.reset();
+    check("reset count", prof.get(flat)->count, 0, 0);
+    check("reset p50", prof.percentile(flat, 50), 0, 0);
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
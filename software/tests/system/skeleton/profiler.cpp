@@ -0,0 +1,238 @@
+/* @file profiler.cpp
+*
+* This file contains the loop stage profiler. Stages are timed with the
+* Cortex-M4 DWT cycle counter and binned into fixed size histograms.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "profiler.h"
+
+#ifdef __MBED__
+#include "mbed.h"
+#endif
+
+//------------------------------------------------------------------------------
+
+PROFILER::PROFILER(uint32_t (*cycles)(void), uint32_t hz):
+                   _cycles(cycles), _hz(hz), _count(0)
+{
+
+    reset();
+
+}
+
+//------------------------------------------------------------------------------
+
+int PROFILER::stage(const char *name)
+{
+
+    if (_count >= PROF_MAX_STAGES) {
+        return -1;
+    }
+
+    _stages[_count].name = name;
+    return _count++;
+
+}
+
+//------------------------------------------------------------------------------
+
+int PROFILER::binOf(uint32_t cycles)
+{
+
+    const int sub = 1 << PROF_SUB_BITS;
+    int e = 31;
+    int bin;
+
+    // Below one full octave every count has its own bin
+    if (cycles < (uint32_t)sub) {
+        return (int)cycles;
+    }
+
+    while (!(cycles & (1UL << e))) {
+        e--;
+    }
+
+    // Octave picks the bin group, the bits under the leading one the bin
+    bin = ((e - PROF_SUB_BITS + 1) << PROF_SUB_BITS) |
+          (int)((cycles >> (e - PROF_SUB_BITS)) & (sub - 1));
+
+    return bin < PROF_BINS ? bin : PROF_BINS - 1;
+
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t PROFILER::binFloor(int bin)
+{
+
+    const int sub = 1 << PROF_SUB_BITS;
+    int e;
+
+    if (bin < sub) {
+        return (uint32_t)bin;
+    }
+
+    e = (bin >> PROF_SUB_BITS) + PROF_SUB_BITS - 1;
+    return (uint32_t)(sub | (bin & (sub - 1))) << (e - PROF_SUB_BITS);
+
+}
+
+//------------------------------------------------------------------------------
+
+void PROFILER::record(int id, uint32_t cycles)
+{
+
+    stage_t *s;
+    int bin;
+
+    if (id < 0 || id >= _count) {
+        return;
+    }
+
+    s = &_stages[id];
+    bin = binOf(cycles);
+
+    // Halve the whole histogram rather than let one bin saturate
+    if (s->bins[bin] == 0xFFFF) {
+        for (int i = 0; i < PROF_BINS; i++) {
+            s->bins[i] >>= 1;
+        }
+    }
+    s->bins[bin]++;
+
+    if (s->count == 0 || cycles < s->min) {
+        s->min = cycles;
+    }
+    if (cycles > s->max) {
+        s->max = cycles;
+    }
+    s->count++;
+
+}
+
+//------------------------------------------------------------------------------
+
+void PROFILER::mark(int id)
+{
+
+    uint32_t t = _cycles();
+
+    if (id < 0 || id >= _count) {
+        return;
+    }
+
+    if (_stages[id].last != 0) {
+        record(id, t - _stages[id].last);
+    }
+
+    // Zero is reserved for "no mark yet"
+    _stages[id].last = t ? t : 1;
+
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t PROFILER::percentile(int id, int pct)
+{
+
+    const stage_t *s = &_stages[id];
+    uint32_t total = 0;
+    uint32_t want, sum = 0;
+    uint32_t top;
+
+    for (int i = 0; i < PROF_BINS; i++) {
+        total += s->bins[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the sample wanted, rounded up so 100 gives the last sample
+    want = (total * (uint32_t)pct + 99) / 100;
+    if (want == 0) {
+        want = 1;
+    }
+
+    for (int i = 0; i < PROF_BINS; i++) {
+        sum += s->bins[i];
+        if (sum >= want) {
+            top = (i == PROF_BINS - 1) ? s->max : binFloor(i + 1) - 1;
+            if (top > s->max) {
+                top = s->max;
+            }
+            if (top < s->min) {
+                top = s->min;
+            }
+            return top;
+        }
+    }
+
+    return s->max;
+
+}
+
+//------------------------------------------------------------------------------
+
+void PROFILER::reset(void)
+{
+
+    for (int i = 0; i < PROF_MAX_STAGES; i++) {
+        _stages[i].count = 0;
+        _stages[i].min = 0;
+        _stages[i].max = 0;
+        _stages[i].last = 0;
+        for (int j = 0; j < PROF_BINS; j++) {
+            _stages[i].bins[j] = 0;
+        }
+    }
+
+}
+
+//------------------------------------------------------------------------------
+
+void PROFILER::dump(FILE *fp)
+{
+
+    // Cycles to hundredths of a microsecond
+    const uint32_t perUs = _hz / 1000000 ? _hz / 1000000 : 1;
+
+    fprintf(fp, "stage, count, min(us), p50(us), p90(us), p99(us), max(us)\r\n");
+    for (int i = 0; i < _count; i++) {
+        const stage_t *s = &_stages[i];
+        uint32_t v[5] = {s->min, percentile(i, 50), percentile(i, 90),
+                         percentile(i, 99), s->max};
+
+        fprintf(fp, "%s, %lu", s->name, (unsigned long)s->count);
+        for (int j = 0; j < 5; j++) {
+            uint32_t cus = (uint32_t)((uint64_t)v[j] * 100 / perUs);
+            fprintf(fp, ", %lu.%02lu", (unsigned long)(cus / 100),
+                    (unsigned long)(cus % 100));
+        }
+        fprintf(fp, "\r\n");
+    }
+
+}
+
+#ifdef __MBED__
+//------------------------------------------------------------------------------
+
+uint32_t PROFILER::dwtCycles(void)
+{
+
+    return DWT->CYCCNT;
+
+}
+
+//------------------------------------------------------------------------------
+
+void PROFILER::enableDwt(void)
+{
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+}
+#endif
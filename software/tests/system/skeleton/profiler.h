@@ -0,0 +1,183 @@
+/* @file profiler.h
+*
+* This file contains the loop stage profiler. Stages are timed with the
+* Cortex-M4 DWT cycle counter and binned into fixed size histograms.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Maximum number of named stages
+#define PROF_MAX_STAGES 12
+
+// Histogram bins per octave are 1 << PROF_SUB_BITS
+#define PROF_SUB_BITS 2
+
+// Bins per stage, the last bin also holds everything above 2^25 cycles
+#define PROF_BINS 96
+
+//------------------------------------------------------------------------------
+/** @brief   Per stage min/max/percentile histograms in fixed RAM.
+*   @details Each stage keeps a log-linear histogram of cycle counts with four
+*            bins per octave, so a percentile is known to within 25% of its
+*            value whatever the scale. Counts are 16 bit; when one would
+*            overflow every bin of that stage is halved, which keeps the shape
+*            of the distribution. The cycle source is a plain function so the
+*            host build can supply a fake one.
+*/
+
+class PROFILER
+{
+
+public:
+
+    //--------------------------------------------------------------------------
+    /* Stage data */
+
+    typedef struct
+    {
+        const char *name;
+        uint32_t count;       // Samples recorded
+        uint32_t min;         // Shortest sample in cycles
+        uint32_t max;         // Longest sample in cycles
+        uint32_t last;        // Cycle count of the previous mark()
+        uint16_t bins[PROF_BINS];
+    } stage_t;
+
+    //--------------------------------------------------------------------------
+    /** Constructor that sets the cycle source.
+    *
+    *   @param cycles Function returning a free running 32 bit cycle count.
+    *   @param hz     Rate of the cycle count, used to print microseconds.
+    */
+
+    PROFILER(uint32_t (*cycles)(void), uint32_t hz);
+
+    //--------------------------------------------------------------------------
+    /** Adds a named stage.
+    *
+    *   @param name Name printed by dump(), must outlive the profiler.
+    *   @return Stage id, or -1 if PROF_MAX_STAGES are already in use.
+    */
+
+    int stage(const char *name);
+
+    //--------------------------------------------------------------------------
+    /** Reads the cycle source.
+    */
+
+    uint32_t now(void) { return _cycles(); }
+
+    //--------------------------------------------------------------------------
+    /** Records one sample.
+    *
+    *   @param id     Stage id from stage().
+    *   @param cycles Length of the sample in cycles.
+    */
+
+    void record(int id, uint32_t cycles);
+
+    //--------------------------------------------------------------------------
+    /** Records the time since the previous mark of the same stage.
+    *
+    * Call once per loop pass to build a histogram of the loop period, whose
+    * spread is the loop jitter. The first mark only sets the reference.
+    *
+    *   @param id Stage id from stage().
+    */
+
+    void mark(int id);
+
+    //--------------------------------------------------------------------------
+    /** Estimates a percentile of one stage.
+    *
+    *   @param id  Stage id from stage().
+    *   @param pct Percentile, 0 to 100.
+    *   @return Upper edge of the histogram bin holding the percentile, in
+    *           cycles, never more than the largest sample.
+    */
+
+    uint32_t percentile(int id, int pct);
+
+    //--------------------------------------------------------------------------
+    /** Returns a stage for inspection.
+    */
+
+    const stage_t *get(int id) { return &_stages[id]; }
+
+    //--------------------------------------------------------------------------
+    /** Clears the samples of every stage, the stages stay registered.
+    */
+
+    void reset(void);
+
+    //--------------------------------------------------------------------------
+    /** Prints count, min, median, 90th, 99th percentile and max of every
+    *   stage in microseconds.
+    *
+    *   @param fp Open file or stdout.
+    */
+
+    void dump(FILE *fp);
+
+    //--------------------------------------------------------------------------
+    /** Histogram bin of a cycle count and the lowest count in a bin.
+    */
+
+    static int binOf(uint32_t cycles);
+    static uint32_t binFloor(int bin);
+
+#ifdef __MBED__
+    //--------------------------------------------------------------------------
+    /** Cycle source for the target, the DWT cycle counter.
+    *
+    * enableDwt() must be called once before it counts.
+    */
+
+    static uint32_t dwtCycles(void);
+    static void enableDwt(void);
+#endif
+
+private:
+
+    uint32_t (*_cycles)(void);
+    uint32_t _hz;
+    int _count;
+    stage_t _stages[PROF_MAX_STAGES];
+
+}; // end of class profiler
+
+//------------------------------------------------------------------------------
+/** Times the enclosing block into one stage.
+*
+* @code
+* {
+*     PROF_SCOPE scope(prof, stageId);
+*     ...
+* }
+* @endcode
+*/
+
+class PROF_SCOPE
+{
+
+public:
+
+    PROF_SCOPE(PROFILER &prof, int id) : _prof(prof), _id(id),
+                                         _start(prof.now()) {}
+    ~PROF_SCOPE() { _prof.record(_id, _prof.now() - _start); }
+
+private:
+
+    PROFILER &_prof;
+    int _id;
+    uint32_t _start;
+
+}; // end of class prof_scope
+
+#endif
@@ -0,0 +1,84 @@
+/* @file rcmap.cpp
+*
+* This file contains the integer mapping from radio pulse widths to motor DAC
+* codes and the brake target.
+*
+*/
+//------------------------------------------------------------------------------
+
+#include "rcmap.h"
+
+// Radio calibration points (us)
+#define RC_THROT_ZERO 1100
+#define RC_LR_ZERO    1000
+#define RC_LR_SPAN    5000
+#define RC_BRAKE_ZERO 1500
+#define RC_BRAKE_SPAN 500
+
+// Longest pulse the map accepts (us)
+#define RC_PULSE_MAX  2400
+
+// Full motor output is the throttle span (800 us) times the steering span
+#define RC_MOTOR_DIV  4000000
+
+//------------------------------------------------------------------------------
+
+// Scales a motor product to a DAC code, zero under 1% of full output
+static uint16_t motorCode(int64_t p, uint64_t div)
+{
+
+    uint64_t code;
+
+    if (p * 100 < (int64_t)div) {
+        return 0;
+    }
+
+    code = (uint64_t)p * RC_DAC_MAX / div;
+    return code > RC_DAC_MAX ? RC_DAC_MAX : (uint16_t)code;
+
+}
+
+//------------------------------------------------------------------------------
+
+void rcMotors(int32_t throt, int32_t lr, int n, uint16_t *ml, uint16_t *mr)
+{
+
+    uint64_t div = (uint64_t)RC_MOTOR_DIV * n * n;
+    int32_t t, l;
+
+    if (throt > RC_PULSE_MAX * n) {
+        throt = RC_PULSE_MAX * n;
+    }
+    if (lr > RC_PULSE_MAX * n) {
+        lr = RC_PULSE_MAX * n;
+    }
+
+    // No drive below the throttle zero, the float map let a negative
+    // throttle and steering multiply back to a positive output
+    t = throt - RC_THROT_ZERO * n;
+    if (t <= 0) {
+        *ml = 0;
+        *mr = 0;
+        return;
+    }
+
+    l = lr - RC_LR_ZERO * n;
+    *ml = motorCode((int64_t)(RC_LR_SPAN * n - l) * t, div);
+    *mr = motorCode((int64_t)l * t, div);
+
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t rcBrake(int32_t brake, int n)
+{
+
+    int32_t d = brake - RC_BRAKE_ZERO * n;
+
+    if (d < 0) {
+        d = -d;
+    }
+
+    return (uint32_t)d * 0xFFFF / (RC_BRAKE_SPAN * n);
+
+}
@@ -0,0 +1,48 @@
+/* @file rcmap.h
+*
+* This file contains the integer mapping from radio pulse widths to motor DAC
+* codes and the brake target.
+*
+*/
+//------------------------------------------------------------------------------
+
+#ifndef RCMAP_H
+#define RCMAP_H
+
+#include <stdint.h>
+
+// Largest MCP4922 code
+#define RC_DAC_MAX 4095
+
+//------------------------------------------------------------------------------
+/** Maps throttle and steering to the drive motor DAC codes.
+*
+* Gives the same codes as the float modeRC() followed by MCP4922::write()
+* to within one LSB: throttle runs 1100 to 1900 us, steering splits it
+* (1000 us all left, 6000 us all right) and outputs under 1% are zero.
+* Unlike modeRC() both outputs are zero at or below 1100 us of throttle.
+* Pulse widths are passed as the sum of n frames so averaging loses
+* nothing.
+*
+*   @param throt Sum of n throttle pulse widths in us.
+*   @param lr    Sum of n steering pulse widths in us.
+*   @param n     Number of frames summed.
+*   @param ml    Left motor code, 0 to RC_DAC_MAX.
+*   @param mr    Right motor code, 0 to RC_DAC_MAX.
+*/
+
+void rcMotors(int32_t throt, int32_t lr, int n, uint16_t *ml, uint16_t *mr);
+
+//------------------------------------------------------------------------------
+/** Maps the brake channel to a brake actuator position.
+*
+*   @param brake Sum of n brake pulse widths in us, 1500 us is released and
+*                each 500 us either side is full travel.
+*   @param n     Number of frames summed.
+*   @return Position on the AnalogIn::read_u16() scale, 0xFFFF is full
+*           travel, not clamped.
+*/
+
+uint32_t rcBrake(int32_t brake, int n);
+
+#endif
@@ -0,0 +1,146 @@
+/* @file rcmapdev.cpp
+*
+* Host test of the integer radio map against the float modeRC() path.
+*
+* g++ -O2 -o rcmapdev rcmapdev.cpp rcmap.cpp && ./rcmapdev
+*
+*/
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "rcmap.h"
+
+// Three radio frames are averaged per update
+#define FRAMES 3
+
+// Radio pulse range covered (us)
+#define PULSE_MIN 900
+#define PULSE_MAX 2100
+
+// Float reference, modeRC() as it was in main.cpp
+int modeRC(float throtle, float lrat, float brake, float *mr, float *ml, float *bA) {
+
+    throtle *= 1000000;
+    throtle -= 1100;
+    throtle /= 8;
+
+    lrat *= 1000000;
+    lrat -= 1000;
+    lrat /= 5000;
+
+    brake *= 1000000;
+    brake -= 1500;
+    brake /= 500;
+
+    if (brake < 0){
+        brake *= -1;
+    }
+
+    *ml = ((1 - lrat)* throtle) / 100;
+    *mr = (lrat * throtle) / 100;
+    *bA = brake;
+
+    if (*ml < 0.01)
+        *ml = 0;
+    if (*mr < 0.01)
+        *mr = 0;
+
+    return 0;
+}
+
+// Float reference, MCP4922::write() down to the 12 bit code
+unsigned short dacCode(float value) {
+    if (value < 0.0)
+        value = 0.0;
+    else if (value > 1.0)
+        value = 1.0;
+    return ((unsigned short)(value * 4095) << 4) >> 4;
+}
+
+// Float reference, FRAMES PwmIn::pulsewidth() readings summed and averaged
+float average(int sum_us) {
+    float f = 0.0;
+    for (int i = 0; i < FRAMES; i++) {
+        // Split the sum into frames the way the radio would deliver it
+        int us = sum_us / FRAMES + (i < sum_us % FRAMES ? 1 : 0);
+        f += (float)us / 1000000.0f;
+    }
+    return f / FRAMES;
+}
+
+int main() {
+    long checked = 0, worst = 0, off = 0, ties = 0;
+    float mr, ml, bA;
+    uint16_t iml, imr;
+
+    // Every throttle and steering sum of three in range
+    for (int st = 1100 * FRAMES; st <= PULSE_MAX * FRAMES; st++) {
+        float ft = average(st);
+
+        for (int sl = PULSE_MIN * FRAMES; sl <= PULSE_MAX * FRAMES; sl++) {
+            modeRC(ft, average(sl), 0.0, &mr, &ml, &bA);
+            rcMotors(st, sl, FRAMES, &iml, &imr);
+
+            long dl = labs((long)dacCode(ml) - iml);
+            long dr = labs((long)dacCode(mr) - imr);
+
+            // At exactly 1% output the float rounding decides the cutoff
+            // either way, accept zero or the code
+            long long t = st - 1100 * FRAMES;
+            long long l = sl - 1000 * FRAMES;
+            long long tie = 4000000LL * FRAMES * FRAMES;
+            if ((5000 * FRAMES - l) * t * 100 == tie && (iml == 0 || dacCode(ml) == 0)) {
+                dl = 0;
+                ties++;
+            }
+            if (l * t * 100 == tie && (imr == 0 || dacCode(mr) == 0)) {
+                dr = 0;
+                ties++;
+            }
+            long d = dl > dr ? dl : dr;
+
+            if (d > worst) {
+                worst = d;
+            }
+            if (d > 1) {
+                if (off < 10) {
+                    printf("FAIL throt %d lr %d: float %u %u, fixed %u %u\n",
+                           st, sl, dacCode(ml), dacCode(mr), iml, imr);
+                }
+                off++;
+            }
+            checked++;
+        }
+    }
+    printf("motors: %ld cases, worst %ld LSB, %ld over 1 LSB, %ld cutoff ties\n",
+           checked, worst, off, ties);
+
+    // Throttle at or below zero drives nothing
+    rcMotors(0, 0, 1, &iml, &imr);
+    if (iml || imr) {
+        printf("FAIL no signal drives %u %u\n", iml, imr);
+        off++;
+    }
+
+    // Brake, compared on the AnalogIn::read_u16() scale
+    long bworst = 0;
+    for (int sb = PULSE_MIN * FRAMES; sb <= PULSE_MAX * FRAMES; sb++) {
+        modeRC(0.0, 0.0, average(sb), &mr, &ml, &bA);
+        long d = labs((long)(bA * 65535) - (long)rcBrake(sb, FRAMES));
+        if (d > bworst) {
+            bworst = d;
+        }
+    }
+    printf("brake: worst %ld of 65535\n", bworst);
+    if (bworst > 1) {
+        off++;
+    }
+
+    if (off) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
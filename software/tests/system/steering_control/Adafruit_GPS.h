@@ -20,6 +20,7 @@ All text above must be included in any redistribution
 #include <stdint.h>
 #include <math.h>
 #include <ctype.h>
+#include "geo.h"
 
 #ifndef _MBED_ADAFRUIT_GPS_H
 #define _MBED_ADAFRUIT_GPS_H
@@ -95,6 +96,7 @@ class Adafruit_GPS {
   uint8_t hour, minute, seconds, year, month, day;
   uint16_t milliseconds;
   float latitude, longitude, geoidheight, altitude;
+  coord_t latitude_fixed, longitude_fixed; // 1e-7 deg, north and east positive
   float speed, angle, magvariation, HDOP;
   char lat, lon, mag;
   bool fix;
@@ -11,8 +11,10 @@
 
 #include "imu.h"
 #include "Adafruit_GPS.h"
+#include "gpscfg.h"
 #include "motor.h"
 #include "QEI.h"
+#include "QEIGroup.h"
 #include "PID.h"
 
 #define KP_STEER 5.0 // Tested with KP = 5.0
@@ -21,7 +23,12 @@
 #define SPEED 30.0
 #define STEER_INTERVAL 0.028
 #define DISTANCE 10000
+#define IMU_CALIB_FILE "/sd/imucal.txt"
+#define IMU_READY_MS 1000
 
+// Uncomment to steer on the orientation filter run on the MCU from raw IMU
+// readings at 400 Hz, instead of the 100 Hz BNO055 fusion
+// #define MCU_FUSION
 
 int main()
 {
@@ -33,10 +40,17 @@ int main()
 
     // Sensor objects
     IMU imu(IMDA, IMCL, BNO055_G_CHIP_ADDR);
+#ifdef MCU_FUSION
+    MAHONY ahrs(1 / IMU_RAW_PERIOD);
+#endif
     Serial gpsSer(GPTX, GPRX, 57600);
     Adafruit_GPS Gps(&gpsSer);
+    GPSCONFIG gpsCfg;
+    Timer gpsClock;
+    char gpsCmd[GPSCFG_CMD_LEN];
     QEI EncoderL(CHA1_MOD, CHB1_MOD, NC, 192, QEI::X4_ENCODING);
     QEI EncoderR(CHA2_MOD, CHB2_MOD, NC, 192, QEI::X4_ENCODING);
+    QEIGroup Encoders;
     DigitalIn button(USER_BUTTON);
 
     // Motor objects
@@ -45,6 +59,7 @@ int main()
 
     // Timer
     Timer steerTimer;
+    Timer readyTimer;
 
     // Data variables
     int pCount = 0;
@@ -54,12 +69,16 @@ int main()
 
     // Sensor variables
     int lenc, renc;
+    qei_latch_t enc;
+    enc_speed_t lvel, rvel;
     int lock = 0;
-    bool flip = 0;
 
     // Creates variables of reading data types
+    IMU::imu_data_t imuData;
     IMU::imu_euler_t euler;
     IMU::imu_lin_accel_t linAccel;
+    IMU::imu_calib_status_t calib;
+    uint32_t imuSeen = 0;
 
     // PID control variables
     float steerSp = 0.0;
@@ -81,11 +100,52 @@ int main()
 	}	
     Pc.printf("FileSystem ready\r\n");
 
-    // Start GPS
-    Gps.begin(57600);
-    Gps.sendCommand(PMTK_SET_BAUD_57600);
-    Gps.sendCommand(PMTK_SET_NMEA_OUTPUT_RMCONLY);
-    Gps.sendCommand(PMTK_SET_NMEA_UPDATE_10HZ);
+#ifdef MCU_FUSION
+    // Raw readings in the background, the filter starts from the first one
+    imu.setRawMode();
+    imu.fusion(&ahrs);
+    imu.start(IMU_RAW_PERIOD);
+    wait_ms(100);
+#else
+    // Restore the IMU calibration from the last run so the fusion starts
+    // settled, then wait for the gyro to check in (it does at rest)
+    if (imu.loadCalibration(IMU_CALIB_FILE)) {
+        Pc.printf("IMU calibration restored\r\n");
+    } else {
+        Pc.printf("No IMU calibration saved, fusion starts from scratch\r\n");
+    }
+    readyTimer.start();
+    do {
+        imu.getCalibStatus(&calib);
+    } while (calib.gyro < 3 && readyTimer.read_ms() < IMU_READY_MS);
+    Pc.printf("IMU ready after %d ms, calibration sys %d gyro %d accel %d mag %d\r\n",
+              readyTimer.read_ms(), calib.sys, calib.gyro, calib.accel, calib.mag);
+#endif
+
+    // Start GPS, every setting acknowledged, a few seconds at worst if it
+    // never answers
+    gpsClock.start();
+    gpsCfg.start(gpsClock.read_ms());
+    while (!gpsCfg.done() && !gpsCfg.failed()) {
+        while (gpsSer.readable()) {
+            Gps.read();
+        }
+        if (Gps.newNMEAreceived()) {
+            gpsCfg.sentence(Gps.lastNMEA());
+        }
+        switch (gpsCfg.step(gpsClock.read_ms(), gpsCmd, sizeof(gpsCmd))) {
+        case GPSCFG_SEND:
+            Gps.sendCommand(gpsCmd);
+            break;
+        case GPSCFG_BAUD:
+            Gps.begin(gpsCfg.baud());
+            break;
+        default:
+            break;
+        }
+    }
+    Pc.printf("GPS %s at %d baud, fix every %d ms\r\n",
+              gpsCfg.done() ? "configured" : "not answering", gpsCfg.baud(), gpsCfg.period());
     
 	//Initialize motors
 	MotorL.start(0);
@@ -94,10 +154,15 @@ int main()
     motorLOutput = SPEED;
     Pc.printf("Motors initialized\r\n");
 
-    //Getting initial heading for control loop (average 5 readings)
+    //Getting initial heading for control loop (average 5 readings, unwrapped
+    //so readings either side of north do not average to south)
     for (int i = 0; i < 5; i++) {
-        imu.getEulerAng(&euler);
-        steerSp += euler.heading;
+#ifdef MCU_FUSION
+        imu.sample(&imuData, &imuSeen);
+        steerSp += imu.heading(imuData.quat);
+#else
+        steerSp += imu.getHeading();
+#endif
         wait_ms(20);
     }
     steerSp /= 5;
@@ -109,9 +174,9 @@ int main()
 
     // Print collumn catagories
     fprintf(ofp, "Point#, timeElapsed, ");
-    fprintf(ofp, "gpsDate, gpsTime, lat, long, ");
+    fprintf(ofp, "gpsDate, gpsTime, lat e7, long e7, ");
     fprintf(ofp, "xAcc, yAcc, zAcc, heading, pitch, roll, ");
-    fprintf(ofp, "lEncoder, rEncoder, lMotor, rMotor\r\n");
+    fprintf(ofp, "lEncoder, rEncoder, lVel, rVel, lVelSd, rVelSd, lMotor, rMotor\r\n");
 
     // Wait for button press
     while (button)
@@ -123,6 +188,10 @@ int main()
     // Start PID
     steerPID.start();
 
+    // Encoder deltas run from here
+    Encoders.add(EncoderL);
+    Encoders.add(EncoderR);
+
     // Start timer
     steerTimer.start();
 
@@ -134,15 +203,22 @@ int main()
             tElapsed += steerTimer.read();
             steerTimer.reset();
 
-            // Read data from IMU
-            imu.getEulerAng(&euler);
-            imu.getLinAccel(&linAccel);
-
-            // Read encoder counts
-            lenc = EncoderL.getPulses();
-            renc = EncoderR.getPulses();
-            EncoderL.reset();
-            EncoderR.reset();
+            // Read data from IMU, all from one fusion output
+#ifdef MCU_FUSION
+            imu.sample(&imuData, &imuSeen);
+#else
+            imu.readAll(&imuData);
+#endif
+            euler = imuData.euler;
+            linAccel = imuData.linAccel;
+
+            // Read encoder counts since the last loop, both at once, and
+            // speeds (pulses/sec)
+            Encoders.latch(&enc);
+            lenc = enc.delta[0];
+            renc = enc.delta[1];
+            lvel = EncoderL.getVelocity();
+            rvel = EncoderR.getVelocity();
 
             // Read GPS data
             if (Gps.newNMEAreceived()) {
@@ -158,7 +234,7 @@ int main()
 
                 // Record gps data if available
                 if (lock) {
-                    fprintf(ofp, "%d/%d/%d, %d:%d:%d, %f, %f, ", Gps.month, Gps.day, Gps.year, Gps.hour, Gps.minute, Gps.seconds, Gps.latitude, Gps.longitude);
+                    fprintf(ofp, "%d/%d/%d, %d:%d:%d, %ld, %ld, ", Gps.month, Gps.day, Gps.year, Gps.hour, Gps.minute, Gps.seconds, (long)Gps.latitude_fixed, (long)Gps.longitude_fixed);
                 } else {
                     fprintf(ofp, "NL, NL, NL, NL, ");
                 }
@@ -169,6 +245,7 @@ int main()
 
                 //record encoder variables
                 fprintf(ofp, "%d, %d, ", lenc, renc);
+                fprintf(ofp, "%f, %f, %f, %f, ", lvel.rate, rvel.rate, lvel.sigma, rvel.sigma);
 
                 //record motor variables
                 fprintf(ofp, "%f, %f\r\n", motorLOutput, motorROutput); 
@@ -178,23 +255,13 @@ int main()
             // Stop PID before writing to shared variables
             steerPID.stop();
 
-            // Feedback for steering correction (handles zero wrap around)
-            steerInput = euler.heading;
-            flip = 0;
-            if (steerInput > 180.0) {
-                steerInput = 360.0 - steerInput;
-                flip = 1;
-            }
+            // Feedback for steering correction, the unwrapped heading
+            // carries on past 360 and 0 so the error never jumps
+            steerInput = imu.heading(imuData.quat);
 
             // Update motor setpoints
-            if (flip == 0){
-                motorLOutput = SPEED + steerOutput;
-                motorROutput = SPEED - steerOutput;
-            } else {
-                motorLOutput = SPEED - steerOutput;
-                motorROutput = SPEED + steerOutput;
-            }
-            flip = 0;
+            motorLOutput = SPEED + steerOutput;
+            motorROutput = SPEED - steerOutput;
 
             // Restarts PID timers
             steerPID.start();
@@ -224,6 +291,16 @@ int main()
     //Unmount the filesystem
     fprintf(ofp,"End of Program\r\n");
     fclose(ofp);
+
+#ifdef MCU_FUSION
+    imu.stop();
+#else
+    // Keep the calibration for the next run once the fusion trusts it
+    if (imu.isCalibrated() && imu.saveCalibration(IMU_CALIB_FILE)) {
+        Pc.printf("IMU calibration saved\r\n");
+    }
+#endif
+
     sd.unmount();
     Pc.printf("SD card unmounted\r\n");
 